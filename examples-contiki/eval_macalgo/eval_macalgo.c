@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Test program to compare the performance of RePeL's MAC modules
+ * in isolation, i.e., without parsing and embedding.
+ *
+ * \author
+ * Nils Rothaug
+ */
+#include "contiki.h"
+#include "sys/log.h"
+
+#include "process.h"
+
+#include <string.h>
+
+#include "random.h"
+
+#include <repel/repel.h>
+#include <repel/repel_modules.h>
+#include <repel/repel_log.h>
+#include <repel/eval_timer.h>
+#include <services/rpl-border-router/rpl-border-router.h>
+
+/* Largest Modbus TCP ADU */
+#define MAX_DATA_LEN    260
+#define RUNS_PER_LEN    10
+
+/* Bits the Modbus TCP parser embeds by default */
+#define MAC_BITS        36
+
+struct MacBenchmark {
+    char const* name;
+    mac_module_t* module;
+};
+
+static struct MacBenchmark const benchmarks[] = {
+    { "hmac", &hmac_module },
+    { "siphash", &siphash_module },
+    { "halfsiphash", &halfsiphash_module },
+    { "blake2s", &blake2s_module }
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/*---------------------------------------------------------------------------*/
+PROCESS(macalgo_test, "MAC algorithm test");
+AUTOSTART_PROCESSES(&macalgo_test);
+/*---------------------------------------------------------------------------*/
+
+PROCESS_THREAD(macalgo_test, ev, data) {
+    static uint8_t keys[2][16] = {
+        { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+            0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x34 },
+        { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+            0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x35 }
+    };
+    static uint8_t buf[MAX_DATA_LEN];
+    static uint8_t mac[ceil_bits_to_bytes(MAC_BITS)];
+    static void* states[NUM_BENCHMARKS];
+
+    static uint16_t len = 1;
+    static uint16_t run = 0;
+    static uint8_t b;
+
+PROCESS_BEGIN();
+    /* Keep border router to wait for log collection script */
+    PROCESS_WAIT_EVENT_UNTIL(ev == RPL_EVENT_CONNECTED);
+
+    for(b = 0; b < NUM_BENCHMARKS; b++) {
+        states[b] = benchmarks[b].module->create(sizeof(mac));
+        benchmarks[b].module->set_keys(states[b], keys);
+    }
+
+    while(len <= MAX_DATA_LEN) {
+        run = 0;
+        while(run < RUNS_PER_LEN) {
+            for(int i = 0; i < len; i++) {
+                /* Pseudo randomness, hardware generator and seed on zoul */
+                buf[i] = random_rand();
+            }
+
+            for(b = 0; b < NUM_BENCHMARKS; b++) {
+                mac_module_t* module = benchmarks[b].module;
+                noncebytes_t nonce = netendian_nonce(run);
+
+                eval_timer_start();
+                memcpy(mac, module->sign(states[b], buf, len, MAC_BITS, 0, &nonce), sizeof(mac));
+                eval_timer_measure("signed");
+                module->verify(states[b], buf, len, mac, MAC_BITS, &nonce);
+                eval_timer_measure("verified");
+                eval_timer_print(benchmarks[b].name, len);
+            }
+            run++;
+
+            /* Calm the watchdogs */
+            PROCESS_PAUSE();
+        }
+        len++;
+    }
+
+    for(b = 0; b < NUM_BENCHMARKS; b++) {
+        benchmarks[b].module->destroy(states[b]);
+    }
+    info("Done. MAX_DATA_LEN=%u, RUNS_PER_LEN=%u.",
+        (unsigned int) MAX_DATA_LEN,
+        (unsigned int) RUNS_PER_LEN);
+
+PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,17 @@
+#define UIP_CONF_TCP 0
+
+#define HEAPMEM_CONF_ARENA_SIZE 768
+
+//#define NO_MODULE_EVAL_TIMERS
+
+//#define REPEL_USE_HW_ACCEL true
+
+#define REPEL_APP_LOG_LEVEL LOG_LEVEL_WARN
+#define REPEL_LOG_LEVEL LOG_LEVEL_WARN
+
+/* Save RAM */
+#define QUEUEBUF_CONF_NUM 1
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 1
+#define NETSTACK_MAX_ROUTE_ENTRIES 1
+#define UIP_CONF_BUFFER_SIZE 128
+#define SICSLOWPAN_CONF_FRAG 0
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Builds a memory-mapped key store file from a text file with one device per
+ * line: "<device id> <send key> <receive key>", keys as 32 hex digits each.
+ * Empty lines and lines starting with '#' are ignored.
+ *
+ * \author
+ * Nils Rothaug
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <repel.h>
+#include <repel_log.h>
+#include <key_store.h>
+
+#define LINE_LEN    256
+
+static bool parse_key(char const* hex, uint8_t key[KEY_STORE_KEY_SIZE]) {
+    if(strlen(hex) != 2 * KEY_STORE_KEY_SIZE) {
+        return false;
+    }
+    for(unsigned int i = 0; i < KEY_STORE_KEY_SIZE; i++) {
+        unsigned int byte;
+        if(sscanf(hex + 2*i, "%2x", &byte) != 1) {
+            return false;
+        }
+        key[i] = (uint8_t) byte;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    key_store_record_t* records = NULL;
+    uint32_t count = 0, capacity = 0;
+    char line[LINE_LEN];
+    unsigned long lineno = 0;
+
+    if(argc != 3) {
+        printf("Usage %s: <device key list> <key store file>\n", argv[0]);
+        exit(1);
+    }
+
+    FILE* input = fopen(argv[1], "r");
+    if(!input) {
+        error("Cannot open '%s'", argv[1]);
+        exit(1);
+    }
+
+    while(fgets(line, sizeof(line), input)) {
+        char const* id = strtok(line, " \t\r\n");
+        char const* send = strtok(NULL, " \t\r\n");
+        char const* recv = strtok(NULL, " \t\r\n");
+        lineno++;
+
+        if(!id || id[0] == '#') {
+            continue;
+        }
+
+        if(count == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            records = (key_store_record_t*) realloc(records, capacity * sizeof(key_store_record_t));
+            if(!records) {
+                error("Out of memory");
+                exit(1);
+            }
+        }
+
+        key_store_record_t* record = &records[count];
+        memset(record, 0, sizeof(key_store_record_t));
+        record->id_len = (uint8_t) strlen(id);
+
+        if(strlen(id) > KEY_STORE_MAX_ID_LEN || !send || !recv
+            || !parse_key(send, record->keys[0]) || !parse_key(recv, record->keys[1])) {
+            error("Invalid entry in line %lu", lineno);
+            exit(1);
+        }
+        memcpy(record->id, id, record->id_len);
+        count++;
+    }
+    fclose(input);
+
+    if(!key_store_write(argv[2], records, count)) {
+        exit(1);
+    }
+
+    /* Check that all devices are found in the written file */
+    key_store_t* store = key_store_open(argv[2]);
+    if(!store) {
+        exit(1);
+    }
+    for(uint32_t r = 0; r < count; r++) {
+        key_store_record_t const* found = key_store_find(store, records[r].id, records[r].id_len);
+        if(!found || memcmp(found->keys, records[r].keys, sizeof(found->keys)) != 0) {
+            error("Device '%s' missing in key store, duplicate ID?", (char const*) records[r].id);
+            exit(1);
+        }
+    }
+    key_store_close(store);
+    free(records);
+
+    info("Wrote %lu devices to '%s'", (unsigned long) count, argv[2]);
+    return 0;
+}
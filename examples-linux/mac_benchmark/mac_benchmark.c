@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Benchmark that measures the time RePeL's MAC modules take to sign and verify
+ * packets of different lengths in isolation, i.e., without parsing and embedding.
+ *
+ * \author
+ * Nils Rothaug
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <time.h>
+
+#include <repel.h>
+#include <repel_modules.h>
+#include <repel_log.h>
+
+/* Largest Modbus TCP ADU */
+#define MAX_DATA_LEN    260
+#define RUNS_PER_LEN    1000
+
+/* Bits the Modbus TCP parser embeds by default */
+#define MAC_BITS        36
+
+/* Packets per mac_batch() call */
+#define BATCH_SIZE      8
+
+struct MacBenchmark {
+    char const* name;
+    mac_module_t* module;
+};
+
+static struct MacBenchmark const benchmarks[] = {
+    { "hmac", &hmac_module },
+    { "afalg_hmac", &afalg_hmac_module },
+    { "cmac", &cmac_module },
+    { "gmac", &gmac_module },
+    { "siphash", &siphash_module },
+    { "halfsiphash", &halfsiphash_module },
+    { "blake2s", &blake2s_module },
+    { "blake3", &blake3_module }
+};
+
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+uint8_t keys[2][16] = {
+    { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+        0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x34 }, /* send key */
+    { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+        0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x35 } /* receive key */
+};
+
+uint8_t buf[MAX_DATA_LEN];
+uint8_t mac[ceil_bits_to_bytes(MAC_BITS)];
+uint8_t batchmacs[BATCH_SIZE][ceil_bits_to_bytes(MAC_BITS)];
+
+static long double elapsed_ns(struct timespec const* start, struct timespec const* end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000.0L + (end->tv_nsec - start->tv_nsec);
+}
+
+static void print_result(char const* label, char const* op, unsigned int pktlen, long double delay) {
+    printf("{\n\t\"type\": \"macbench\",\n\t\"label\": \"%s\",\n\t\"op\": \"%s\",\n"
+        "\t\"pktlen\": \"%u\",\n\t\"unit\": \"nanosecond\",\n"
+        "\t\"delay\": %Lf\n},\n",
+        label, op, pktlen, delay);
+}
+
+int main(int argc, char** argv) {
+    unsigned long runs = RUNS_PER_LEN;
+    struct timespec start, end;
+
+    if(argc == 2) {
+        runs = strtoul(argv[1], NULL, 10);
+    }
+    if(argc > 2 || runs == 0) {
+        printf("Usage %s: [runs per packet length]\n", argv[0]);
+        exit(1);
+    }
+
+    for(unsigned int i = 0; i < MAX_DATA_LEN; i++) {
+        buf[i] = (uint8_t) rand();
+    }
+
+    for(unsigned int b = 0; b < NUM_BENCHMARKS; b++) {
+        mac_module_t* module = benchmarks[b].module;
+        void* state = module->create(sizeof(mac));
+        if(!state) {
+            error("Cannot create MAC module '%s'", benchmarks[b].name);
+            exit(1);
+        }
+        module->set_keys(state, keys);
+
+        for(uint16_t len = 1; len <= MAX_DATA_LEN; len++) {
+            noncebytes_t nonce = netendian_nonce(len);
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(unsigned long r = 0; r < runs; r++) {
+                memcpy(mac, module->sign(state, buf, len, MAC_BITS, 0, &nonce), sizeof(mac));
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            print_result(benchmarks[b].name, "sign", len, elapsed_ns(&start, &end) / runs);
+
+            /* Verification fails due to different keys, but takes equally long */
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(unsigned long r = 0; r < runs; r++) {
+                module->verify(state, buf, len, mac, MAC_BITS, &nonce);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            print_result(benchmarks[b].name, "verify", len, elapsed_ns(&start, &end) / runs);
+
+            /* Sign the same number of packets in batches, reports the delay per packet */
+            mac_batch_job_t jobs[BATCH_SIZE];
+            for(unsigned int j = 0; j < BATCH_SIZE; j++) {
+                jobs[j] = (mac_batch_job_t) { buf, len, &nonce, MAC_BITS, batchmacs[j], 0 };
+            }
+
+            unsigned long batches = (runs + BATCH_SIZE - 1) / BATCH_SIZE;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for(unsigned long r = 0; r < batches; r++) {
+                mac_batch(module, state, jobs, BATCH_SIZE, EMBED);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            print_result(benchmarks[b].name, "sign batch", len, elapsed_ns(&start, &end) / (batches * BATCH_SIZE));
+        }
+
+        module->destroy(state);
+    }
+
+    info("Done. MAX_DATA_LEN=%u, RUNS_PER_LEN=%lu.", (unsigned int) MAX_DATA_LEN, runs);
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Modbus TCP gateway that terminates many upstream Modbus clients and
+ * multiplexes their requests onto one protected connection to a device.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <repel.h>
+#include <repel_log.h>
+#include <modbus_mux.h>
+
+#include <sane_tcp.h>
+
+#define MAX_CLIENTS     64
+#define BUF_SIZE        4096
+
+#define REPEL_HMAC      hmac_module
+#define REPEL_NONCEBITS 3
+#define REUSE_TID_BITS  8
+/* Seconds until requests without authentic response expire */
+#define MUX_TIMEOUT     5
+
+uint8_t keys[2][16] = {
+    { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+        0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x34 }, /* send key */
+    { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+        0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x35 } /* receive key */
+};
+
+struct Client {
+    tcp_socket_t sock;
+    bool open;
+    /**
+     * Received bytes not yet forwarded, i.e., a partial request or requests waiting for slots
+     */
+    uint8_t buf[BUF_SIZE];
+    uint16_t len;
+};
+
+struct Client clients[MAX_CLIENTS];
+
+tcp_socket_t listener, device;
+uint8_t devbuf[BUF_SIZE];
+uint16_t devlen = 0;
+
+modbus_mux_t* mux;
+
+void close_client(uint32_t client) {
+    modbus_mux_drop_client(mux, client);
+    tcp_close(&clients[client].sock);
+    clients[client].open = false;
+    info("Client %u disconnected", (unsigned int) client);
+}
+
+void send_response(void* ctx, uint32_t client, void* response, uint16_t len) {
+    (void) ctx;
+
+    if(clients[client].open && !tcp_send_bytes(&clients[client].sock, response, len)) {
+        warn("Cannot send response to client %u", (unsigned int) client);
+        close_client(client);
+    }
+}
+
+/**
+ * Forwards buffered requests of a client as far as slots are available
+ */
+void forward_requests(uint32_t client) {
+    struct Client* c = &clients[client];
+    uint16_t partial;
+
+    int32_t done = modbus_mux_request(mux, client, c->buf, c->len, &partial);
+    bool const invalid = done == REPEL_SEGMENT_INVALID;
+    if(invalid) {
+        /* Requests before the invalid one hold slots */
+        done = c->len - partial;
+    }
+    if(done > 0 && !tcp_send_bytes(&device, c->buf, done)) {
+        error("Cannot send requests to device");
+        exit(1);
+    }
+    if(invalid) {
+        warn("Invalid request from client %u", (unsigned int) client);
+        close_client(client);
+        return;
+    }
+    memmove(c->buf, c->buf + done, partial);
+    c->len = partial;
+}
+
+/**
+ * Forwards requests of all clients that wait for slots
+ */
+void forward_waiting() {
+    for(uint32_t i = 0; i < MAX_CLIENTS; i++) {
+        if(clients[i].open && clients[i].len > 0) {
+            forward_requests(i);
+        }
+    }
+}
+
+void accept_client() {
+    tcp_socket_t sock;
+
+    if(!tcp_server_accept(&listener, &sock)) {
+        return;
+    }
+    for(uint32_t i = 0; i < MAX_CLIENTS; i++) {
+        if(!clients[i].open) {
+            clients[i].sock = sock;
+            clients[i].open = true;
+            clients[i].len = 0;
+            info("Client %u connected", (unsigned int) i);
+            return;
+        }
+    }
+    warn("Too many clients, rejecting connection");
+    tcp_close(&sock);
+}
+
+void receive_responses() {
+    size_t len = BUF_SIZE - devlen;
+    uint16_t partial;
+
+    if(!tcp_recv_some(&device, devbuf + devlen, &len)) {
+        error("Device closed connection");
+        exit(1);
+    }
+    devlen += len;
+
+    int32_t done = modbus_mux_response(mux, devbuf, devlen, &partial);
+    if(done == REPEL_SEGMENT_INVALID || partial == BUF_SIZE) {
+        error("Cannot parse responses from device");
+        exit(1);
+    }
+    memmove(devbuf, devbuf + done, partial);
+    devlen = partial;
+
+    /* Responses freed slots for waiting requests */
+    forward_waiting();
+}
+
+time_t monotonic_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+void receive_requests(uint32_t client) {
+    struct Client* c = &clients[client];
+    size_t len = BUF_SIZE - c->len;
+
+    /* Closed while sending responses */
+    if(!c->open) {
+        return;
+    }
+    if(!tcp_recv_some(&c->sock, c->buf + c->len, &len)) {
+        close_client(client);
+        return;
+    }
+    c->len += len;
+    forward_requests(client);
+}
+
+int main(int argc, char** argv) {
+    char* netport, *devip, *devport;
+    enum IPversion ipv = IP_V4;
+
+    if(argc == 4) {
+        netport = argv[1];
+        devip = argv[2];
+        devport = argv[3];
+    } else if(argc == 5 && 0 == strcmp(argv[1], "-v6")) {
+        ipv = IP_V6;
+        netport = argv[2];
+        devip = argv[3];
+        devport = argv[4];
+    } else {
+        printf("Usage %s: [-v6] <network port> <device ip> <device port>\n", argv[0]);
+        exit(1);
+    }
+
+    /* Clients may disconnect before their responses arrive */
+    signal(SIGPIPE, SIG_IGN);
+
+    if(!tcp_server_open(&listener, netport, MAX_CLIENTS, ipv)) {
+        error("Cannot open server socket");
+        exit(1);
+    }
+    if(!tcp_client_open(&device, devip, devport, ipv)) {
+        error("Cannot open client socket");
+        exit(1);
+    }
+
+    /* The gateway is the Modbus client of the device */
+    modbus_tcp_config_t config = { true, REUSE_TID_BITS, true, NULL };
+    repel_connection_t repel = repel_create_configured_connection(&modbus_tcp_parser, &config, &REPEL_HMAC, REPEL_NONCEBITS);
+    mux = repel ? modbus_mux_create(repel, 1 << (16 - REUSE_TID_BITS), MUX_TIMEOUT, &send_response, NULL) : NULL;
+    if(!mux) {
+        error("Cannot create device connection");
+        exit(1);
+    }
+    repel_set_keys(repel, keys);
+
+    info("Start forwarding. Stop program using ^C");
+    time_t last_tick = monotonic_seconds();
+
+    while(true) {
+        struct pollfd fds[MAX_CLIENTS + 2];
+        uint32_t ids[MAX_CLIENTS];
+        nfds_t count = 2;
+
+        fds[0] = (struct pollfd) { listener.socket, POLLIN, 0 };
+        fds[1] = (struct pollfd) { device.socket, POLLIN, 0 };
+        for(uint32_t i = 0; i < MAX_CLIENTS; i++) {
+            /* Clients with a full buffer wait for slots */
+            if(clients[i].open && clients[i].len < BUF_SIZE) {
+                ids[count - 2] = i;
+                fds[count++] = (struct pollfd) { clients[i].sock.socket, POLLIN, 0 };
+            }
+        }
+
+        /* Wake up every second to expire requests */
+        if(poll(fds, count, 1000) < 0) {
+            error("Poll failed");
+            break;
+        }
+        time_t const now = monotonic_seconds();
+        if(now != last_tick) {
+            if(modbus_mux_advance(mux, (uint32_t) (now - last_tick)) > 0) {
+                forward_waiting();
+            }
+            last_tick = now;
+        }
+        if(fds[0].revents) {
+            accept_client();
+        }
+        if(fds[1].revents) {
+            receive_responses();
+        }
+        for(nfds_t i = 2; i < count; i++) {
+            if(fds[i].revents) {
+                receive_requests(ids[i - 2]);
+            }
+        }
+    }
+
+    modbus_mux_destroy(mux);
+    repel_destroy_connection(repel);
+    tcp_close(&device);
+    tcp_close(&listener);
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Demonstrates active/standby replication of connection state between two
+ * local processes. Start the standby first, then the active node:
+ *
+ *   replication_demo standby /tmp/repel.sock
+ *   replication_demo active /tmp/repel.sock [packets]
+ *
+ * The active node protects packets on a table of connections, replicates
+ * their state in batches and stops without warning after the given number of
+ * packets. The standby then takes over and continues protecting packets.
+ *
+ * \author
+ * Nils Rothaug
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <repel.h>
+#include <repel_log.h>
+#include <replication.h>
+
+#define CONNECTIONS     64
+#define SLOT_SIZE       128
+#define NONCE_BITS      16
+#define PACKETS         100000
+/* Packets between two replication batches */
+#define SYNC_INTERVAL   1000
+
+uint8_t keys[2][16] = {
+    { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+        0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x34 }, /* send key */
+    { 0x26, 0x46, 0x29, 0x4A, 0x40, 0x4E, 0x63, 0x52,
+        0x66, 0x55, 0x6A, 0x57, 0x6E, 0x5A, 0x72, 0x35 } /* receive key */
+};
+
+uint8_t const request[] = { 0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0xff, 0x03, 0x00, 0x00, 0x00, 0x01 };
+
+repel_connection_t cons[CONNECTIONS];
+
+static unsigned long protect(unsigned long packets) {
+    uint8_t buf[sizeof(request)];
+    unsigned long protected = 0;
+
+    for(unsigned long p = 0; p < packets; p++) {
+        memcpy(buf, request, sizeof(buf));
+        if(repel_embed(cons[rand() % CONNECTIONS], buf, sizeof(buf)) > 0) {
+            protected++;
+        }
+    }
+    return protected;
+}
+
+static int run_active(char const* path, unsigned long packets) {
+    unsigned long protected = 0, batches = 0;
+
+    replication_t* rep = replication_connect(path, CONNECTIONS, SLOT_SIZE);
+    if(!rep) {
+        return 1;
+    }
+
+    /* Initial leases */
+    if(!replication_sync(rep, cons, CONNECTIONS)) {
+        return 1;
+    }
+    for(unsigned long p = 0; p < packets; p += SYNC_INTERVAL) {
+        protected += protect(packets - p < SYNC_INTERVAL ? packets - p : SYNC_INTERVAL);
+        if(!replication_sync(rep, cons, CONNECTIONS)) {
+            return 1;
+        }
+        batches++;
+    }
+
+    info("Active: Protected %lu of %lu packets, replicated %lu batches. Stopping.", protected, packets, batches);
+    /* No orderly shutdown, the standby must cope with a crash */
+    return 0;
+}
+
+static int run_standby(char const* path) {
+    int32_t applied;
+    unsigned long states = 0, batches = 0;
+
+    info("Standby: Waiting for active node");
+    replication_t* rep = replication_listen(path, CONNECTIONS, SLOT_SIZE);
+    if(!rep) {
+        return 1;
+    }
+
+    while((applied = replication_receive(rep, cons, CONNECTIONS)) >= 0) {
+        states += applied;
+        batches++;
+    }
+    info("Standby: Active node gone after %lu batches with %lu connection states. Taking over.", batches, states);
+
+    replication_takeover(rep, cons, CONNECTIONS);
+    replication_close(rep);
+
+    unsigned long protected = protect(SYNC_INTERVAL);
+    info("Standby: Protected %lu of %u packets after takeover.", protected, (unsigned int) SYNC_INTERVAL);
+    return protected == SYNC_INTERVAL ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    unsigned long packets = PACKETS;
+    int result;
+
+    if(argc == 4) {
+        packets = strtoul(argv[3], NULL, 10);
+    }
+    if(argc < 3 || argc > 4 || (strcmp(argv[1], "active") != 0 && strcmp(argv[1], "standby") != 0)) {
+        printf("Usage %s: standby <socket path> | active <socket path> [packets]\n", argv[0]);
+        exit(1);
+    }
+
+    for(unsigned int c = 0; c < CONNECTIONS; c++) {
+        cons[c] = repel_create_connection(&fake_parser, &hmac_module, NONCE_BITS);
+        if(!cons[c]) {
+            exit(1);
+        }
+        repel_set_keys(cons[c], keys);
+    }
+
+    if(strcmp(argv[1], "active") == 0) {
+        result = run_active(argv[2], packets);
+    } else {
+        result = run_standby(argv[2]);
+    }
+
+    for(unsigned int c = 0; c < CONNECTIONS; c++) {
+        repel_destroy_connection(cons[c]);
+    }
+    return result;
+}
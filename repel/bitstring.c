@@ -30,6 +30,17 @@
  */
 
 #include "bitstring.h"
+#include "cpu_features.h"
+
+#include <string.h>
+
+/* PDEP and PEXT on 64 bit words require x86-64 */
+#if REPEL_USE_CPU_EXTENSIONS && defined(__x86_64__)
+#define BITSTRING_USE_BMI2 true
+#include <immintrin.h>
+#else
+#define BITSTRING_USE_BMI2 false
+#endif
 
 bitstring_t bitstring_init(void* from) {
     bitstring_t bstr;
@@ -194,4 +205,176 @@ void bitstring_push_u64(bitstring_t* string, uint64_t val, uint8_t const bits) {
         octs -= 1;
         bitstring_push_u8(string, (uint8_t) (val >> (8*octs)), 8);
     }
-}
\ No newline at end of file
+}
+
+/**********************************************************
+ *                 Layouts of scattered bits              *
+ **********************************************************/
+
+static inline uint64_t _load_word(uint8_t const* bytes, uint8_t const len) {
+    uint64_t word = 0;
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if(len == 8) {
+        memcpy(&word, bytes, 8);
+        return __builtin_bswap64(word);
+    }
+    #endif
+    for(uint8_t i = 0; i < len; i++) {
+        word |= (uint64_t) bytes[i] << (56 - 8 * i);
+    }
+    return word;
+}
+
+static inline void _store_word(uint8_t* bytes, uint64_t const word, uint8_t const len) {
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if(len == 8) {
+        uint64_t const swapped = __builtin_bswap64(word);
+        memcpy(bytes, &swapped, 8);
+        return;
+    }
+    #endif
+    for(uint8_t i = 0; i < len; i++) {
+        bytes[i] = (uint8_t) (word >> (56 - 8 * i));
+    }
+}
+
+/**
+ * Portable PEXT, moves one run of contiguous mask bits per iteration
+ */
+static uint64_t _extract_bits(uint64_t const word, uint64_t mask) {
+    uint64_t packed = 0;
+    uint8_t shift = 0;
+    while(mask) {
+        uint64_t const low = mask & (~mask + 1);
+        uint64_t const run = mask & ~(mask + low);
+        uint8_t const runbits = (uint8_t) __builtin_popcountll(run);
+
+        packed |= ((word & run) >> __builtin_ctzll(low)) << shift;
+        shift += runbits;
+        mask &= ~run;
+    }
+    return packed;
+}
+
+/**
+ * Portable PDEP
+ */
+static uint64_t _deposit_bits(uint64_t packed, uint64_t mask) {
+    uint64_t word = 0;
+    while(mask) {
+        uint64_t const low = mask & (~mask + 1);
+        uint64_t const run = mask & ~(mask + low);
+        uint8_t const runbits = (uint8_t) __builtin_popcountll(run);
+
+        word |= (packed << __builtin_ctzll(low)) & run;
+        packed = runbits < 64 ? packed >> runbits : 0;
+        mask &= ~run;
+    }
+    return word;
+}
+
+#if BITSTRING_USE_BMI2
+
+__attribute__((target("bmi2")))
+static void _scatter_bmi2(bitstring_layout_t const* layout, uint8_t* packet, bitstring_t* src) {
+    for(uint16_t i = 0; i < layout->num_words; i++) {
+        bitstring_word_t const* w = &layout->words[i];
+        uint64_t const bits = bitstring_pop_u64(src, w->bits);
+        uint64_t const word = _load_word(packet + w->offset, w->len);
+        _store_word(packet + w->offset, (word & ~w->mask) | _pdep_u64(bits, w->mask), w->len);
+    }
+}
+
+__attribute__((target("bmi2")))
+static void _gather_bmi2(bitstring_layout_t const* layout, uint8_t const* packet, bitstring_t* dest) {
+    for(uint16_t i = 0; i < layout->num_words; i++) {
+        bitstring_word_t const* w = &layout->words[i];
+        bitstring_push_u64(dest, _pext_u64(_load_word(packet + w->offset, w->len), w->mask), w->bits);
+    }
+}
+
+#endif /* BITSTRING_USE_BMI2 */
+
+bool bitstring_layout_init(bitstring_layout_t* layout, bitstring_word_t* words, uint16_t max_words,
+    void const* mask, uint16_t mask_len) {
+
+    uint8_t const* maskbytes = (uint8_t const*) mask;
+    uint16_t pos = 0;
+
+    layout->words = words;
+    layout->num_words = 0;
+    layout->bits = 0;
+    layout->bmi2 = cpu_has_feature(CPU_FEATURE_BMI2);
+
+    while(pos < mask_len) {
+        if(maskbytes[pos] == 0) {
+            pos++;
+            continue;
+        }
+        if(layout->num_words == max_words) {
+            return false;
+        }
+
+        /* Prefer full words, but without overlapping the previous one */
+        uint16_t offset = pos;
+        if(mask_len >= 8 && offset > mask_len - 8) {
+            offset = mask_len - 8;
+        }
+        if(layout->num_words > 0) {
+            bitstring_word_t const* prev = &words[layout->num_words - 1];
+            if(offset < prev->offset + prev->len) {
+                offset = prev->offset + prev->len;
+            }
+        }
+
+        bitstring_word_t* w = &words[layout->num_words++];
+        w->offset = offset;
+        w->len = (mask_len - offset < 8) ? (uint8_t) (mask_len - offset) : 8;
+        w->mask = _load_word(maskbytes + offset, w->len);
+        w->bits = (uint8_t) __builtin_popcountll(w->mask);
+        layout->bits += w->bits;
+        pos = offset + w->len;
+    }
+    return true;
+}
+
+void bitstring_scatter(bitstring_layout_t const* layout, void* packet, bitstring_t* src) {
+    uint8_t* bytes = (uint8_t*) packet;
+
+    #if BITSTRING_USE_BMI2
+    if(layout->bmi2) {
+        _scatter_bmi2(layout, bytes, src);
+        return;
+    }
+    #endif
+    for(uint16_t i = 0; i < layout->num_words; i++) {
+        bitstring_word_t const* w = &layout->words[i];
+        uint64_t const bits = bitstring_pop_u64(src, w->bits);
+        uint64_t const word = _load_word(bytes + w->offset, w->len);
+        _store_word(bytes + w->offset, (word & ~w->mask) | _deposit_bits(bits, w->mask), w->len);
+    }
+}
+
+void bitstring_gather(bitstring_layout_t const* layout, void const* packet, bitstring_t* dest) {
+    uint8_t const* bytes = (uint8_t const*) packet;
+
+    #if BITSTRING_USE_BMI2
+    if(layout->bmi2) {
+        _gather_bmi2(layout, bytes, dest);
+        return;
+    }
+    #endif
+    for(uint16_t i = 0; i < layout->num_words; i++) {
+        bitstring_word_t const* w = &layout->words[i];
+        bitstring_push_u64(dest, _extract_bits(_load_word(bytes + w->offset, w->len), w->mask), w->bits);
+    }
+}
+
+void bitstring_layout_clear(bitstring_layout_t const* layout, void* packet) {
+    uint8_t* bytes = (uint8_t*) packet;
+
+    for(uint16_t i = 0; i < layout->num_words; i++) {
+        bitstring_word_t const* w = &layout->words[i];
+        _store_word(bytes + w->offset, _load_word(bytes + w->offset, w->len) & ~w->mask, w->len);
+    }
+}
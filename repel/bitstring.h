@@ -45,6 +45,7 @@
 #define BITSTRING_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * Marks position of a single bit in a byte array.
@@ -121,4 +122,57 @@ static inline void bitstring_copy_u64(bitstring_t* dest, bitstring_t* src, uint8
     bitstring_push_u64(dest, extract, bits);
 }
 
+/**
+ * Up to eight packet bytes of a layout, read most significant bit first like a bitstring
+ */
+typedef struct BitstringWord bitstring_word_t;
+struct BitstringWord {
+    /* Bits to scatter, the first byte is the most significant */
+    uint64_t mask;
+    uint16_t offset;
+    /* Bytes from 1 to 8 */
+    uint8_t len;
+    /* Set bits in mask */
+    uint8_t bits;
+};
+
+/**
+ * Precomputed positions of non-contiguous bits in a packet, e.g., where a parser embeds
+ * a MAC in fields separated by other fields. Scattering and gathering move all bits of a
+ * word at once, with the BMI2 instructions PDEP and PEXT if the CPU supports them.
+ */
+typedef struct BitstringLayout bitstring_layout_t;
+struct BitstringLayout {
+    bitstring_word_t* words;
+    uint16_t num_words;
+    /* Total bits to scatter */
+    uint16_t bits;
+    bool bmi2;
+};
+
+/**
+ * Builds a layout from a mask with the bits to scatter set.
+ *
+ * \param words Storage for the layout, ceil(mask_len / 8) words always suffice.
+ * \param mask Packet sized mask, most significant bit first like a bitstring.
+ * \return False if the words do not suffice.
+ */
+bool bitstring_layout_init(bitstring_layout_t* layout, bitstring_word_t* words, uint16_t max_words,
+    void const* mask, uint16_t mask_len);
+
+/**
+ * Moves layout->bits bits from src to the masked bits of the packet, in order.
+ */
+void bitstring_scatter(bitstring_layout_t const* layout, void* packet, bitstring_t* src);
+
+/**
+ * Moves the masked bits of the packet to dest, in order.
+ */
+void bitstring_gather(bitstring_layout_t const* layout, void const* packet, bitstring_t* dest);
+
+/**
+ * Zeroes the masked bits of the packet.
+ */
+void bitstring_layout_clear(bitstring_layout_t const* layout, void* packet);
+
 #endif
\ No newline at end of file
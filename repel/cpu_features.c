@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "cpu_features.h"
+#include "repel_types.h"
+
+#if REPEL_USE_CPU_EXTENSIONS
+
+#include <cpuid.h>
+
+/* CPUID leaf 1, register ECX */
+#define CPUID1_ECX_PCLMUL   (1u << 1)
+#define CPUID1_ECX_SSSE3    (1u << 9)
+#define CPUID1_ECX_SSE41    (1u << 19)
+#define CPUID1_ECX_AESNI    (1u << 25)
+
+/* CPUID leaf 7 subleaf 0, register EBX */
+#define CPUID7_EBX_BMI2     (1u << 8)
+
+bool cpu_has_feature(cpu_feature_t feature) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if(feature == CPU_FEATURE_BMI2) {
+        /* Fails if the CPU does not support leaf 7 */
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & CPUID7_EBX_BMI2) != 0;
+    }
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+
+    switch(feature) {
+        case CPU_FEATURE_AESNI:
+            return (ecx & CPUID1_ECX_AESNI) != 0;
+        case CPU_FEATURE_PCLMUL:
+            return (ecx & CPUID1_ECX_PCLMUL) != 0;
+        case CPU_FEATURE_SSSE3:
+            return (ecx & CPUID1_ECX_SSSE3) != 0;
+        case CPU_FEATURE_SSE41:
+            return (ecx & CPUID1_ECX_SSE41) != 0;
+        default:
+            return false;
+    }
+}
+
+#else /* REPEL_USE_CPU_EXTENSIONS */
+
+bool cpu_has_feature(cpu_feature_t feature) {
+    UNUSED(feature);
+    return false;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Runtime detection of optional CPU instruction set extensions.
+ * MAC modules and bitstring layouts use it to choose between accelerated and portable code paths.
+ * On platforms other than x86, all extensions are reported as missing.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef CPU_FEATURES_H_
+#define CPU_FEATURES_H_
+
+#include <stdbool.h>
+
+/**
+ * Set to false to compile only the portable code paths, e.g., to evaluate
+ * them on a machine that supports the extensions.
+ */
+#ifndef REPEL_USE_CPU_EXTENSIONS
+#if defined(__x86_64__) || defined(__i386__)
+#define REPEL_USE_CPU_EXTENSIONS true
+#else
+#define REPEL_USE_CPU_EXTENSIONS false
+#endif
+#endif
+
+enum CpuFeature {
+    CPU_FEATURE_AESNI,
+    CPU_FEATURE_PCLMUL,
+    CPU_FEATURE_SSSE3,
+    CPU_FEATURE_SSE41,
+    CPU_FEATURE_BMI2
+};
+typedef enum CpuFeature cpu_feature_t;
+
+/**
+ * \return Whether the executing CPU supports an instruction set extension.
+ * Always false if REPEL_USE_CPU_EXTENSIONS is disabled.
+ */
+bool cpu_has_feature(cpu_feature_t feature);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Table driven CRC-16 calculation for parsers of serial protocols, which
+ * recompute the checksum of frames they modify.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Table slices, 8 processes eight bytes per step with 4 KiB of tables per CRC.
+ * 1 processes one byte per step with 512 bytes, e.g., for constrained devices.
+ */
+#ifndef CRC16_SLICES
+#ifdef CONTIKI
+#define CRC16_SLICES 1
+#else
+#define CRC16_SLICES 8
+#endif
+#endif
+
+/**
+ * CRC-16/MODBUS of Modbus RTU frames: reflected polynomial 0x8005, initial value 0xffff, no final xor.
+ * Transmitted least significant byte first.
+ */
+uint16_t crc16_modbus(void const* data, size_t len);
+
+/**
+ * CRC-16/DNP of DNP3 link-layer blocks: reflected polynomial 0x3d65, initial value 0, final xor 0xffff.
+ * Transmitted least significant byte first.
+ */
+uint16_t crc16_dnp(void const* data, size_t len);
+
+#endif
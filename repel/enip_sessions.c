@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Open addressing hash table of EtherNet/IP sessions.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "enip_sessions.h"
+
+#include <string.h>
+
+#include "platform.h"
+
+/**
+ * Session handle zero is invalid and marks free slots
+ */
+struct Session {
+    uint32_t handle;
+    repel_connection_t con;
+};
+
+struct EnipSessions {
+    uint32_t count;
+    uint32_t max_sessions;
+    /**
+     * Power of two, at least twice max_sessions to keep probe sequences short
+     */
+    uint32_t mask;
+    uint8_t shift;
+    struct Session slots[];
+};
+
+/**
+ * Fibonacci hashing, handles are often sequential or random
+ */
+static inline uint32_t _slot(enip_sessions_t const* sessions, uint32_t handle) {
+    return (handle * 2654435769u) >> sessions->shift;
+}
+
+enip_sessions_t* enip_sessions_create(uint32_t max_sessions) {
+    uint8_t bits = 1;
+    while(bits < 31 && (1u << bits) < 2 * max_sessions) {
+        bits++;
+    }
+
+    uint32_t const num_slots = 1u << bits;
+    enip_sessions_t* sessions = (enip_sessions_t*) mem_alloc(sizeof(enip_sessions_t) + num_slots * sizeof(struct Session));
+    if(!sessions) {
+        error("Out of memory: Creating session table failed");
+        return NULL;
+    }
+    memset(sessions, 0, sizeof(enip_sessions_t) + num_slots * sizeof(struct Session));
+    sessions->max_sessions = max_sessions;
+    sessions->mask = num_slots - 1;
+    sessions->shift = 32 - bits;
+    return sessions;
+}
+
+void enip_sessions_destroy(enip_sessions_t* sessions) {
+    mem_free(sessions);
+}
+
+bool enip_sessions_add(enip_sessions_t* sessions, uint32_t handle, repel_connection_t con) {
+    if(handle == 0) {
+        return false;
+    }
+
+    uint32_t i = _slot(sessions, handle);
+    while(sessions->slots[i].handle != 0 && sessions->slots[i].handle != handle) {
+        i = (i + 1) & sessions->mask;
+    }
+    if(sessions->slots[i].handle == 0) {
+        if(sessions->count == sessions->max_sessions) {
+            warn("Session table full");
+            return false;
+        }
+        sessions->count++;
+    }
+    sessions->slots[i].handle = handle;
+    sessions->slots[i].con = con;
+    return true;
+}
+
+repel_connection_t enip_sessions_lookup(enip_sessions_t const* sessions, uint32_t handle) {
+    if(handle == 0) {
+        return NULL;
+    }
+
+    /* Terminates, as at least half of the slots are free */
+    uint32_t i = _slot(sessions, handle);
+    while(sessions->slots[i].handle != 0) {
+        if(sessions->slots[i].handle == handle) {
+            return sessions->slots[i].con;
+        }
+        i = (i + 1) & sessions->mask;
+    }
+    return NULL;
+}
+
+void enip_sessions_remove(enip_sessions_t* sessions, uint32_t handle) {
+    if(handle == 0) {
+        return;
+    }
+
+    uint32_t i = _slot(sessions, handle);
+    while(sessions->slots[i].handle != handle) {
+        if(sessions->slots[i].handle == 0) {
+            return;
+        }
+        i = (i + 1) & sessions->mask;
+    }
+
+    /* Shift following entries back instead of leaving tombstones */
+    uint32_t j = i;
+    while(true) {
+        j = (j + 1) & sessions->mask;
+        if(sessions->slots[j].handle == 0) {
+            break;
+        }
+        /* Entry at j may move to i if its home slot is not cyclically within (i, j] */
+        uint32_t const home = _slot(sessions, sessions->slots[j].handle);
+        if(((j - home) & sessions->mask) >= ((j - i) & sessions->mask)) {
+            sessions->slots[i] = sessions->slots[j];
+            i = j;
+        }
+    }
+    sessions->slots[i].handle = 0;
+    sessions->slots[i].con = NULL;
+    sessions->count--;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Maps EtherNet/IP session handles to RePeL connections, so that a gateway
+ * finds the connection of a packet with a single hash lookup.
+ *
+ * The table is an open addressing hash table with linear probing, sized at
+ * creation, so adding, looking up, and removing sessions never allocate.
+ * Targets assign session handles in their RegisterSession reply, which the
+ * gateway authenticates with the device's connection before adding the session.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef ENIP_SESSIONS_H_
+#define ENIP_SESSIONS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "repel.h"
+
+typedef struct EnipSessions enip_sessions_t;
+
+/**
+ * Creates a session table.
+ *
+ * \param max_sessions Sessions the table holds at most.
+ * \return Table or NULL when out of memory.
+ */
+enip_sessions_t* enip_sessions_create(uint32_t max_sessions);
+
+/**
+ * Frees the table, but not the connections it holds.
+ */
+void enip_sessions_destroy(enip_sessions_t* sessions);
+
+/**
+ * Maps a session handle to a connection, replacing a previous mapping of the handle.
+ *
+ * \return False if the handle is zero or the table is full.
+ */
+bool enip_sessions_add(enip_sessions_t* sessions, uint32_t handle, repel_connection_t con);
+
+/**
+ * \return Connection of the session, NULL if unknown.
+ */
+repel_connection_t enip_sessions_lookup(enip_sessions_t const* sessions, uint32_t handle);
+
+/**
+ * Forgets a session, e.g., on UnRegisterSession.
+ */
+void enip_sessions_remove(enip_sessions_t* sessions, uint32_t handle);
+
+/**
+ * Session handle of an encapsulated packet, zero if the packet is shorter than the header.
+ * The parser does not embed in the handle, so it can be read before authentication.
+ */
+static inline uint32_t enip_session_handle(void const* packet, uint16_t len) {
+    uint8_t const* bytes = (uint8_t const*) packet;
+    if(len < 24) {
+        return 0;
+    }
+    return bytes[4] | (bytes[5] << 8) | ((uint32_t) bytes[6] << 16) | ((uint32_t) bytes[7] << 24);
+}
+
+#endif
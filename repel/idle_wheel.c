@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Hierarchical timing wheel for idle connections.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "idle_wheel.h"
+
+#include <string.h>
+
+#include "platform.h"
+
+#define IDLE_WHEEL_SLOTS    (1u << IDLE_WHEEL_SLOT_BITS)
+#define IDLE_WHEEL_MASK     (IDLE_WHEEL_SLOTS - 1)
+
+struct IdleEntry {
+    idle_entry_t* next;
+    /**
+     * Link that points to this entry, for removal in constant time
+     */
+    idle_entry_t** pprev;
+    repel_connection_t con;
+    uint32_t expires;
+    uint16_t id_len;
+    uint8_t id[];
+};
+
+/**
+ * Serialized state of an evicted connection
+ */
+struct Snapshot {
+    struct Snapshot* next;
+    /**
+     * Neighbors in the order of snapshotting, to drop the oldest
+     */
+    struct Snapshot* newer;
+    struct Snapshot* older;
+    uint32_t hash;
+    uint16_t id_len;
+    uint16_t len;
+    /**
+     * Device id followed by state
+     */
+    uint8_t data[];
+};
+
+struct IdleWheel {
+    uint32_t now;
+    uint32_t timeout;
+    /**
+     * Scheduled entries
+     */
+    uint32_t count;
+    idle_evict_fn_t* evict;
+    idle_drop_fn_t* drop;
+    void* ctx;
+    uint16_t snapshot_size;
+    uint32_t snapshot_count;
+    uint32_t max_snapshots;
+    struct Snapshot* oldest;
+    struct Snapshot* newest;
+    /**
+     * Power of two, grows with the snapshots
+     */
+    uint32_t num_buckets;
+    struct Snapshot** buckets;
+    idle_entry_t* slots[IDLE_WHEEL_LEVELS][IDLE_WHEEL_SLOTS];
+};
+
+/**
+ * FNV-1a
+ */
+static uint32_t _hash(uint8_t const* id, uint16_t len) {
+    uint32_t h = 2166136261u;
+    for(uint16_t i = 0; i < len; i++) {
+        h = (h ^ id[i]) * 16777619u;
+    }
+    return h;
+}
+
+idle_wheel_t* idle_wheel_create(uint32_t timeout, uint16_t snapshot_size, uint32_t max_snapshots,
+    idle_evict_fn_t* evict, idle_drop_fn_t* drop, void* ctx) {
+
+    if(timeout == 0 || timeout >> (IDLE_WHEEL_LEVELS * IDLE_WHEEL_SLOT_BITS) != 0) {
+        error("Idle timeout out of range");
+        return NULL;
+    }
+    if(snapshot_size > 0 && max_snapshots == 0) {
+        error("Idle wheel snapshots need a cap");
+        return NULL;
+    }
+
+    idle_wheel_t* wheel = (idle_wheel_t*) mem_alloc(sizeof(idle_wheel_t));
+    if(!wheel) {
+        error("Out of memory: Creating idle wheel failed");
+        return NULL;
+    }
+    memset(wheel, 0, sizeof(idle_wheel_t));
+    wheel->timeout = timeout;
+    wheel->evict = evict;
+    wheel->drop = drop;
+    wheel->ctx = ctx;
+    wheel->snapshot_size = snapshot_size;
+    wheel->max_snapshots = max_snapshots;
+    return wheel;
+}
+
+void idle_wheel_destroy(idle_wheel_t* wheel) {
+    if(!wheel) {
+        return;
+    }
+    for(uint8_t level = 0; level < IDLE_WHEEL_LEVELS; level++) {
+        for(uint32_t s = 0; s < IDLE_WHEEL_SLOTS; s++) {
+            while(wheel->slots[level][s]) {
+                idle_entry_t* entry = wheel->slots[level][s];
+                wheel->slots[level][s] = entry->next;
+                repel_set_idle_clock(entry->con, NULL);
+                mem_free(entry);
+            }
+        }
+    }
+    for(uint32_t b = 0; b < wheel->num_buckets; b++) {
+        while(wheel->buckets[b]) {
+            struct Snapshot* snapshot = wheel->buckets[b];
+            wheel->buckets[b] = snapshot->next;
+            mem_free(snapshot);
+        }
+    }
+    mem_free(wheel->buckets);
+    mem_free(wheel);
+}
+
+/**
+ * Links the entry into the slot of its expiry, on the coarsest level that resolves it
+ */
+static void _schedule(idle_wheel_t* wheel, idle_entry_t* entry) {
+    uint32_t const delta = entry->expires - wheel->now;
+    uint8_t level = 0;
+
+    while(level + 1 < IDLE_WHEEL_LEVELS && delta >> ((level + 1) * IDLE_WHEEL_SLOT_BITS) != 0) {
+        level++;
+    }
+
+    idle_entry_t** slot = &wheel->slots[level][(entry->expires >> (level * IDLE_WHEEL_SLOT_BITS)) & IDLE_WHEEL_MASK];
+    entry->next = *slot;
+    if(entry->next) {
+        entry->next->pprev = &entry->next;
+    }
+    entry->pprev = slot;
+    *slot = entry;
+}
+
+static void _unlink(idle_entry_t* entry) {
+    *entry->pprev = entry->next;
+    if(entry->next) {
+        entry->next->pprev = entry->pprev;
+    }
+}
+
+idle_entry_t* idle_wheel_add(idle_wheel_t* wheel, repel_connection_t con, void const* device_id, uint16_t id_len) {
+    idle_entry_t* entry = (idle_entry_t*) mem_alloc(sizeof(idle_entry_t) + id_len);
+    if(!entry) {
+        error("Out of memory: Adding connection to idle wheel failed");
+        return NULL;
+    }
+    entry->con = con;
+    entry->id_len = id_len;
+    memcpy(entry->id, device_id, id_len);
+
+    repel_set_idle_clock(con, &wheel->now);
+    entry->expires = wheel->now + wheel->timeout;
+    _schedule(wheel, entry);
+    wheel->count++;
+    return entry;
+}
+
+void idle_wheel_remove(idle_wheel_t* wheel, idle_entry_t* entry) {
+    if(entry) {
+        _unlink(entry);
+        wheel->count--;
+        repel_set_idle_clock(entry->con, NULL);
+        mem_free(entry);
+    }
+}
+
+uint32_t idle_wheel_now(idle_wheel_t const* wheel) {
+    return wheel->now;
+}
+
+/**
+ * Doubles the snapshot buckets when they are as many as snapshots
+ */
+static void _grow_buckets(idle_wheel_t* wheel) {
+    uint32_t const num_buckets = wheel->num_buckets ? 2 * wheel->num_buckets : 16;
+    struct Snapshot** buckets = (struct Snapshot**) mem_alloc(num_buckets * sizeof(struct Snapshot*));
+
+    /* Longer chains are fine when out of memory */
+    if(!buckets) {
+        return;
+    }
+    memset(buckets, 0, num_buckets * sizeof(struct Snapshot*));
+    for(uint32_t b = 0; b < wheel->num_buckets; b++) {
+        while(wheel->buckets[b]) {
+            struct Snapshot* snapshot = wheel->buckets[b];
+            wheel->buckets[b] = snapshot->next;
+            snapshot->next = buckets[snapshot->hash & (num_buckets - 1)];
+            buckets[snapshot->hash & (num_buckets - 1)] = snapshot;
+        }
+    }
+    mem_free(wheel->buckets);
+    wheel->buckets = buckets;
+    wheel->num_buckets = num_buckets;
+}
+
+/**
+ * Unlinks a snapshot from its bucket and the age list, and frees it
+ */
+static void _forget(idle_wheel_t* wheel, struct Snapshot** link, struct Snapshot* snapshot) {
+    *link = snapshot->next;
+    if(snapshot->newer) {
+        snapshot->newer->older = snapshot->older;
+    } else {
+        wheel->newest = snapshot->older;
+    }
+    if(snapshot->older) {
+        snapshot->older->newer = snapshot->newer;
+    } else {
+        wheel->oldest = snapshot->newer;
+    }
+    wheel->snapshot_count--;
+    mem_free(snapshot);
+}
+
+/**
+ * Drops the oldest snapshot and tells the caller that its device needs new keys
+ */
+static void _drop_oldest(idle_wheel_t* wheel) {
+    struct Snapshot* oldest = wheel->oldest;
+    struct Snapshot** link = &wheel->buckets[oldest->hash & (wheel->num_buckets - 1)];
+
+    while(*link != oldest) {
+        link = &(*link)->next;
+    }
+    warn("Dropping idle connection snapshot, the device needs new keys");
+    if(wheel->drop) {
+        wheel->drop(wheel->ctx, oldest->data, oldest->id_len);
+    }
+    _forget(wheel, link, oldest);
+}
+
+static void _snapshot(idle_wheel_t* wheel, idle_entry_t const* entry) {
+    if(wheel->snapshot_count >= wheel->max_snapshots) {
+        _drop_oldest(wheel);
+    }
+    if(wheel->snapshot_count >= wheel->num_buckets) {
+        _grow_buckets(wheel);
+        if(wheel->num_buckets == 0) {
+            error("Out of memory: Snapshot of idle connection failed");
+            return;
+        }
+    }
+
+    struct Snapshot* snapshot = (struct Snapshot*) mem_alloc(sizeof(struct Snapshot) + entry->id_len + wheel->snapshot_size);
+    if(!snapshot) {
+        error("Out of memory: Snapshot of idle connection failed");
+        return;
+    }
+    /* Exact state, the connection does not send anymore */
+    snapshot->len = repel_save_live_state(entry->con, snapshot->data + entry->id_len, wheel->snapshot_size, 0);
+    if(snapshot->len == 0) {
+        error("Connection state exceeds snapshot size");
+        mem_free(snapshot);
+        return;
+    }
+    snapshot->hash = _hash(entry->id, entry->id_len);
+    snapshot->id_len = entry->id_len;
+    memcpy(snapshot->data, entry->id, entry->id_len);
+
+    struct Snapshot** bucket = &wheel->buckets[snapshot->hash & (wheel->num_buckets - 1)];
+    snapshot->next = *bucket;
+    *bucket = snapshot;
+
+    snapshot->newer = NULL;
+    snapshot->older = wheel->newest;
+    if(wheel->newest) {
+        wheel->newest->newer = snapshot;
+    } else {
+        wheel->oldest = snapshot;
+    }
+    wheel->newest = snapshot;
+    wheel->snapshot_count++;
+}
+
+bool idle_wheel_reload(idle_wheel_t* wheel, void const* device_id, uint16_t id_len, repel_connection_t con) {
+    if(wheel->snapshot_count == 0) {
+        return false;
+    }
+
+    uint32_t const hash = _hash((uint8_t const*) device_id, id_len);
+    struct Snapshot** link = &wheel->buckets[hash & (wheel->num_buckets - 1)];
+
+    for(; *link; link = &(*link)->next) {
+        struct Snapshot* snapshot = *link;
+        if(snapshot->hash == hash && snapshot->id_len == id_len && memcmp(snapshot->data, device_id, id_len) == 0) {
+            if(!repel_resume_state(con, snapshot->data + id_len, snapshot->len)) {
+                return false;
+            }
+            _forget(wheel, link, snapshot);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Evicts or reschedules entries of the due slot
+ */
+static void _expire(idle_wheel_t* wheel) {
+    /* Unlinked from the wheel, but linked to due, so that callbacks may remove any entry */
+    idle_entry_t* due = wheel->slots[0][wheel->now & IDLE_WHEEL_MASK];
+    wheel->slots[0][wheel->now & IDLE_WHEEL_MASK] = NULL;
+    if(due) {
+        due->pprev = &due;
+    }
+
+    while(due) {
+        idle_entry_t* entry = due;
+        _unlink(entry);
+
+        uint32_t const last_seen = repel_last_seen(entry->con);
+        if(wheel->now - last_seen < wheel->timeout) {
+            /* Seen since scheduled */
+            entry->expires = last_seen + wheel->timeout;
+            _schedule(wheel, entry);
+            continue;
+        }
+
+        wheel->count--;
+        if(wheel->snapshot_size > 0) {
+            _snapshot(wheel, entry);
+        }
+        repel_set_idle_clock(entry->con, NULL);
+        if(wheel->evict) {
+            wheel->evict(wheel->ctx, entry->con, entry->id, entry->id_len);
+        }
+        mem_free(entry);
+    }
+}
+
+void idle_wheel_advance(idle_wheel_t* wheel, uint32_t ticks) {
+    for(; ticks > 0; ticks--) {
+        if(wheel->count == 0) {
+            wheel->now += ticks;
+            return;
+        }
+        wheel->now++;
+
+        /* Levels whose finer levels wrapped around, coarsest first */
+        uint8_t top = 0;
+        while(top + 1 < IDLE_WHEEL_LEVELS && (wheel->now & ((1u << ((top + 1) * IDLE_WHEEL_SLOT_BITS)) - 1)) == 0) {
+            top++;
+        }
+        for(uint8_t level = top; level > 0; level--) {
+            idle_entry_t** slot = &wheel->slots[level][(wheel->now >> (level * IDLE_WHEEL_SLOT_BITS)) & IDLE_WHEEL_MASK];
+            idle_entry_t* entry = *slot;
+            *slot = NULL;
+            while(entry) {
+                idle_entry_t* next = entry->next;
+                _schedule(wheel, entry);
+                entry = next;
+            }
+        }
+
+        _expire(wheel);
+    }
+}
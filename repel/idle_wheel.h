@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Evicts idle connections with a hierarchical timing wheel, so that gateways
+ * do not accumulate state of devices that disappeared.
+ *
+ * Connections record the wheel's tick on every packet they embed or verify,
+ * see repel_set_idle_clock, which leaves the wheel untouched on the packet
+ * path. Connections are scheduled once per timeout instead. When their slot
+ * expires, they are either evicted or rescheduled relative to their last
+ * packet. Adding, removing, and expiring connections take constant time, and
+ * advancing the wheel only visits due slots.
+ *
+ * Evicted connections may be snapshotted, which keeps their serialized state
+ * to resume it in a new connection when the device shows up again. Snapshots
+ * are capped, beyond the cap the oldest is dropped. A device whose snapshot was
+ * dropped would repeat nonces with its keys, so the drop callback lets the
+ * caller replace its keys, e.g., by marking it for re-keying.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef IDLE_WHEEL_H_
+#define IDLE_WHEEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "repel.h"
+
+/**
+ * Slots per level are 2^IDLE_WHEEL_SLOT_BITS, timeouts must be below 2^(IDLE_WHEEL_LEVELS * IDLE_WHEEL_SLOT_BITS) ticks.
+ */
+#define IDLE_WHEEL_LEVELS       4
+#define IDLE_WHEEL_SLOT_BITS    6
+
+typedef struct IdleWheel idle_wheel_t;
+typedef struct IdleEntry idle_entry_t;
+
+/**
+ * Called with connections that were idle for the timeout, after the wheel forgot them.
+ * The callback typically destroys the connection.
+ */
+typedef void idle_evict_fn_t(void* ctx, repel_connection_t con, void const* device_id, uint16_t id_len);
+
+/**
+ * Called with the device of the oldest snapshot when it is dropped to stay within the cap.
+ * A new connection of the device starts its nonces from zero again, so replace the device's keys
+ * before it connects again.
+ */
+typedef void idle_drop_fn_t(void* ctx, void const* device_id, uint16_t id_len);
+
+/**
+ * Creates an idle wheel.
+ *
+ * \param timeout Idle ticks after which connections are evicted.
+ * \param snapshot_size Maximum serialized state to snapshot of evicted connections, see repel_save_live_state.
+ * Zero disables snapshots.
+ * \param max_snapshots Snapshots kept at most, required with snapshots.
+ * \param drop Called for dropped snapshots, may be NULL.
+ * \return Wheel or NULL when out of memory, the timeout is too long, or snapshots have no cap.
+ */
+idle_wheel_t* idle_wheel_create(uint32_t timeout, uint16_t snapshot_size, uint32_t max_snapshots,
+    idle_evict_fn_t* evict, idle_drop_fn_t* drop, void* ctx);
+
+/**
+ * Frees the wheel and its snapshots, but not the connections it holds.
+ */
+void idle_wheel_destroy(idle_wheel_t* wheel);
+
+/**
+ * Schedules a connection for eviction and sets its idle clock to the wheel's tick.
+ *
+ * \param device_id Identifies the connection's snapshot and is passed to the eviction callback.
+ * \return Handle to remove the connection, NULL when out of memory.
+ */
+idle_entry_t* idle_wheel_add(idle_wheel_t* wheel, repel_connection_t con, void const* device_id, uint16_t id_len);
+
+/**
+ * Forgets a connection without evicting it, e.g., before destroying it.
+ */
+void idle_wheel_remove(idle_wheel_t* wheel, idle_entry_t* entry);
+
+/**
+ * Advances the wheel's tick and evicts connections that became idle.
+ */
+void idle_wheel_advance(idle_wheel_t* wheel, uint32_t ticks);
+
+/**
+ * Current tick, which connections of the wheel record as last seen.
+ */
+uint32_t idle_wheel_now(idle_wheel_t const* wheel);
+
+/**
+ * Resumes the snapshot of an evicted connection of the device in con and drops the snapshot.
+ * The connection must use the same parser and MAC modules, and hold the device's keys.
+ *
+ * \return Whether a snapshot was resumed.
+ */
+bool idle_wheel_reload(idle_wheel_t* wheel, void const* device_id, uint16_t id_len, repel_connection_t con);
+
+#endif
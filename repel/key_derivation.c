@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * HKDF-SHA256 key provider with LRU cache.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "key_derivation.h"
+
+#include <string.h>
+
+#include "tinydtls.h"
+#include "dtls-hmac.h"
+
+#include "platform.h"
+#include "repel_types.h"
+
+#define KEY_SIZE    16
+#define NO_ENTRY    UINT16_MAX
+
+/**
+ * HKDF info prefix, followed by the device identity
+ */
+static uint8_t const hkdf_info_label[] = { 'R', 'e', 'P', 'e', 'L', ' ', 'k', 'e', 'y', 's' };
+
+struct CacheEntry {
+    /**
+     * Client to server key first
+     */
+    uint8_t keys[2][KEY_SIZE];
+    uint8_t id[HKDF_MAX_CACHED_ID_LEN];
+    uint16_t id_len;
+    uint32_t hash;
+    /**
+     * Next entry in the same hash bucket
+     */
+    uint16_t bucket_next;
+    /**
+     * Neighbors in LRU order, towards most and least recently used
+     */
+    uint16_t newer, older;
+};
+
+struct HkdfKeyProvider {
+    /**
+     * HMAC keyed with the pseudorandom key, after the inner key block
+     */
+    dtls_hmac_context_t prk;
+    key_role_t role;
+
+    uint16_t capacity;
+    uint16_t used;
+    uint16_t newest, oldest;
+    /**
+     * Power of two
+     */
+    uint16_t num_buckets;
+    uint16_t* buckets;
+    struct CacheEntry* entries;
+};
+
+/**
+ * FNV-1a
+ */
+static uint32_t _hash(uint8_t const* id, uint16_t len) {
+    uint32_t h = 2166136261u;
+    for(uint16_t i = 0; i < len; i++) {
+        h = (h ^ id[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * HKDF-Expand to one hash length: T(1) = HMAC(PRK, info || 0x01)
+ */
+static void _expand(hkdf_key_provider_t const* self, uint8_t const* id, uint16_t id_len, uint8_t okm[2][KEY_SIZE]) {
+    dtls_hmac_context_t ctx;
+    uint8_t const counter = 1;
+
+    memcpy(&ctx, &self->prk, sizeof(ctx));
+    dtls_hmac_update(&ctx, hkdf_info_label, sizeof(hkdf_info_label));
+    dtls_hmac_update(&ctx, id, id_len);
+    dtls_hmac_update(&ctx, &counter, 1);
+    dtls_hmac_finalize(&ctx, &okm[0][0]);
+}
+
+/**********************************************************
+ *                        LRU cache                       *
+ **********************************************************/
+
+static void _lru_unlink(hkdf_key_provider_t* self, uint16_t e) {
+    struct CacheEntry* entry = &self->entries[e];
+
+    if(entry->newer != NO_ENTRY) {
+        self->entries[entry->newer].older = entry->older;
+    } else {
+        self->newest = entry->older;
+    }
+    if(entry->older != NO_ENTRY) {
+        self->entries[entry->older].newer = entry->newer;
+    } else {
+        self->oldest = entry->newer;
+    }
+}
+
+static void _lru_push(hkdf_key_provider_t* self, uint16_t e) {
+    struct CacheEntry* entry = &self->entries[e];
+
+    entry->newer = NO_ENTRY;
+    entry->older = self->newest;
+    if(self->newest != NO_ENTRY) {
+        self->entries[self->newest].newer = e;
+    } else {
+        self->oldest = e;
+    }
+    self->newest = e;
+}
+
+static void _bucket_remove(hkdf_key_provider_t* self, uint16_t e) {
+    uint16_t* link = &self->buckets[self->entries[e].hash & (self->num_buckets - 1)];
+    while(*link != e) {
+        link = &self->entries[*link].bucket_next;
+    }
+    *link = self->entries[e].bucket_next;
+}
+
+static uint16_t _cache_find(hkdf_key_provider_t const* self, uint8_t const* id, uint16_t id_len, uint32_t hash) {
+    uint16_t e = self->buckets[hash & (self->num_buckets - 1)];
+    while(e != NO_ENTRY) {
+        struct CacheEntry const* entry = &self->entries[e];
+        if(entry->hash == hash && entry->id_len == id_len && memcmp(entry->id, id, id_len) == 0) {
+            return e;
+        }
+        e = entry->bucket_next;
+    }
+    return NO_ENTRY;
+}
+
+/**
+ * \return A free entry, evicting the least recently used one if the cache is full.
+ */
+static uint16_t _cache_alloc(hkdf_key_provider_t* self) {
+    if(self->used < self->capacity) {
+        return self->used++;
+    }
+    uint16_t const e = self->oldest;
+    _lru_unlink(self, e);
+    _bucket_remove(self, e);
+    return e;
+}
+
+/**********************************************************
+ *                       Interface                        *
+ **********************************************************/
+
+hkdf_key_provider_t* hkdf_key_provider_create(uint8_t const* master, uint16_t master_len,
+    uint8_t const* salt, uint16_t salt_len, key_role_t role, uint16_t cache_entries) {
+
+    hkdf_key_provider_t* self;
+    uint16_t buckets = 1;
+
+    if(cache_entries == NO_ENTRY) {
+        cache_entries--;
+    }
+    /* Average chain length of at most one */
+    while(buckets < cache_entries && buckets < 0x8000) {
+        buckets <<= 1;
+    }
+
+    self = (hkdf_key_provider_t*) mem_alloc(sizeof(hkdf_key_provider_t)
+        + cache_entries * sizeof(struct CacheEntry) + buckets * sizeof(uint16_t));
+    if(!self) {
+        return NULL;
+    }
+
+    self->role = role;
+    self->capacity = cache_entries;
+    self->used = 0;
+    self->newest = NO_ENTRY;
+    self->oldest = NO_ENTRY;
+    self->num_buckets = buckets;
+    self->entries = (struct CacheEntry*) (self + 1);
+    self->buckets = (uint16_t*) (self->entries + cache_entries);
+    memset(self->buckets, 0xff, buckets * sizeof(uint16_t));
+
+    /* HKDF-Extract: PRK = HMAC(salt, master), salt defaults to a hash length of zeros */
+    uint8_t prk[DTLS_HMAC_DIGEST_SIZE];
+    uint8_t const zeros[DTLS_HMAC_DIGEST_SIZE] = { 0 };
+
+    if(!salt) {
+        salt = zeros;
+        salt_len = sizeof(zeros);
+    }
+    dtls_hmac_init(&self->prk, salt, salt_len);
+    dtls_hmac_update(&self->prk, master, master_len);
+    dtls_hmac_finalize(&self->prk, prk);
+
+    dtls_hmac_init(&self->prk, prk, sizeof(prk));
+    memset(prk, 0, sizeof(prk));
+
+    return self;
+}
+
+void hkdf_key_provider_destroy(hkdf_key_provider_t* self) {
+    if(self) {
+        memset(self, 0, sizeof(hkdf_key_provider_t) + self->capacity * sizeof(struct CacheEntry));
+        mem_free(self);
+    }
+}
+
+void hkdf_derive_keys(hkdf_key_provider_t* self, void const* device_id, uint16_t id_len, uint8_t keys[2][16]) {
+    uint8_t const* id = (uint8_t const*) device_id;
+    uint8_t okm[2][KEY_SIZE];
+    uint8_t (*derived)[KEY_SIZE] = okm;
+
+    if(self->capacity > 0 && id_len <= HKDF_MAX_CACHED_ID_LEN) {
+        uint32_t const hash = _hash(id, id_len);
+        uint16_t e = _cache_find(self, id, id_len, hash);
+
+        if(e == NO_ENTRY) {
+            e = _cache_alloc(self);
+            struct CacheEntry* entry = &self->entries[e];
+
+            _expand(self, id, id_len, entry->keys);
+            memcpy(entry->id, id, id_len);
+            entry->id_len = id_len;
+            entry->hash = hash;
+
+            uint16_t* bucket = &self->buckets[hash & (self->num_buckets - 1)];
+            entry->bucket_next = *bucket;
+            *bucket = e;
+        } else {
+            _lru_unlink(self, e);
+        }
+        _lru_push(self, e);
+        derived = self->entries[e].keys;
+    } else {
+        _expand(self, id, id_len, okm);
+    }
+
+    /* Clients send with the client to server key */
+    uint8_t const send = self->role == KEY_ROLE_CLIENT ? 0 : 1;
+    memcpy(keys[0], derived[send], KEY_SIZE);
+    memcpy(keys[1], derived[1 - send], KEY_SIZE);
+    memset(okm, 0, sizeof(okm));
+}
+
+bool hkdf_set_keys(void* ctx, repel_connection_t con, void const* device_id, uint16_t id_len) {
+    uint8_t keys[2][KEY_SIZE];
+
+    hkdf_derive_keys((hkdf_key_provider_t*) ctx, device_id, id_len, keys);
+    repel_set_keys(con, keys);
+    memset(keys, 0, sizeof(keys));
+    return true;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Key provider that derives the keys of each device on demand with
+ * HKDF-SHA256 (RFC 5869) from a master secret and the device identity.
+ * Derived keys are kept in a bounded LRU cache, so that neither startup time
+ * nor memory depend on the number of devices.
+ *
+ * Keys have the format of the hmac module, i.e., one 16 byte key each for
+ * send and receive directions.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef KEY_DERIVATION_H_
+#define KEY_DERIVATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "repel.h"
+
+/**
+ * Device identities up to this length are cached, longer ones are derived every time.
+ */
+#ifndef HKDF_MAX_CACHED_ID_LEN
+#define HKDF_MAX_CACHED_ID_LEN  32
+#endif
+
+/**
+ * Which end of connections the provider derives keys for.
+ * Keys are derived per direction, so that clients send with the key servers receive with.
+ */
+enum KeyRole {
+    KEY_ROLE_CLIENT, KEY_ROLE_SERVER
+};
+typedef enum KeyRole key_role_t;
+
+typedef struct HkdfKeyProvider hkdf_key_provider_t;
+
+/**
+ * Creates a key provider. Runs HKDF-Extract once, the master secret is not kept.
+ *
+ * \param salt Optional HKDF salt, may be NULL.
+ * \param cache_entries Number of devices to cache keys for, 0 disables the cache.
+ * \return Provider or NULL when out of memory.
+ */
+hkdf_key_provider_t* hkdf_key_provider_create(uint8_t const* master, uint16_t master_len,
+    uint8_t const* salt, uint16_t salt_len, key_role_t role, uint16_t cache_entries);
+
+void hkdf_key_provider_destroy(hkdf_key_provider_t* self);
+
+/**
+ * Writes the send and receive keys of a device to keys.
+ */
+void hkdf_derive_keys(hkdf_key_provider_t* self, void const* device_id, uint16_t id_len, uint8_t keys[2][16]);
+
+/**
+ * Key provider hook for repel_create_device_connection with an hkdf_key_provider_t as ctx.
+ */
+bool hkdf_set_keys(void* ctx, repel_connection_t con, void const* device_id, uint16_t id_len);
+
+static inline repel_key_provider_t hkdf_key_provider(hkdf_key_provider_t* self) {
+    return (repel_key_provider_t) { &hkdf_set_keys, self };
+}
+
+#endif
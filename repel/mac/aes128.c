@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * AES-128 encryption with AES-NI and constant-time software implementations.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "aes128.h"
+
+#include <string.h>
+
+#include "../cpu_features.h"
+
+#if REPEL_USE_CPU_EXTENSIONS
+#include <wmmintrin.h>
+#endif
+
+/**********************************************************
+ *               Software implementation                  *
+ **********************************************************/
+
+/**
+ * Bitsliced GF(2^8) multiplication modulo x^8 + x^4 + x^3 + x + 1.
+ * Bit plane i holds bit i of up to 16 field elements, one per bit lane.
+ * out may alias a or b.
+ */
+static void _gf_mul_sliced(uint16_t out[8], uint16_t const a[8], uint16_t const b[8]) {
+    uint16_t c[15];
+    memset(c, 0, sizeof(c));
+
+    for(uint8_t i = 0; i < 8; i++) {
+        for(uint8_t j = 0; j < 8; j++) {
+            c[i + j] ^= a[i] & b[j];
+        }
+    }
+    for(uint8_t k = 14; k >= 8; k--) {
+        c[k - 4] ^= c[k];
+        c[k - 5] ^= c[k];
+        c[k - 7] ^= c[k];
+        c[k - 8] ^= c[k];
+    }
+    memcpy(out, c, 8 * sizeof(uint16_t));
+}
+
+/**
+ * Applies the AES S-box to up to 16 bytes at once without table lookups:
+ * multiplicative inverse as x^254, followed by the affine transformation.
+ */
+static void _sub_bytes(uint8_t* bytes, uint8_t n) {
+    uint16_t x[8], x2[8], x3[8], x12[8], x14[8], t[8];
+
+    /* Transpose bytes into bit planes */
+    for(uint8_t b = 0; b < 8; b++) {
+        x[b] = 0;
+        for(uint8_t i = 0; i < n; i++) {
+            x[b] |= (uint16_t) (((bytes[i] >> b) & 1) << i);
+        }
+    }
+
+    _gf_mul_sliced(x2, x, x);
+    _gf_mul_sliced(x3, x2, x);
+    _gf_mul_sliced(t, x3, x3);
+    _gf_mul_sliced(x12, t, t);
+    _gf_mul_sliced(x14, x12, x2);
+    _gf_mul_sliced(t, x12, x3);
+    /* x^15 -> x^240 */
+    for(uint8_t i = 0; i < 4; i++) {
+        _gf_mul_sliced(t, t, t);
+    }
+    _gf_mul_sliced(t, t, x14);
+
+    /* Affine transformation, constant 0x63 */
+    for(uint8_t b = 0; b < 8; b++) {
+        x[b] = t[b] ^ t[(b + 4) % 8] ^ t[(b + 5) % 8] ^ t[(b + 6) % 8] ^ t[(b + 7) % 8];
+        if((0x63 >> b) & 1) {
+            x[b] = ~x[b];
+        }
+    }
+
+    /* Transpose back */
+    for(uint8_t i = 0; i < n; i++) {
+        uint8_t v = 0;
+        for(uint8_t b = 0; b < 8; b++) {
+            v |= (uint8_t) (((x[b] >> i) & 1) << b);
+        }
+        bytes[i] = v;
+    }
+}
+
+static inline uint8_t _xtime(uint8_t a) {
+    return (uint8_t) ((a << 1) ^ (0x1b & -(a >> 7)));
+}
+
+static void _add_round_key(uint8_t s[AES128_BLOCK_SIZE], uint8_t const rk[AES128_BLOCK_SIZE]) {
+    for(uint8_t i = 0; i < AES128_BLOCK_SIZE; i++) {
+        s[i] ^= rk[i];
+    }
+}
+
+static void _shift_rows(uint8_t s[AES128_BLOCK_SIZE]) {
+    uint8_t t[AES128_BLOCK_SIZE];
+    for(uint8_t c = 0; c < 4; c++) {
+        for(uint8_t r = 0; r < 4; r++) {
+            t[c*4 + r] = s[((c + r) % 4)*4 + r];
+        }
+    }
+    memcpy(s, t, AES128_BLOCK_SIZE);
+}
+
+static void _mix_columns(uint8_t s[AES128_BLOCK_SIZE]) {
+    for(uint8_t c = 0; c < 4; c++) {
+        uint8_t* a = s + c*4;
+        uint8_t const a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+        uint8_t const t = a0 ^ a1 ^ a2 ^ a3;
+
+        a[0] = a0 ^ t ^ _xtime(a0 ^ a1);
+        a[1] = a1 ^ t ^ _xtime(a1 ^ a2);
+        a[2] = a2 ^ t ^ _xtime(a2 ^ a3);
+        a[3] = a3 ^ t ^ _xtime(a3 ^ a0);
+    }
+}
+
+static void _sw_encrypt(aes128_ctx_t const* ctx, uint8_t s[AES128_BLOCK_SIZE]) {
+    _add_round_key(s, ctx->round_keys[0]);
+    for(uint8_t r = 1; r < AES128_ROUNDS; r++) {
+        _sub_bytes(s, AES128_BLOCK_SIZE);
+        _shift_rows(s);
+        _mix_columns(s);
+        _add_round_key(s, ctx->round_keys[r]);
+    }
+    _sub_bytes(s, AES128_BLOCK_SIZE);
+    _shift_rows(s);
+    _add_round_key(s, ctx->round_keys[AES128_ROUNDS]);
+}
+
+/**********************************************************
+ *                   AES-NI implementation                *
+ **********************************************************/
+
+#if REPEL_USE_CPU_EXTENSIONS
+
+__attribute__((target("aes,sse2")))
+static void _aesni_cbc_mac(aes128_ctx_t const* ctx, uint8_t state[AES128_BLOCK_SIZE], in_buffer_t data, bufsize_t blocks) {
+    __m128i rk[AES128_ROUNDS + 1];
+    for(uint8_t r = 0; r <= AES128_ROUNDS; r++) {
+        rk[r] = _mm_loadu_si128((__m128i const*) ctx->round_keys[r]);
+    }
+
+    __m128i x = _mm_loadu_si128((__m128i const*) state);
+    while(blocks > 0) {
+        x = _mm_xor_si128(x, _mm_loadu_si128((__m128i const*) data));
+        x = _mm_xor_si128(x, rk[0]);
+        for(uint8_t r = 1; r < AES128_ROUNDS; r++) {
+            x = _mm_aesenc_si128(x, rk[r]);
+        }
+        x = _mm_aesenclast_si128(x, rk[AES128_ROUNDS]);
+
+        data += AES128_BLOCK_SIZE;
+        blocks--;
+    }
+    _mm_storeu_si128((__m128i*) state, x);
+}
+
+#endif
+
+/**********************************************************
+ *                      Interface                         *
+ **********************************************************/
+
+void aes128_set_key(aes128_ctx_t* ctx, uint8_t const key[AES128_KEY_SIZE]) {
+    uint8_t rcon = 0x01;
+
+    /* Key expansion is not performance critical, always do it in software */
+    memcpy(ctx->round_keys[0], key, AES128_KEY_SIZE);
+    for(uint8_t r = 1; r <= AES128_ROUNDS; r++) {
+        uint8_t const* prev = ctx->round_keys[r - 1];
+        uint8_t* next = ctx->round_keys[r];
+        uint8_t temp[4] = { prev[13], prev[14], prev[15], prev[12] }; /* RotWord */
+
+        _sub_bytes(temp, 4);
+        temp[0] ^= rcon;
+        rcon = _xtime(rcon);
+
+        for(uint8_t i = 0; i < AES128_BLOCK_SIZE; i++) {
+            next[i] = prev[i] ^ temp[i % 4];
+            temp[i % 4] = next[i];
+        }
+    }
+
+    ctx->aesni = cpu_has_feature(CPU_FEATURE_AESNI);
+}
+
+void aes128_encrypt(aes128_ctx_t const* ctx, uint8_t const in[AES128_BLOCK_SIZE], uint8_t out[AES128_BLOCK_SIZE]) {
+    uint8_t block[AES128_BLOCK_SIZE];
+    memcpy(block, in, AES128_BLOCK_SIZE);
+
+    #if REPEL_USE_CPU_EXTENSIONS
+    if(ctx->aesni) {
+        uint8_t zero[AES128_BLOCK_SIZE];
+        memset(zero, 0, AES128_BLOCK_SIZE);
+        _aesni_cbc_mac(ctx, block, zero, 1);
+        memcpy(out, block, AES128_BLOCK_SIZE);
+        return;
+    }
+    #endif
+
+    _sw_encrypt(ctx, block);
+    memcpy(out, block, AES128_BLOCK_SIZE);
+}
+
+void aes128_cbc_mac(aes128_ctx_t const* ctx, uint8_t state[AES128_BLOCK_SIZE], in_buffer_t data, bufsize_t blocks) {
+    #if REPEL_USE_CPU_EXTENSIONS
+    if(ctx->aesni) {
+        _aesni_cbc_mac(ctx, state, data, blocks);
+        return;
+    }
+    #endif
+
+    while(blocks > 0) {
+        for(uint8_t i = 0; i < AES128_BLOCK_SIZE; i++) {
+            state[i] ^= data[i];
+        }
+        _sw_encrypt(ctx, state);
+        data += AES128_BLOCK_SIZE;
+        blocks--;
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * AES-128 block cipher for the MAC modules.
+ * Uses AES-NI where available and a constant-time software implementation
+ * otherwise. The software implementation computes the S-box bitsliced
+ * instead of looking it up in a table, so that its timing does not depend on
+ * key or data.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef AES128_H_
+#define AES128_H_
+
+#include "../repel_types.h"
+
+#include <stdbool.h>
+
+#define AES128_KEY_SIZE     16
+#define AES128_BLOCK_SIZE   16
+#define AES128_ROUNDS       10
+
+typedef struct Aes128Context aes128_ctx_t;
+struct Aes128Context {
+    /**
+     * Expanded key schedule, byte order as in FIPS 197.
+     * The same layout is used by AES-NI and the software implementation.
+     */
+    uint8_t round_keys[AES128_ROUNDS + 1][AES128_BLOCK_SIZE];
+    /**
+     * Whether to use AES-NI, determined when setting the key.
+     */
+    bool aesni;
+};
+
+/**
+ * Expands a key into ctx. Choose the implementation to use.
+ */
+void aes128_set_key(aes128_ctx_t* ctx, uint8_t const key[AES128_KEY_SIZE]);
+
+/**
+ * Encrypts a single block. in and out may overlap.
+ */
+void aes128_encrypt(aes128_ctx_t const* ctx, uint8_t const in[AES128_BLOCK_SIZE], uint8_t out[AES128_BLOCK_SIZE]);
+
+/**
+ * CBC-MAC chaining over full blocks:
+ * state = E(state ^ block) for each of the given blocks.
+ *
+ * \param state Chaining value, updated in place.
+ * \param data Input of blocks * AES128_BLOCK_SIZE bytes.
+ * \param blocks Number of blocks in data.
+ */
+void aes128_cbc_mac(aes128_ctx_t const* ctx, uint8_t state[AES128_BLOCK_SIZE], in_buffer_t data, bufsize_t blocks);
+
+#endif
@@ -0,0 +1,540 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Implementation of truncated HMAC-SHA256 MACs through the Linux kernel crypto
+ * API (AF_ALG). On hosts with hash accelerator drivers, the kernel offloads the
+ * MAC calculation to the accelerator. The kernel completes a hash within sendmsg,
+ * so batches are split into interleaved stripes that a pool of worker threads,
+ * shared by all instances, hashes concurrently through one operation socket each.
+ *
+ * Falls back to TinyDTLS' software HMAC, like the hmac module, when AF_ALG is
+ * unavailable, e.g., on other platforms or kernels without algif_hash.
+ *
+ * Expects the same key format as the hmac module: one 16 byte key each for
+ * send and receive directions.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel_modules.h"
+#include "../repel_log.h"
+
+#include <string.h>
+
+#include "tinydtls.h"
+#include "dtls-hmac.h"
+
+#include "platform.h"
+#include "../eval_timer.h"
+
+/**
+ * Set to false to always use the software fallback.
+ */
+#ifndef REPEL_USE_AFALG
+#ifdef __linux__
+#define REPEL_USE_AFALG true
+#else
+#define REPEL_USE_AFALG false
+#endif
+#endif
+
+/**
+ * Worker threads that hash batch stripes besides the calling thread, zero to hash batches sequentially.
+ * Each instance holds one operation socket per stripe and key slot.
+ */
+#ifndef AFALG_HMAC_WORKERS
+#define AFALG_HMAC_WORKERS 2
+#endif
+
+#if REPEL_USE_AFALG
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/if_alg.h>
+
+#ifndef SOL_ALG
+#define SOL_ALG 279
+#endif
+#endif
+
+#define HMAC_KEY_SIZE   16
+
+#define HMAC_KEYSLOT_SEND   0
+#define HMAC_KEYSLOT_RECV   1
+
+#define AFALG_NO_SOCKET     (-1)
+#define AFALG_STRIPES       (AFALG_HMAC_WORKERS + 1)
+
+struct AfAlgHMacData {
+    /**
+     * Kernel hash transformation per key slot, holds the key.
+     * AFALG_NO_SOCKET when using the software fallback.
+     */
+    int tfm[2];
+    /**
+     * Operation sockets per key slot and batch stripe, accepted once the key is set.
+     * Single packets use the first.
+     */
+    int op[2][AFALG_STRIPES];
+    /**
+     * Keys in send and receive directions, for the software fallback
+     */
+    uint8_t keys[2][HMAC_KEY_SIZE];
+    dtls_hmac_context_t ctx;
+    /**
+     * May be larger, depends on afalg_hmac_create
+     */
+    uint8_t buffer[DTLS_HMAC_DIGEST_SIZE];
+};
+
+/**
+ * Stores the digest of a batch job, truncated, or the job's verification result
+ */
+static void _finish_job(mac_batch_job_t* job, repel_mode_t mode, uint8_t const digest[DTLS_HMAC_DIGEST_SIZE]) {
+    if(mode == EMBED) {
+        memcpy(job->mac, digest, ceil_bits_to_bytes(job->bits));
+    } else {
+        job->result = mac_equal_bits(job->mac, digest, job->bits) ? job->bits : -job->bits;
+    }
+}
+
+/**********************************************************
+ *                  AF_ALG implementation                 *
+ **********************************************************/
+
+#if REPEL_USE_AFALG
+
+static void _afalg_close_ops(struct AfAlgHMacData* data, uint8_t slot) {
+    for(uint8_t i = 0; i < AFALG_STRIPES; i++) {
+        if(data->op[slot][i] != AFALG_NO_SOCKET) {
+            close(data->op[slot][i]);
+            data->op[slot][i] = AFALG_NO_SOCKET;
+        }
+    }
+}
+
+static void _afalg_close(struct AfAlgHMacData* data) {
+    for(uint8_t s = 0; s < 2; s++) {
+        _afalg_close_ops(data, s);
+        if(data->tfm[s] != AFALG_NO_SOCKET) {
+            close(data->tfm[s]);
+            data->tfm[s] = AFALG_NO_SOCKET;
+        }
+    }
+}
+
+static bool _afalg_open(struct AfAlgHMacData* data) {
+    struct sockaddr_alg addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.salg_family = AF_ALG;
+    strcpy((char*) addr.salg_type, "hash");
+    strcpy((char*) addr.salg_name, "hmac(sha256)");
+
+    for(uint8_t s = 0; s < 2; s++) {
+        data->tfm[s] = socket(AF_ALG, SOCK_SEQPACKET, 0);
+        if(data->tfm[s] < 0) {
+            data->tfm[s] = AFALG_NO_SOCKET;
+            _afalg_close(data);
+            return false;
+        }
+        if(bind(data->tfm[s], (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+            _afalg_close(data);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Sets the key of a slot and accepts new operation sockets, as the kernel
+ * refuses operations on keyed hashes before the key is set.
+ */
+static bool _afalg_set_key(struct AfAlgHMacData* data, uint8_t slot, uint8_t const key[HMAC_KEY_SIZE]) {
+    if(setsockopt(data->tfm[slot], SOL_ALG, ALG_SET_KEY, key, HMAC_KEY_SIZE) != 0) {
+        return false;
+    }
+    _afalg_close_ops(data, slot);
+    for(uint8_t i = 0; i < AFALG_STRIPES; i++) {
+        data->op[slot][i] = accept(data->tfm[slot], NULL, NULL);
+        if(data->op[slot][i] < 0) {
+            data->op[slot][i] = AFALG_NO_SOCKET;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Hashes packet and nonce with a single sendmsg and reads the digest.
+ */
+static bool _afalg_hmac(int op, in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, uint8_t digest[DTLS_HMAC_DIGEST_SIZE]) {
+
+    struct iovec iov[2];
+    struct msghdr msg;
+    ssize_t len;
+
+    iov[0].iov_base = (void*) packet;
+    iov[0].iov_len = pktlen;
+    iov[1].iov_base = (void*) (noncebytes ? noncebytes->b : NULL);
+    iov[1].iov_len = noncebytes ? sizeof(noncebytes_t) : 0;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = noncebytes ? 2 : 1;
+
+    /* Without MSG_MORE, the kernel finalizes the hash */
+    do {
+        len = sendmsg(op, &msg, 0);
+    } while(len < 0 && errno == EINTR);
+    if(len != (ssize_t) (pktlen + iov[1].iov_len)) {
+        return false;
+    }
+
+    do {
+        len = read(op, digest, DTLS_HMAC_DIGEST_SIZE);
+    } while(len < 0 && errno == EINTR);
+    return len == DTLS_HMAC_DIGEST_SIZE;
+}
+
+/**
+ * Jobs j = first + k * step of a batch, hashed through one operation socket
+ */
+struct AfAlgStripe {
+    struct AfAlgStripe* next;
+    int op;
+    mac_batch_job_t* jobs;
+    uint16_t first;
+    uint16_t step;
+    uint16_t count;
+    repel_mode_t mode;
+    /**
+     * First job the socket failed on, count if none. Later jobs of the stripe are not hashed.
+     */
+    uint16_t failed;
+    /**
+     * Stripes of the batch still queued or hashed by workers
+     */
+    uint16_t* pending;
+};
+
+/**
+ * Worker threads shared by all instances, started with the first batch
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    struct AfAlgStripe* queue;
+    uint8_t workers;
+    bool started;
+} _pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0, false };
+
+static void _afalg_stripe(struct AfAlgStripe* stripe) {
+    uint8_t digest[DTLS_HMAC_DIGEST_SIZE];
+
+    stripe->failed = stripe->count;
+    for(uint16_t j = stripe->first; j < stripe->count; j += stripe->step) {
+        mac_batch_job_t* job = &stripe->jobs[j];
+        if(!_afalg_hmac(stripe->op, job->packet, job->pktlen, job->noncebytes, digest)) {
+            stripe->failed = j;
+            return;
+        }
+        _finish_job(job, stripe->mode, digest);
+    }
+}
+
+static void* _afalg_worker(void* arg) {
+    (void) arg;
+
+    pthread_mutex_lock(&_pool.lock);
+    while(true) {
+        while(!_pool.queue) {
+            pthread_cond_wait(&_pool.work, &_pool.lock);
+        }
+        struct AfAlgStripe* stripe = _pool.queue;
+        _pool.queue = stripe->next;
+
+        pthread_mutex_unlock(&_pool.lock);
+        _afalg_stripe(stripe);
+        pthread_mutex_lock(&_pool.lock);
+
+        if(--*stripe->pending == 0) {
+            pthread_cond_broadcast(&_pool.done);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Starts the worker threads once, with the pool locked.
+ */
+static void _afalg_start_workers(void) {
+    _pool.started = true;
+    for(uint8_t i = 0; i < AFALG_HMAC_WORKERS; i++) {
+        pthread_t thread;
+        if(pthread_create(&thread, NULL, &_afalg_worker, NULL) != 0) {
+            warn("Cannot start AF_ALG HMAC worker, hashing batches with %u workers", (unsigned int) _pool.workers);
+            break;
+        }
+        pthread_detach(thread);
+        _pool.workers++;
+    }
+}
+
+#endif /* REPEL_USE_AFALG */
+
+/**********************************************************
+ *                 HMAC with fallback                     *
+ **********************************************************/
+
+static void _sw_hmac(struct AfAlgHMacData* data, uint8_t slot, in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, uint8_t digest[DTLS_HMAC_DIGEST_SIZE]) {
+
+    dtls_hmac_init(&data->ctx, data->keys[slot], HMAC_KEY_SIZE);
+    dtls_hmac_update(&data->ctx, packet, pktlen);
+    if(noncebytes) {
+        dtls_hmac_update(&data->ctx, noncebytes->b, sizeof(noncebytes_t));
+    }
+    dtls_hmac_finalize(&data->ctx, digest);
+}
+
+static void _hmac(struct AfAlgHMacData* data, uint8_t slot, in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, uint8_t digest[DTLS_HMAC_DIGEST_SIZE]) {
+
+    #if REPEL_USE_AFALG
+    if(data->op[slot][0] != AFALG_NO_SOCKET) {
+        if(_afalg_hmac(data->op[slot][0], packet, pktlen, noncebytes, digest)) {
+            return;
+        }
+        /* The operation socket is in an undefined state now */
+        warn("AF_ALG HMAC failed, falling back to software: %s", strerror(errno));
+        _afalg_close(data);
+    }
+    #endif
+    _sw_hmac(data, slot, packet, pktlen, noncebytes, digest);
+}
+
+#if REPEL_USE_AFALG
+
+/**
+ * Hashes the batch in stripes, one by the calling thread and the others by the workers.
+ *
+ * \return Whether all jobs were hashed, the operation sockets are in an undefined state otherwise.
+ */
+static bool _afalg_batch(struct AfAlgHMacData* data, uint8_t slot, mac_batch_job_t* jobs, uint16_t count,
+    repel_mode_t mode) {
+
+    struct AfAlgStripe stripes[AFALG_STRIPES];
+    uint16_t pending = 0;
+
+    pthread_mutex_lock(&_pool.lock);
+    if(!_pool.started) {
+        _afalg_start_workers();
+    }
+    uint16_t const step = count < _pool.workers + 1 ? count : _pool.workers + 1;
+
+    for(uint16_t i = 0; i < step; i++) {
+        stripes[i] = (struct AfAlgStripe) { NULL, data->op[slot][i], jobs, i, step, count, mode, count, &pending };
+    }
+    for(uint16_t i = 1; i < step; i++) {
+        stripes[i].next = _pool.queue;
+        _pool.queue = &stripes[i];
+        pending++;
+    }
+    if(pending > 0) {
+        pthread_cond_broadcast(&_pool.work);
+    }
+    pthread_mutex_unlock(&_pool.lock);
+
+    _afalg_stripe(&stripes[0]);
+
+    pthread_mutex_lock(&_pool.lock);
+    while(pending > 0) {
+        pthread_cond_wait(&_pool.done, &_pool.lock);
+    }
+    pthread_mutex_unlock(&_pool.lock);
+
+    bool hashed = true;
+    for(uint16_t i = 0; i < step; i++) {
+        hashed = hashed && stripes[i].failed == count;
+    }
+    if(hashed) {
+        return true;
+    }
+
+    /* Complete the failed stripes in software */
+    uint8_t digest[DTLS_HMAC_DIGEST_SIZE];
+    for(uint16_t i = 0; i < step; i++) {
+        for(uint16_t j = stripes[i].failed; j < count; j += step) {
+            _sw_hmac(data, slot, jobs[j].packet, jobs[j].pktlen, jobs[j].noncebytes, digest);
+            _finish_job(&jobs[j], mode, digest);
+        }
+    }
+    return false;
+}
+
+#endif /* REPEL_USE_AFALG */
+
+void* afalg_hmac_create(bufsize_t maclen) {
+    struct AfAlgHMacData* data;
+    unsigned int datalen = sizeof(struct AfAlgHMacData);
+
+    if(maclen < DTLS_HMAC_DIGEST_SIZE) {
+        maclen = DTLS_HMAC_DIGEST_SIZE;
+    }
+    /* Expand data.buffer for parsers that embed a large number of bits */
+    datalen += maclen - DTLS_HMAC_DIGEST_SIZE;
+
+    data = (struct AfAlgHMacData*) mem_alloc(datalen);
+    if(!data) {
+        return NULL;
+    }
+
+    memset(data->keys, 0, sizeof(data->keys));
+    for(uint8_t s = 0; s < 2; s++) {
+        data->tfm[s] = AFALG_NO_SOCKET;
+        for(uint8_t i = 0; i < AFALG_STRIPES; i++) {
+            data->op[s][i] = AFALG_NO_SOCKET;
+        }
+    }
+
+    #if REPEL_USE_AFALG
+    if(!_afalg_open(data)) {
+        info("AF_ALG hmac(sha256) unavailable, using software HMAC");
+    }
+    #endif
+    return data;
+}
+
+void afalg_hmac_destroy(void* self) {
+    #if REPEL_USE_AFALG
+    _afalg_close((struct AfAlgHMacData*) self);
+    #endif
+    mem_free(self);
+}
+
+out_buffer_t afalg_hmac_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct AfAlgHMacData* data = (struct AfAlgHMacData*) self;
+    bufsize_t const bytes = ceil_bits_to_bytes(macbits + extrabits);
+    memset(data->buffer, 0, bytes);
+
+    _hmac(data, HMAC_KEYSLOT_SEND, packet, pktlen, noncebytes, data->buffer);
+
+    eval_timer_measure_mod("end mac");
+    /* Automatic truncation by library core */
+    return data->buffer;
+}
+
+int16_t afalg_hmac_verify(void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct AfAlgHMacData* data = (struct AfAlgHMacData*) self;
+    memset(data->buffer, 0, ceil_bits_to_bytes(bits));
+
+    _hmac(data, HMAC_KEYSLOT_RECV, packet, pktlen, noncebytes, data->buffer);
+
+    bool const valid = mac_equal_bits(mac, data->buffer, bits);
+
+    eval_timer_measure_mod("end mac");
+    return valid ? bits : -bits;
+}
+
+void afalg_hmac_batch(void* self, mac_batch_job_t* jobs, uint16_t count, repel_mode_t mode) {
+    eval_timer_measure_mod("begin mac");
+
+    struct AfAlgHMacData* data = (struct AfAlgHMacData*) self;
+    uint8_t const slot = mode == EMBED ? HMAC_KEYSLOT_SEND : HMAC_KEYSLOT_RECV;
+    uint8_t digest[DTLS_HMAC_DIGEST_SIZE];
+
+    #if REPEL_USE_AFALG
+    if(data->op[slot][0] != AFALG_NO_SOCKET && count > 1) {
+        if(!_afalg_batch(data, slot, jobs, count, mode)) {
+            /* Workers' errno is lost */
+            warn("AF_ALG HMAC batch failed, falling back to software");
+            _afalg_close(data);
+        }
+        eval_timer_measure_mod("end mac");
+        return;
+    }
+    #endif
+
+    for(uint16_t j = 0; j < count; j++) {
+        mac_batch_job_t* job = &jobs[j];
+
+        _hmac(data, slot, job->packet, job->pktlen, job->noncebytes, digest);
+        _finish_job(job, mode, digest);
+    }
+
+    eval_timer_measure_mod("end mac");
+}
+
+void afalg_hmac_set_keys(void* self, void const* keys) {
+    struct AfAlgHMacData* data = (struct AfAlgHMacData*) self;
+    if(keys) {
+        /* Assume the caller knows the key format */
+        memcpy(data->keys, keys, sizeof(data->keys));
+
+        #if REPEL_USE_AFALG
+        for(uint8_t s = 0; s < 2 && data->tfm[s] != AFALG_NO_SOCKET; s++) {
+            if(!_afalg_set_key(data, s, data->keys[s])) {
+                warn("AF_ALG rejected HMAC key, falling back to software: %s", strerror(errno));
+                _afalg_close(data);
+            }
+        }
+        #endif
+    }
+}
+
+mac_module_t afalg_hmac_module = {
+    &afalg_hmac_create,
+    &afalg_hmac_destroy,
+    &afalg_hmac_sign,
+    &afalg_hmac_verify,
+    &afalg_hmac_set_keys,
+    &afalg_hmac_batch,
+    false
+};
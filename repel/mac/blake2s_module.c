@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Implementation of truncated keyed BLAKE2s (RFC 7693) MACs.
+ * Unlike HMAC, keyed BLAKE2s hashes the message only once. It operates on
+ * 32 bit words, which makes it cheap on microcontrollers without SHA hardware.
+ * The state after the key block is cached per keyslot, so that short packets
+ * require a single compression.
+ *
+ * Expects the same key format as the hmac module: one 16 byte key each for
+ * send and receive directions.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel_modules.h"
+
+#include <string.h>
+
+#include "platform.h"
+#include "../eval_timer.h"
+
+#define BLAKE2S_KEY_SIZE    16
+#define BLAKE2S_BLOCK_SIZE  64
+#define BLAKE2S_OUT_SIZE    32
+#define BLAKE2S_ROUNDS      10
+
+#define BLAKE2S_KEYSLOT_SEND   0
+#define BLAKE2S_KEYSLOT_RECV   1
+
+struct Blake2sKeySlot {
+    /**
+     * Chaining value after compressing the key block
+     */
+    uint32_t h[8];
+    /**
+     * Raw key for messages that consist of the key block only
+     */
+    uint8_t key[BLAKE2S_KEY_SIZE];
+};
+
+struct Blake2sData {
+    struct Blake2sKeySlot slots[2];
+    /**
+     * May be larger, depends on blake2s_create
+     */
+    uint8_t buffer[BLAKE2S_OUT_SIZE];
+};
+
+static uint32_t const blake2s_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static uint8_t const blake2s_sigma[BLAKE2S_ROUNDS][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define ROTR32(x, b)    (uint32_t) (((x) >> (b)) | ((x) << (32 - (b))))
+
+#define G(a, b, c, d, x, y) do { \
+    v[a] = v[a] + v[b] + (x); v[d] = ROTR32(v[d] ^ v[a], 16); \
+    v[c] = v[c] + v[d];       v[b] = ROTR32(v[b] ^ v[c], 12); \
+    v[a] = v[a] + v[b] + (y); v[d] = ROTR32(v[d] ^ v[a], 8); \
+    v[c] = v[c] + v[d];       v[b] = ROTR32(v[b] ^ v[c], 7); \
+} while(0)
+
+static inline uint32_t _load_le32(uint8_t const* b) {
+    return ((uint32_t) b[0]) | ((uint32_t) b[1] << 8) | ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+/**
+ * \param t Number of message bytes compressed including this block.
+ * \param last Whether block is the final block.
+ */
+static void _blake2s_compress(uint32_t h[8], uint8_t const block[BLAKE2S_BLOCK_SIZE], uint32_t t, bool last) {
+    uint32_t m[16], v[16];
+
+    for(uint8_t i = 0; i < 16; i++) {
+        m[i] = _load_le32(block + 4*i);
+    }
+    for(uint8_t i = 0; i < 8; i++) {
+        v[i] = h[i];
+        v[i + 8] = blake2s_iv[i];
+    }
+    /* Packets are shorter than 2^32 bytes, upper counter word stays zero */
+    v[12] ^= t;
+    if(last) {
+        v[14] = ~v[14];
+    }
+
+    for(uint8_t r = 0; r < BLAKE2S_ROUNDS; r++) {
+        uint8_t const* s = blake2s_sigma[r];
+        G(0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);
+        G(1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);
+        G(2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);
+        G(3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);
+        G(0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);
+        G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+        G(2, 7,  8, 13, m[s[12]], m[s[13]]);
+        G(3, 4,  9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for(uint8_t i = 0; i < 8; i++) {
+        h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+/**
+ * Initializes h and compresses the key block.
+ */
+static void _blake2s_key_block(uint32_t h[8], uint8_t const key[BLAKE2S_KEY_SIZE], bool last) {
+    uint8_t block[BLAKE2S_BLOCK_SIZE];
+
+    memcpy(h, blake2s_iv, sizeof(blake2s_iv));
+    /* Parameter block: digest length, key length, fanout and depth 1 */
+    h[0] ^= 0x01010000 ^ (BLAKE2S_KEY_SIZE << 8) ^ BLAKE2S_OUT_SIZE;
+
+    memset(block, 0, BLAKE2S_BLOCK_SIZE);
+    memcpy(block, key, BLAKE2S_KEY_SIZE);
+    _blake2s_compress(h, block, BLAKE2S_BLOCK_SIZE, last);
+    memset(block, 0, BLAKE2S_BLOCK_SIZE);
+}
+
+/**
+ * Calculates keyed BLAKE2s of packet and nonce (if not NULL) without copying the packet.
+ */
+static void _blake2s(struct Blake2sKeySlot const* slot, in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, uint8_t out[BLAKE2S_OUT_SIZE]) {
+
+    /* Last packet bytes and the nonce, at most 63 + 8 bytes */
+    uint8_t tail[2 * BLAKE2S_BLOCK_SIZE];
+    uint8_t* last = tail;
+    uint32_t h[8];
+    uint32_t t = BLAKE2S_BLOCK_SIZE;
+    bufsize_t taillen, blocks;
+
+    if(pktlen == 0 && !noncebytes) {
+        /* Key block is the final block */
+        _blake2s_key_block(h, slot->key, true);
+    } else {
+        memcpy(h, slot->h, sizeof(h));
+
+        /* Compress all blocks but the last one directly from the packet */
+        if(noncebytes) {
+            blocks = pktlen / BLAKE2S_BLOCK_SIZE;
+        } else {
+            blocks = (pktlen - 1) / BLAKE2S_BLOCK_SIZE;
+        }
+        for(bufsize_t b = 0; b < blocks; b++) {
+            t += BLAKE2S_BLOCK_SIZE;
+            _blake2s_compress(h, packet + b * BLAKE2S_BLOCK_SIZE, t, false);
+        }
+
+        taillen = pktlen - blocks * BLAKE2S_BLOCK_SIZE;
+        memcpy(tail, packet + blocks * BLAKE2S_BLOCK_SIZE, taillen);
+        if(noncebytes) {
+            memcpy(tail + taillen, noncebytes->b, sizeof(noncebytes_t));
+            taillen += sizeof(noncebytes_t);
+        }
+        if(taillen > BLAKE2S_BLOCK_SIZE) {
+            t += BLAKE2S_BLOCK_SIZE;
+            _blake2s_compress(h, tail, t, false);
+            last += BLAKE2S_BLOCK_SIZE;
+            taillen -= BLAKE2S_BLOCK_SIZE;
+        }
+
+        /* Final block is zero padded */
+        memset(last + taillen, 0, BLAKE2S_BLOCK_SIZE - taillen);
+        t += taillen;
+        _blake2s_compress(h, last, t, true);
+    }
+
+    for(uint8_t i = 0; i < BLAKE2S_OUT_SIZE; i++) {
+        out[i] = (uint8_t) (h[i / 4] >> (8 * (i % 4)));
+    }
+}
+
+void* blake2s_create(bufsize_t maclen) {
+    struct Blake2sData* data;
+    unsigned int datalen = sizeof(struct Blake2sData);
+
+    if(maclen < BLAKE2S_OUT_SIZE) {
+        maclen = BLAKE2S_OUT_SIZE;
+    }
+    /* Expand data.buffer for parsers that embed a large number of bits */
+    datalen += maclen - BLAKE2S_OUT_SIZE;
+
+    data = (struct Blake2sData*) mem_alloc(datalen);
+    if(!data) {
+        return NULL;
+    }
+
+    memset(data->slots, 0, sizeof(data->slots));
+    return data;
+}
+
+void blake2s_destroy(void* self) {
+    mem_free(self);
+}
+
+out_buffer_t blake2s_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct Blake2sData* data = (struct Blake2sData*) self;
+    bufsize_t const bytes = ceil_bits_to_bytes(macbits + extrabits);
+    memset(data->buffer, 0, bytes);
+
+    _blake2s(&data->slots[BLAKE2S_KEYSLOT_SEND], packet, pktlen, noncebytes, data->buffer);
+
+    eval_timer_measure_mod("end mac");
+    /* Automatic truncation by library core */
+    return data->buffer;
+}
+
+int16_t blake2s_verify(void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct Blake2sData* data = (struct Blake2sData*) self;
+    memset(data->buffer, 0, ceil_bits_to_bytes(bits));
+
+    _blake2s(&data->slots[BLAKE2S_KEYSLOT_RECV], packet, pktlen, noncebytes, data->buffer);
+
+    bool const valid = mac_equal_bits(mac, data->buffer, bits);
+
+    eval_timer_measure_mod("end mac");
+    return valid ? bits : -bits;
+}
+
+void blake2s_set_keys(void* self, void const* keys) {
+    struct Blake2sData* data = (struct Blake2sData*) self;
+    uint8_t const (*k)[BLAKE2S_KEY_SIZE] = (uint8_t const (*)[BLAKE2S_KEY_SIZE]) keys;
+
+    if(keys) {
+        /* Assume the caller knows the key format */
+        for(uint8_t s = 0; s < 2; s++) {
+            memcpy(data->slots[s].key, k[s], BLAKE2S_KEY_SIZE);
+            _blake2s_key_block(data->slots[s].h, k[s], false);
+        }
+    }
+}
+
+mac_module_t blake2s_module = {
+    &blake2s_create,
+    &blake2s_destroy,
+    &blake2s_sign,
+    &blake2s_verify,
+    &blake2s_set_keys,
+    NULL,
+    false
+};
@@ -0,0 +1,472 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Implementation of truncated keyed BLAKE3 MACs.
+ * Like keyed BLAKE2s, keyed BLAKE3 hashes the message in a single pass and
+ * needs no separate key block, so packets of up to 64 bytes require a single
+ * compression. The compression function uses SSE4.1 when available.
+ *
+ * BLAKE3's AVX2 and AVX-512 implementations hash 8 or 16 chunks of 1 KiB in
+ * parallel. Packets are shorter than that in practice, so this module
+ * vectorizes the compression of a single block instead and hashes the chunks
+ * of larger packets one after the other.
+ *
+ * Expects the same key format as the hmac module: one 16 byte key each for
+ * send and receive directions. Keys are zero padded to BLAKE3's 32 byte keys.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel_modules.h"
+
+#include <string.h>
+
+#include "platform.h"
+#include "../cpu_features.h"
+#include "../eval_timer.h"
+
+#if REPEL_USE_CPU_EXTENSIONS
+#include <smmintrin.h>
+#endif
+
+#define BLAKE3_KEY_SIZE     16
+#define BLAKE3_BLOCK_SIZE   64
+#define BLAKE3_CHUNK_SIZE   1024
+#define BLAKE3_OUT_SIZE     32
+#define BLAKE3_ROUNDS       7
+
+/* Packets of up to 2^16 bytes result in a tree of depth 7 */
+#define BLAKE3_MAX_DEPTH    8
+
+#define BLAKE3_KEYSLOT_SEND   0
+#define BLAKE3_KEYSLOT_RECV   1
+
+enum Blake3Flags {
+    CHUNK_START = 1 << 0,
+    CHUNK_END   = 1 << 1,
+    PARENT      = 1 << 2,
+    ROOT        = 1 << 3,
+    KEYED_HASH  = 1 << 4
+};
+
+struct Blake3Data {
+    /**
+     * Keys in send and receive directions as chaining values
+     */
+    uint32_t keys[2][8];
+    /**
+     * Whether to use SSE4.1, determined at module creation.
+     */
+    bool sse41;
+    /**
+     * May be larger, depends on blake3_create
+     */
+    uint8_t buffer[BLAKE3_OUT_SIZE];
+};
+
+/**
+ * Compresses a block into the chaining value cv.
+ */
+typedef void _blake3_compress_fn_t(uint32_t cv[8], uint32_t const m[16], uint64_t counter, uint32_t blocklen, uint32_t flags);
+
+/**
+ * Packet and nonce as a single message
+ */
+struct Blake3Message {
+    in_buffer_t packet;
+    bufsize_t pktlen;
+    noncebytes_t const* noncebytes;
+    uint32_t len;
+};
+
+static uint32_t const blake3_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/**
+ * Message word order per round, i.e., the message permutation applied repeatedly
+ */
+static uint8_t const blake3_schedule[BLAKE3_ROUNDS][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    {  2,  6,  3, 10,  7,  0,  4, 13,  1, 11, 12,  5,  9, 14, 15,  8 },
+    {  3,  4, 10, 12, 13,  2,  7, 14,  6,  5,  9,  0, 11, 15,  8,  1 },
+    { 10,  7, 12,  9, 14,  3, 13, 15,  4,  0, 11,  2,  5,  8,  1,  6 },
+    { 12, 13,  9, 11, 15, 10, 14,  8,  7,  2,  5,  3,  0,  1,  6,  4 },
+    {  9, 14, 11,  5,  8, 12, 15,  1, 13,  3,  0, 10,  2,  6,  4,  7 },
+    { 11, 15,  5,  0,  1,  9,  8,  6, 14, 10,  2, 12,  3,  4,  7, 13 }
+};
+
+static inline uint32_t _load_le32(uint8_t const* b) {
+    return ((uint32_t) b[0]) | ((uint32_t) b[1] << 8) | ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+/**********************************************************
+ *               Software implementation                  *
+ **********************************************************/
+
+#define ROTR32(x, b)    (uint32_t) (((x) >> (b)) | ((x) << (32 - (b))))
+
+#define G(a, b, c, d, x, y) do { \
+    v[a] = v[a] + v[b] + (x); v[d] = ROTR32(v[d] ^ v[a], 16); \
+    v[c] = v[c] + v[d];       v[b] = ROTR32(v[b] ^ v[c], 12); \
+    v[a] = v[a] + v[b] + (y); v[d] = ROTR32(v[d] ^ v[a], 8); \
+    v[c] = v[c] + v[d];       v[b] = ROTR32(v[b] ^ v[c], 7); \
+} while(0)
+
+static void _blake3_compress_sw(uint32_t cv[8], uint32_t const m[16], uint64_t counter, uint32_t blocklen, uint32_t flags) {
+    uint32_t v[16];
+
+    memcpy(v, cv, 8 * sizeof(uint32_t));
+    memcpy(v + 8, blake3_iv, 4 * sizeof(uint32_t));
+    v[12] = (uint32_t) counter;
+    v[13] = (uint32_t) (counter >> 32);
+    v[14] = blocklen;
+    v[15] = flags;
+
+    for(uint8_t r = 0; r < BLAKE3_ROUNDS; r++) {
+        uint8_t const* s = blake3_schedule[r];
+        G(0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);
+        G(1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);
+        G(2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);
+        G(3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);
+        G(0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);
+        G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+        G(2, 7,  8, 13, m[s[12]], m[s[13]]);
+        G(3, 4,  9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for(uint8_t i = 0; i < 8; i++) {
+        cv[i] = v[i] ^ v[i + 8];
+    }
+}
+
+/**********************************************************
+ *                  SSE4.1 implementation                 *
+ **********************************************************/
+
+#if REPEL_USE_CPU_EXTENSIONS
+
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+
+SSE41_TARGET
+static inline __m128i _rotr16(__m128i x) {
+    return _mm_shuffle_epi8(x, _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+SSE41_TARGET
+static inline __m128i _rotr8(__m128i x) {
+    return _mm_shuffle_epi8(x, _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+
+SSE41_TARGET
+static inline __m128i _rotr12(__m128i x) {
+    return _mm_or_si128(_mm_srli_epi32(x, 12), _mm_slli_epi32(x, 20));
+}
+
+SSE41_TARGET
+static inline __m128i _rotr7(__m128i x) {
+    return _mm_or_si128(_mm_srli_epi32(x, 7), _mm_slli_epi32(x, 25));
+}
+
+/**
+ * Four G functions at once, on the columns of the state rows
+ */
+#define G4(mx, my) do { \
+    row0 = _mm_add_epi32(_mm_add_epi32(row0, row1), (mx)); \
+    row3 = _rotr16(_mm_xor_si128(row3, row0)); \
+    row2 = _mm_add_epi32(row2, row3); \
+    row1 = _rotr12(_mm_xor_si128(row1, row2)); \
+    row0 = _mm_add_epi32(_mm_add_epi32(row0, row1), (my)); \
+    row3 = _rotr8(_mm_xor_si128(row3, row0)); \
+    row2 = _mm_add_epi32(row2, row3); \
+    row1 = _rotr7(_mm_xor_si128(row1, row2)); \
+} while(0)
+
+SSE41_TARGET
+static void _blake3_compress_sse41(uint32_t cv[8], uint32_t const m[16], uint64_t counter, uint32_t blocklen, uint32_t flags) {
+    __m128i row0 = _mm_loadu_si128((__m128i const*) cv);
+    __m128i row1 = _mm_loadu_si128((__m128i const*) (cv + 4));
+    __m128i row2 = _mm_loadu_si128((__m128i const*) blake3_iv);
+    __m128i row3 = _mm_set_epi32((int) flags, (int) blocklen, (int) (counter >> 32), (int) counter);
+
+    for(uint8_t r = 0; r < BLAKE3_ROUNDS; r++) {
+        uint8_t const* s = blake3_schedule[r];
+
+        G4(_mm_set_epi32((int) m[s[6]], (int) m[s[4]], (int) m[s[2]], (int) m[s[0]]),
+           _mm_set_epi32((int) m[s[7]], (int) m[s[5]], (int) m[s[3]], (int) m[s[1]]));
+
+        /* Diagonalize */
+        row1 = _mm_shuffle_epi32(row1, _MM_SHUFFLE(0, 3, 2, 1));
+        row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(1, 0, 3, 2));
+        row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(2, 1, 0, 3));
+
+        G4(_mm_set_epi32((int) m[s[14]], (int) m[s[12]], (int) m[s[10]], (int) m[s[8]]),
+           _mm_set_epi32((int) m[s[15]], (int) m[s[13]], (int) m[s[11]], (int) m[s[9]]));
+
+        /* Undiagonalize */
+        row1 = _mm_shuffle_epi32(row1, _MM_SHUFFLE(2, 1, 0, 3));
+        row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(1, 0, 3, 2));
+        row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(0, 3, 2, 1));
+    }
+
+    _mm_storeu_si128((__m128i*) cv, _mm_xor_si128(row0, row2));
+    _mm_storeu_si128((__m128i*) (cv + 4), _mm_xor_si128(row1, row3));
+}
+
+#endif /* REPEL_USE_CPU_EXTENSIONS */
+
+/**********************************************************
+ *                       BLAKE3                           *
+ **********************************************************/
+
+/**
+ * Loads the message block at offset, zero padded.
+ *
+ * \return Number of message bytes in the block.
+ */
+static uint32_t _blake3_load_block(struct Blake3Message const* msg, uint32_t offset, uint32_t m[16]) {
+    uint8_t block[BLAKE3_BLOCK_SIZE];
+    uint8_t const* src = block;
+    uint32_t len = msg->len - offset;
+
+    if(len > BLAKE3_BLOCK_SIZE) {
+        len = BLAKE3_BLOCK_SIZE;
+    }
+
+    if(offset + BLAKE3_BLOCK_SIZE <= msg->pktlen) {
+        /* Full block inside the packet */
+        src = msg->packet + offset;
+    } else {
+        uint32_t inpkt = offset < msg->pktlen ? msg->pktlen - offset : 0;
+        if(inpkt > len) {
+            inpkt = len;
+        }
+        memset(block, 0, BLAKE3_BLOCK_SIZE);
+        memcpy(block, msg->packet + offset, inpkt);
+        if(len > inpkt) {
+            /* Nonce bytes follow the packet */
+            memcpy(block + inpkt, msg->noncebytes->b + (offset + inpkt - msg->pktlen), len - inpkt);
+        }
+    }
+
+    for(uint8_t i = 0; i < 16; i++) {
+        m[i] = _load_le32(src + 4*i);
+    }
+    return len;
+}
+
+/**
+ * Hashes a chunk into cv.
+ */
+static void _blake3_chunk(_blake3_compress_fn_t* compress, uint32_t const key[8], struct Blake3Message const* msg,
+    uint32_t chunk, bool root, uint32_t cv[8]) {
+
+    uint32_t const start = chunk * BLAKE3_CHUNK_SIZE;
+    uint32_t end = start + BLAKE3_CHUNK_SIZE;
+    uint32_t m[16];
+
+    if(end > msg->len) {
+        end = msg->len;
+    }
+    memcpy(cv, key, 8 * sizeof(uint32_t));
+
+    /* Empty message has one empty block */
+    uint32_t offset = start;
+    do {
+        uint32_t flags = KEYED_HASH;
+        uint32_t const blocklen = _blake3_load_block(msg, offset, m);
+
+        if(offset == start) {
+            flags |= CHUNK_START;
+        }
+        offset += blocklen;
+        if(offset >= end) {
+            flags |= CHUNK_END;
+            if(root) {
+                flags |= ROOT;
+            }
+        }
+        compress(cv, m, chunk, blocklen, flags);
+    } while(offset < end);
+}
+
+/**
+ * Combines two subtree chaining values into cv.
+ */
+static void _blake3_parent(_blake3_compress_fn_t* compress, uint32_t const key[8],
+    uint32_t const left[8], uint32_t const right[8], bool root, uint32_t cv[8]) {
+
+    uint32_t m[16];
+    memcpy(m, left, 8 * sizeof(uint32_t));
+    memcpy(m + 8, right, 8 * sizeof(uint32_t));
+    memcpy(cv, key, 8 * sizeof(uint32_t));
+    compress(cv, m, 0, BLAKE3_BLOCK_SIZE, KEYED_HASH | PARENT | (root ? ROOT : 0));
+}
+
+/**
+ * Calculates keyed BLAKE3 of packet and nonce (if not NULL) without copying the packet.
+ */
+static void _blake3(struct Blake3Data const* data, uint32_t const key[8], in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, uint8_t out[BLAKE3_OUT_SIZE]) {
+
+    _blake3_compress_fn_t* compress = &_blake3_compress_sw;
+    struct Blake3Message msg;
+    uint32_t stack[BLAKE3_MAX_DEPTH][8];
+    uint8_t depth = 0;
+    uint32_t cv[8];
+
+    #if REPEL_USE_CPU_EXTENSIONS
+    if(data->sse41) {
+        compress = &_blake3_compress_sse41;
+    }
+    #else
+    UNUSED(data);
+    #endif
+
+    msg.packet = packet;
+    msg.pktlen = pktlen;
+    msg.noncebytes = noncebytes;
+    msg.len = pktlen + (noncebytes ? sizeof(noncebytes_t) : 0);
+
+    uint32_t const chunks = msg.len > 0 ? (msg.len + BLAKE3_CHUNK_SIZE - 1) / BLAKE3_CHUNK_SIZE : 1;
+
+    /* Merge completed subtrees, keep the last chunk as potential root */
+    for(uint32_t c = 0; c + 1 < chunks; c++) {
+        _blake3_chunk(compress, key, &msg, c, false, cv);
+
+        uint32_t total = c + 1;
+        while((total & 1) == 0) {
+            depth--;
+            _blake3_parent(compress, key, stack[depth], cv, false, cv);
+            total >>= 1;
+        }
+        memcpy(stack[depth], cv, sizeof(cv));
+        depth++;
+    }
+
+    _blake3_chunk(compress, key, &msg, chunks - 1, chunks == 1, cv);
+    while(depth > 0) {
+        depth--;
+        _blake3_parent(compress, key, stack[depth], cv, depth == 0, cv);
+    }
+
+    for(uint8_t i = 0; i < BLAKE3_OUT_SIZE; i++) {
+        out[i] = (uint8_t) (cv[i / 4] >> (8 * (i % 4)));
+    }
+}
+
+void* blake3_create(bufsize_t maclen) {
+    struct Blake3Data* data;
+    unsigned int datalen = sizeof(struct Blake3Data);
+
+    if(maclen < BLAKE3_OUT_SIZE) {
+        maclen = BLAKE3_OUT_SIZE;
+    }
+    /* Expand data.buffer for parsers that embed a large number of bits */
+    datalen += maclen - BLAKE3_OUT_SIZE;
+
+    data = (struct Blake3Data*) mem_alloc(datalen);
+    if(!data) {
+        return NULL;
+    }
+
+    memset(data->keys, 0, sizeof(data->keys));
+    data->sse41 = cpu_has_feature(CPU_FEATURE_SSE41);
+    return data;
+}
+
+void blake3_destroy(void* self) {
+    mem_free(self);
+}
+
+out_buffer_t blake3_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct Blake3Data* data = (struct Blake3Data*) self;
+    bufsize_t const bytes = ceil_bits_to_bytes(macbits + extrabits);
+    memset(data->buffer, 0, bytes);
+
+    _blake3(data, data->keys[BLAKE3_KEYSLOT_SEND], packet, pktlen, noncebytes, data->buffer);
+
+    eval_timer_measure_mod("end mac");
+    /* Automatic truncation by library core */
+    return data->buffer;
+}
+
+int16_t blake3_verify(void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct Blake3Data* data = (struct Blake3Data*) self;
+    memset(data->buffer, 0, ceil_bits_to_bytes(bits));
+
+    _blake3(data, data->keys[BLAKE3_KEYSLOT_RECV], packet, pktlen, noncebytes, data->buffer);
+
+    bool const valid = mac_equal_bits(mac, data->buffer, bits);
+
+    eval_timer_measure_mod("end mac");
+    return valid ? bits : -bits;
+}
+
+void blake3_set_keys(void* self, void const* keys) {
+    struct Blake3Data* data = (struct Blake3Data*) self;
+    uint8_t const (*k)[BLAKE3_KEY_SIZE] = (uint8_t const (*)[BLAKE3_KEY_SIZE]) keys;
+
+    if(keys) {
+        /* Assume the caller knows the key format */
+        memset(data->keys, 0, sizeof(data->keys));
+        for(uint8_t s = 0; s < 2; s++) {
+            for(uint8_t i = 0; i < BLAKE3_KEY_SIZE / 4; i++) {
+                data->keys[s][i] = _load_le32(k[s] + 4*i);
+            }
+        }
+    }
+}
+
+mac_module_t blake3_module = {
+    &blake3_create,
+    &blake3_destroy,
+    &blake3_sign,
+    &blake3_verify,
+    &blake3_set_keys,
+    NULL,
+    false
+};
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Implementation of truncated AES-128-CMAC (RFC 4493).
+ * Uses AES-NI on x86 and a table-free constant-time AES elsewhere.
+ * Expects the same key format as the hmac module: one 16 byte key
+ * each for send and receive directions.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel_modules.h"
+
+#include <string.h>
+
+#include "platform.h"
+#include "aes128.h"
+#include "../eval_timer.h"
+
+#define CMAC_KEYSLOT_SEND   0
+#define CMAC_KEYSLOT_RECV   1
+
+/**
+ * Key dependent values, computed once in cmac_set_keys.
+ */
+struct CMacKeySlot {
+    aes128_ctx_t aes;
+    /* Subkeys for complete and padded last blocks */
+    uint8_t k1[AES128_BLOCK_SIZE];
+    uint8_t k2[AES128_BLOCK_SIZE];
+};
+
+struct CMacData {
+    struct CMacKeySlot slots[2];
+    /**
+     * May be larger, depends on cmac_create
+     */
+    uint8_t buffer[AES128_BLOCK_SIZE];
+};
+
+/**
+ * Multiplication by x in GF(2^128) as used for subkey generation.
+ */
+static void _cmac_double(uint8_t out[AES128_BLOCK_SIZE], uint8_t const in[AES128_BLOCK_SIZE]) {
+    uint8_t const carry = in[0] >> 7;
+    for(uint8_t i = 0; i < AES128_BLOCK_SIZE - 1; i++) {
+        out[i] = (uint8_t) ((in[i] << 1) | (in[i + 1] >> 7));
+    }
+    out[AES128_BLOCK_SIZE - 1] = (uint8_t) ((in[AES128_BLOCK_SIZE - 1] << 1) ^ (0x87 & -carry));
+}
+
+/**
+ * Calculates the CMAC of packet and nonce (if not NULL) without copying the packet.
+ */
+static void _cmac(struct CMacKeySlot const* slot, in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, uint8_t tag[AES128_BLOCK_SIZE]) {
+
+    /* Last packet bytes and the nonce, at most 15 + 8 bytes */
+    uint8_t tail[2 * AES128_BLOCK_SIZE];
+    uint8_t const* last = tail;
+    uint8_t block[AES128_BLOCK_SIZE];
+    bufsize_t taillen, blocks;
+    uint8_t const* subkey;
+
+    memset(tag, 0, AES128_BLOCK_SIZE);
+
+    /* Chain all blocks but the last one directly from the packet */
+    if(noncebytes) {
+        blocks = pktlen / AES128_BLOCK_SIZE;
+    } else {
+        blocks = pktlen > 0 ? (pktlen - 1) / AES128_BLOCK_SIZE : 0;
+    }
+    aes128_cbc_mac(&slot->aes, tag, packet, blocks);
+
+    taillen = pktlen - blocks * AES128_BLOCK_SIZE;
+    memcpy(tail, packet + blocks * AES128_BLOCK_SIZE, taillen);
+    if(noncebytes) {
+        memcpy(tail + taillen, noncebytes->b, sizeof(noncebytes_t));
+        taillen += sizeof(noncebytes_t);
+    }
+    if(taillen > AES128_BLOCK_SIZE) {
+        aes128_cbc_mac(&slot->aes, tag, tail, 1);
+        last += AES128_BLOCK_SIZE;
+        taillen -= AES128_BLOCK_SIZE;
+    }
+
+    /* Last block: complete or padded with 10...0 */
+    if(taillen == AES128_BLOCK_SIZE) {
+        subkey = slot->k1;
+        memcpy(block, last, AES128_BLOCK_SIZE);
+    } else {
+        subkey = slot->k2;
+        memcpy(block, last, taillen);
+        block[taillen] = 0x80;
+        memset(block + taillen + 1, 0, AES128_BLOCK_SIZE - taillen - 1);
+    }
+    for(uint8_t i = 0; i < AES128_BLOCK_SIZE; i++) {
+        tag[i] ^= block[i] ^ subkey[i];
+    }
+    aes128_encrypt(&slot->aes, tag, tag);
+}
+
+void* cmac_create(bufsize_t maclen) {
+    struct CMacData* data;
+    unsigned int datalen = sizeof(struct CMacData);
+
+    if(maclen < AES128_BLOCK_SIZE) {
+        maclen = AES128_BLOCK_SIZE;
+    }
+    /* Expand data.buffer for parsers that embed a large number of bits */
+    datalen += maclen - AES128_BLOCK_SIZE;
+
+    data = (struct CMacData*) mem_alloc(datalen);
+    if(!data) {
+        return NULL;
+    }
+
+    memset(data->slots, 0, sizeof(data->slots));
+    return data;
+}
+
+void cmac_destroy(void* self) {
+    mem_free(self);
+}
+
+out_buffer_t cmac_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct CMacData* data = (struct CMacData*) self;
+    bufsize_t const bytes = ceil_bits_to_bytes(macbits + extrabits);
+    memset(data->buffer, 0, bytes);
+
+    _cmac(&data->slots[CMAC_KEYSLOT_SEND], packet, pktlen, noncebytes, data->buffer);
+
+    eval_timer_measure_mod("end mac");
+    /* Automatic truncation by library core */
+    return data->buffer;
+}
+
+int16_t cmac_verify(void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct CMacData* data = (struct CMacData*) self;
+    memset(data->buffer, 0, ceil_bits_to_bytes(bits));
+
+    _cmac(&data->slots[CMAC_KEYSLOT_RECV], packet, pktlen, noncebytes, data->buffer);
+
+    bool const valid = mac_equal_bits(mac, data->buffer, bits);
+
+    eval_timer_measure_mod("end mac");
+    return valid ? bits : -bits;
+}
+
+void cmac_set_keys(void* self, void const* keys) {
+    struct CMacData* data = (struct CMacData*) self;
+    uint8_t const (*k)[AES128_KEY_SIZE] = (uint8_t const (*)[AES128_KEY_SIZE]) keys;
+    uint8_t l[AES128_BLOCK_SIZE];
+
+    if(!keys) {
+        return;
+    }
+    /* Assume the caller knows the key format */
+    for(uint8_t s = 0; s < 2; s++) {
+        struct CMacKeySlot* slot = &data->slots[s];
+
+        aes128_set_key(&slot->aes, k[s]);
+
+        memset(l, 0, AES128_BLOCK_SIZE);
+        aes128_encrypt(&slot->aes, l, l);
+        _cmac_double(slot->k1, l);
+        _cmac_double(slot->k2, slot->k1);
+    }
+    memset(l, 0, AES128_BLOCK_SIZE);
+}
+
+mac_module_t cmac_module = {
+    &cmac_create,
+    &cmac_destroy,
+    &cmac_sign,
+    &cmac_verify,
+    &cmac_set_keys,
+    NULL,
+    false
+};
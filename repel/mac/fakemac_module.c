@@ -99,5 +99,7 @@ mac_module_t fakemac_module = {
     &fakemac_destroy,
     &fakemac_sign,
     &fakemac_verify,
-    &fakemac_set_keys
+    &fakemac_set_keys,
+    NULL,
+    false
 };
\ No newline at end of file
@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Implementation of truncated AES-128-GMAC.
+ * The 96 bit IV consists of 32 zero bits followed by the nonce passed by the
+ * library core. GHASH uses PCLMULQDQ with precomputed powers of the hash key
+ * to process GMAC_AGGREGATE_BLOCKS blocks per reduction when available, and a
+ * constant-time bitwise multiplication otherwise.
+ *
+ * Without a nonce, i.e., when the parser reports a nonce in the packet, the
+ * module encrypts the GHASH result instead of masking it. This yields a
+ * deterministic MAC and avoids reusing an IV.
+ *
+ * Expects the same key format as the hmac module. As both directions count
+ * nonces from zero, send and receive keys must differ. A repeated IV reveals
+ * the hash key and allows forging any tag, so the nonce counter must not restart
+ * with the same keys either: connections refuse to embed with library nonces until
+ * send nonces are reserved in saved state, leased, or derived from a clock. Note that the
+ * forgery probability of GMAC degrades faster than that of HMAC or CMAC when
+ * tags are truncated heavily, so rotate keys accordingly.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel_modules.h"
+#include "../repel_log.h"
+
+#include <string.h>
+
+#include "platform.h"
+#include "aes128.h"
+#include "../cpu_features.h"
+#include "../eval_timer.h"
+
+#if REPEL_USE_CPU_EXTENSIONS
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+#define GMAC_KEYSLOT_SEND   0
+#define GMAC_KEYSLOT_RECV   1
+
+#define GMAC_BLOCK_SIZE     16
+
+/**
+ * Number of blocks multiplied with powers of H before reducing once.
+ */
+#define GMAC_AGGREGATE_BLOCKS   4
+
+/**
+ * Key dependent values, computed once in gmac_set_keys.
+ */
+struct GMacKeySlot {
+    aes128_ctx_t aes;
+    /* Hash key H as big endian halves for the portable implementation */
+    uint64_t h[2];
+    /* H^1 ... H^GMAC_AGGREGATE_BLOCKS, byte-reflected for PCLMULQDQ */
+    uint8_t hpow[GMAC_AGGREGATE_BLOCKS][GMAC_BLOCK_SIZE];
+};
+
+struct GMacData {
+    struct GMacKeySlot slots[2];
+    /**
+     * Whether to use PCLMULQDQ, determined at module creation.
+     */
+    bool clmul;
+    /**
+     * May be larger, depends on gmac_create
+     */
+    uint8_t buffer[GMAC_BLOCK_SIZE];
+};
+
+static inline uint64_t _load_be64(uint8_t const* b) {
+    uint64_t v = 0;
+    for(uint8_t i = 0; i < 8; i++) {
+        v = (v << 8) | b[i];
+    }
+    return v;
+}
+
+static inline void _store_be64(uint8_t* b, uint64_t v) {
+    for(uint8_t i = 0; i < 8; i++) {
+        b[i] = (uint8_t) (v >> (56 - 8*i));
+    }
+}
+
+/**********************************************************
+ *               Software implementation                  *
+ **********************************************************/
+
+/**
+ * Multiplication in GF(2^128) as defined for GHASH, in constant time.
+ */
+static void _gf128_mul_sw(uint64_t z[2], uint64_t const x[2], uint64_t const h[2]) {
+    uint64_t zh = 0, zl = 0;
+    uint64_t vh = h[0], vl = h[1];
+
+    for(uint8_t i = 0; i < 128; i++) {
+        uint64_t const xbit = (i < 64 ? x[0] >> (63 - i) : x[1] >> (127 - i)) & 1;
+        uint64_t const mask = -xbit;
+        uint64_t const reduce = -(vl & 1);
+
+        zh ^= vh & mask;
+        zl ^= vl & mask;
+
+        vl = (vl >> 1) | (vh << 63);
+        vh = (vh >> 1) ^ (0xe100000000000000ULL & reduce);
+    }
+    z[0] = zh;
+    z[1] = zl;
+}
+
+static void _ghash_sw(struct GMacKeySlot const* slot, uint8_t y[GMAC_BLOCK_SIZE], in_buffer_t data, bufsize_t blocks) {
+    uint64_t x[2];
+    x[0] = _load_be64(y);
+    x[1] = _load_be64(y + 8);
+
+    while(blocks > 0) {
+        x[0] ^= _load_be64(data);
+        x[1] ^= _load_be64(data + 8);
+        _gf128_mul_sw(x, x, slot->h);
+
+        data += GMAC_BLOCK_SIZE;
+        blocks--;
+    }
+    _store_be64(y, x[0]);
+    _store_be64(y + 8, x[1]);
+}
+
+/**********************************************************
+ *                  PCLMULQDQ implementation              *
+ **********************************************************/
+
+#if REPEL_USE_CPU_EXTENSIONS
+
+#define CLMUL_TARGET __attribute__((target("pclmul,ssse3,sse2")))
+
+/**
+ * Unreduced carry-less product of two byte-reflected elements, added to lo and hi.
+ */
+CLMUL_TARGET
+static inline void _clmul_acc(__m128i a, __m128i b, __m128i* lo, __m128i* hi) {
+    __m128i const l = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i const h = _mm_clmulepi64_si128(a, b, 0x11);
+    __m128i m = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+
+    *lo = _mm_xor_si128(*lo, _mm_xor_si128(l, _mm_slli_si128(m, 8)));
+    *hi = _mm_xor_si128(*hi, _mm_xor_si128(h, _mm_srli_si128(m, 8)));
+}
+
+/**
+ * Reduces a 256 bit product modulo the GHASH polynomial.
+ * As the operands are bit-reflected, the product is shifted left by one first.
+ */
+CLMUL_TARGET
+static inline __m128i _clmul_reduce(__m128i lo, __m128i hi) {
+    __m128i t7, t8, t9, t2, t4, t5;
+
+    /* Shift 256 bit value lo:hi left by one */
+    t7 = _mm_srli_epi32(lo, 31);
+    t8 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    lo = _mm_or_si128(lo, t7);
+    hi = _mm_or_si128(hi, t8);
+    hi = _mm_or_si128(hi, t9);
+
+    /* First phase of the reduction */
+    t7 = _mm_slli_epi32(lo, 31);
+    t8 = _mm_slli_epi32(lo, 30);
+    t9 = _mm_slli_epi32(lo, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    lo = _mm_xor_si128(lo, t7);
+
+    /* Second phase of the reduction */
+    t2 = _mm_srli_epi32(lo, 1);
+    t4 = _mm_srli_epi32(lo, 2);
+    t5 = _mm_srli_epi32(lo, 7);
+    t2 = _mm_xor_si128(t2, t4);
+    t2 = _mm_xor_si128(t2, t5);
+    t2 = _mm_xor_si128(t2, t8);
+    lo = _mm_xor_si128(lo, t2);
+
+    return _mm_xor_si128(hi, lo);
+}
+
+CLMUL_TARGET
+static inline __m128i _clmul_mul(__m128i a, __m128i b) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    _clmul_acc(a, b, &lo, &hi);
+    return _clmul_reduce(lo, hi);
+}
+
+CLMUL_TARGET
+static inline __m128i _clmul_load(uint8_t const* b) {
+    __m128i const bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*) b), bswap);
+}
+
+CLMUL_TARGET
+static inline void _clmul_store(uint8_t* b, __m128i x) {
+    __m128i const bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    _mm_storeu_si128((__m128i*) b, _mm_shuffle_epi8(x, bswap));
+}
+
+CLMUL_TARGET
+static void _clmul_powers(struct GMacKeySlot* slot, uint8_t const h[GMAC_BLOCK_SIZE]) {
+    __m128i const h1 = _clmul_load(h);
+    __m128i hn = h1;
+
+    _mm_storeu_si128((__m128i*) slot->hpow[0], h1);
+    for(uint8_t i = 1; i < GMAC_AGGREGATE_BLOCKS; i++) {
+        hn = _clmul_mul(hn, h1);
+        _mm_storeu_si128((__m128i*) slot->hpow[i], hn);
+    }
+}
+
+CLMUL_TARGET
+static void _ghash_clmul(struct GMacKeySlot const* slot, uint8_t y[GMAC_BLOCK_SIZE], in_buffer_t data, bufsize_t blocks) {
+    __m128i hpow[GMAC_AGGREGATE_BLOCKS];
+    for(uint8_t i = 0; i < GMAC_AGGREGATE_BLOCKS; i++) {
+        hpow[i] = _mm_loadu_si128((__m128i const*) slot->hpow[i]);
+    }
+
+    __m128i x = _clmul_load(y);
+
+    /* Y' = (Y + X1) * H^n + X2 * H^(n-1) + ... + Xn * H, reduced once */
+    while(blocks >= GMAC_AGGREGATE_BLOCKS) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+
+        x = _mm_xor_si128(x, _clmul_load(data));
+        _clmul_acc(x, hpow[GMAC_AGGREGATE_BLOCKS - 1], &lo, &hi);
+        for(uint8_t i = 1; i < GMAC_AGGREGATE_BLOCKS; i++) {
+            _clmul_acc(_clmul_load(data + i * GMAC_BLOCK_SIZE), hpow[GMAC_AGGREGATE_BLOCKS - 1 - i], &lo, &hi);
+        }
+        x = _clmul_reduce(lo, hi);
+
+        data += GMAC_AGGREGATE_BLOCKS * GMAC_BLOCK_SIZE;
+        blocks -= GMAC_AGGREGATE_BLOCKS;
+    }
+    while(blocks > 0) {
+        x = _clmul_mul(_mm_xor_si128(x, _clmul_load(data)), hpow[0]);
+
+        data += GMAC_BLOCK_SIZE;
+        blocks--;
+    }
+    _clmul_store(y, x);
+}
+
+#endif /* REPEL_USE_CPU_EXTENSIONS */
+
+/**********************************************************
+ *                        GMAC                            *
+ **********************************************************/
+
+static void _ghash(struct GMacData const* data, struct GMacKeySlot const* slot,
+    uint8_t y[GMAC_BLOCK_SIZE], in_buffer_t blocks, bufsize_t count) {
+
+    #if REPEL_USE_CPU_EXTENSIONS
+    if(data->clmul) {
+        _ghash_clmul(slot, y, blocks, count);
+        return;
+    }
+    #else
+    UNUSED(data);
+    #endif
+    _ghash_sw(slot, y, blocks, count);
+}
+
+/**
+ * Calculates the GMAC of packet, which is the additional authenticated data
+ * of GCM without plaintext.
+ */
+static void _gmac(struct GMacData const* data, struct GMacKeySlot const* slot, in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, uint8_t tag[GMAC_BLOCK_SIZE]) {
+
+    /* Zero padded last packet bytes and length block */
+    uint8_t tail[2 * GMAC_BLOCK_SIZE];
+    bufsize_t const blocks = pktlen / GMAC_BLOCK_SIZE;
+    bufsize_t const rest = pktlen % GMAC_BLOCK_SIZE;
+    uint8_t* lenblock = tail + (rest ? GMAC_BLOCK_SIZE : 0);
+
+    memset(tag, 0, GMAC_BLOCK_SIZE);
+    _ghash(data, slot, tag, packet, blocks);
+
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, packet + blocks * GMAC_BLOCK_SIZE, rest);
+    /* Bit lengths of authenticated data and (empty) ciphertext */
+    _store_be64(lenblock, ((uint64_t) pktlen) * 8);
+    _ghash(data, slot, tag, tail, rest ? 2 : 1);
+
+    if(noncebytes) {
+        /* J0 = IV || 0^31 || 1 with 96 bit IV = 0^32 || nonce */
+        memset(tail, 0, GMAC_BLOCK_SIZE);
+        memcpy(tail + 4, noncebytes->b, sizeof(noncebytes_t));
+        tail[GMAC_BLOCK_SIZE - 1] = 1;
+        aes128_encrypt(&slot->aes, tail, tail);
+        for(uint8_t i = 0; i < GMAC_BLOCK_SIZE; i++) {
+            tag[i] ^= tail[i];
+        }
+    } else {
+        aes128_encrypt(&slot->aes, tag, tag);
+    }
+}
+
+void* gmac_create(bufsize_t maclen) {
+    struct GMacData* data;
+    unsigned int datalen = sizeof(struct GMacData);
+
+    if(maclen < GMAC_BLOCK_SIZE) {
+        maclen = GMAC_BLOCK_SIZE;
+    }
+    /* Expand data.buffer for parsers that embed a large number of bits */
+    datalen += maclen - GMAC_BLOCK_SIZE;
+
+    data = (struct GMacData*) mem_alloc(datalen);
+    if(!data) {
+        return NULL;
+    }
+
+    memset(data->slots, 0, sizeof(data->slots));
+    data->clmul = cpu_has_feature(CPU_FEATURE_PCLMUL) && cpu_has_feature(CPU_FEATURE_SSSE3);
+    return data;
+}
+
+void gmac_destroy(void* self) {
+    mem_free(self);
+}
+
+out_buffer_t gmac_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct GMacData* data = (struct GMacData*) self;
+    bufsize_t const bytes = ceil_bits_to_bytes(macbits + extrabits);
+    memset(data->buffer, 0, bytes);
+
+    _gmac(data, &data->slots[GMAC_KEYSLOT_SEND], packet, pktlen, noncebytes, data->buffer);
+
+    eval_timer_measure_mod("end mac");
+    /* Automatic truncation by library core */
+    return data->buffer;
+}
+
+int16_t gmac_verify(void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct GMacData* data = (struct GMacData*) self;
+    memset(data->buffer, 0, ceil_bits_to_bytes(bits));
+
+    _gmac(data, &data->slots[GMAC_KEYSLOT_RECV], packet, pktlen, noncebytes, data->buffer);
+
+    bool const valid = mac_equal_bits(mac, data->buffer, bits);
+
+    eval_timer_measure_mod("end mac");
+    return valid ? bits : -bits;
+}
+
+void gmac_set_keys(void* self, void const* keys) {
+    struct GMacData* data = (struct GMacData*) self;
+    uint8_t const (*k)[AES128_KEY_SIZE] = (uint8_t const (*)[AES128_KEY_SIZE]) keys;
+    uint8_t h[GMAC_BLOCK_SIZE];
+
+    if(!keys) {
+        return;
+    }
+    if(memcmp(k[GMAC_KEYSLOT_SEND], k[GMAC_KEYSLOT_RECV], AES128_KEY_SIZE) == 0) {
+        warn("GMAC: Equal send and receive keys repeat IVs across directions.");
+    }
+
+    /* Assume the caller knows the key format */
+    for(uint8_t s = 0; s < 2; s++) {
+        struct GMacKeySlot* slot = &data->slots[s];
+
+        aes128_set_key(&slot->aes, k[s]);
+
+        memset(h, 0, GMAC_BLOCK_SIZE);
+        aes128_encrypt(&slot->aes, h, h);
+        slot->h[0] = _load_be64(h);
+        slot->h[1] = _load_be64(h + 8);
+
+        #if REPEL_USE_CPU_EXTENSIONS
+        if(data->clmul) {
+            _clmul_powers(slot, h);
+        }
+        #endif
+    }
+    memset(h, 0, GMAC_BLOCK_SIZE);
+}
+
+mac_module_t gmac_module = {
+    &gmac_create,
+    &gmac_destroy,
+    &gmac_sign,
+    &gmac_verify,
+    &gmac_set_keys,
+    NULL,
+    true
+};
@@ -59,18 +59,54 @@
 #define HMAC_KEYSLOT_SEND   0
 #define HMAC_KEYSLOT_RECV   1
 
+/**
+ * Keep the HMAC state after the inner key block per key slot, which saves
+ * one SHA256 compression per packet at the cost of two HMAC contexts.
+ * Off on Contiki-NG, where heap memory is scarce.
+ */
+#ifndef HMAC_CACHE_MIDSTATES
+#ifdef CONTIKI
+#define HMAC_CACHE_MIDSTATES false
+#else
+#define HMAC_CACHE_MIDSTATES true
+#endif
+#endif
+
 struct HMacData {
     dtls_hmac_context_t ctx;
     /**
      * Keys in send and receive directions
      */
     uint8_t keys[2][HMAC_KEY_SIZE];
+#if HMAC_CACHE_MIDSTATES
+    /**
+     * Contexts after the inner key block per key slot
+     */
+    dtls_hmac_context_t midstates[2];
+#endif
     /**
      * May be larger, depends on hmac_create
      */
     uint8_t buffer[DTLS_HMAC_DIGEST_SIZE];
 };
 
+static void _hmac_init(struct HMacData* data, uint8_t slot) {
+    #if HMAC_CACHE_MIDSTATES
+    memcpy(&data->ctx, &data->midstates[slot], sizeof(dtls_hmac_context_t));
+    #else
+    dtls_hmac_init(&data->ctx, data->keys[slot], HMAC_KEY_SIZE);
+    #endif
+}
+
+static void _hmac_update_midstates(struct HMacData* data) {
+    #if HMAC_CACHE_MIDSTATES
+    dtls_hmac_init(&data->midstates[HMAC_KEYSLOT_SEND], data->keys[HMAC_KEYSLOT_SEND], HMAC_KEY_SIZE);
+    dtls_hmac_init(&data->midstates[HMAC_KEYSLOT_RECV], data->keys[HMAC_KEYSLOT_RECV], HMAC_KEY_SIZE);
+    #else
+    UNUSED(data);
+    #endif
+}
+
 void* hmac_create(bufsize_t maclen) {
     struct HMacData* data;
     unsigned int datalen = sizeof(struct HMacData);
@@ -91,6 +127,7 @@ void* hmac_create(bufsize_t maclen) {
     #if REPEL_USE_HW_ACCEL
     crypto_init();
     #endif
+    _hmac_update_midstates(data);
     return data;
 }
 
@@ -113,7 +150,7 @@ out_buffer_t hmac_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
     eval_timer_measure_mod("begin sha");
 
     /* Put SHA256 hw acceleration in TinyDTLS "dtls-hmac.h" define REPEL_USE_HW_ACCEL to use */
-    dtls_hmac_init(&data->ctx, data->keys[HMAC_KEYSLOT_SEND], HMAC_KEY_SIZE);
+    _hmac_init(data, HMAC_KEYSLOT_SEND);
     dtls_hmac_update(&data->ctx, packet, pktlen);
     if(noncebytes) {
         dtls_hmac_update(&data->ctx, noncebytes->b, sizeof(noncebytes_t));
@@ -138,7 +175,7 @@ int16_t hmac_verify(void* self,  in_buffer_t packet, bufsize_t pktlen,
     /* Compute MAC of packet */
     eval_timer_measure_mod("begin sha");
 
-    dtls_hmac_init(&data->ctx, data->keys[HMAC_KEYSLOT_RECV], HMAC_KEY_SIZE);
+    _hmac_init(data, HMAC_KEYSLOT_RECV);
     dtls_hmac_update(&data->ctx, packet, pktlen);
     if(noncebytes) {
         dtls_hmac_update(&data->ctx, noncebytes->b, sizeof(noncebytes_t));
@@ -176,6 +213,7 @@ void hmac_set_keys(void* self, void const* keys) {
     if(keys) {
         /* Assume the caller knows the key format */
         memcpy(data->keys, keys, sizeof(data->keys));
+        _hmac_update_midstates(data);
     }
 }
 
@@ -184,5 +222,7 @@ mac_module_t hmac_module = {
     &hmac_destroy,
     &hmac_sign,
     &hmac_verify,
-    &hmac_set_keys
+    &hmac_set_keys,
+    NULL,
+    false
 };
\ No newline at end of file
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Implementation of truncated SipHash-2-4 and HalfSipHash-2-4 MACs.
+ * Both are cheaper than HMAC for short packets: SipHash on 64 bit machines,
+ * HalfSipHash on 32 bit microcontrollers. The output length depends on the
+ * number of MAC bits to embed: SipHash outputs 64 or 128 bits,
+ * HalfSipHash 32 or 64 bits. Connections whose parser embeds more bits,
+ * including nonce bits, are rejected.
+ *
+ * Expects the same key format as the hmac module: one 16 byte key each for
+ * send and receive directions. HalfSipHash only uses the first 8 bytes of each key.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel_modules.h"
+#include "../repel_log.h"
+
+#include <string.h>
+
+#include "platform.h"
+#include "../eval_timer.h"
+
+#define SIPHASH_KEY_SIZE    16
+#define SIPHASH_MAX_OUT     16
+#define HALFSIPHASH_MAX_OUT 8
+
+#define SIPHASH_KEYSLOT_SEND   0
+#define SIPHASH_KEYSLOT_RECV   1
+
+#define SIPHASH_C_ROUNDS    2
+#define SIPHASH_D_ROUNDS    4
+
+struct SipHashData {
+    /**
+     * Keys in send and receive directions as little endian words
+     */
+    uint64_t keys[2][2];
+    uint8_t buffer[SIPHASH_MAX_OUT];
+};
+
+/**
+ * Calculates a MAC of packet and nonce into out.
+ *
+ * \param macbits Number of MAC bits required, selects the output length.
+ */
+typedef void _sip_fn_t(uint64_t const key[2], in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, bitcount_t macbits, out_buffer_t out);
+
+static inline uint64_t _load_le64(uint8_t const* b) {
+    uint64_t v = 0;
+    for(uint8_t i = 8; i > 0; i--) {
+        v = (v << 8) | b[i - 1];
+    }
+    return v;
+}
+
+static inline uint32_t _load_le32(uint8_t const* b) {
+    return ((uint32_t) b[0]) | ((uint32_t) b[1] << 8) | ((uint32_t) b[2] << 16) | ((uint32_t) b[3] << 24);
+}
+
+static inline void _store_le64(uint8_t* b, uint64_t v) {
+    for(uint8_t i = 0; i < 8; i++) {
+        b[i] = (uint8_t) (v >> (8*i));
+    }
+}
+
+static inline void _store_le32(uint8_t* b, uint32_t v) {
+    for(uint8_t i = 0; i < 4; i++) {
+        b[i] = (uint8_t) (v >> (8*i));
+    }
+}
+
+/**
+ * Splits the message packet || nonce in words to process directly from the
+ * packet and a tail, that contains the remaining packet and nonce bytes.
+ *
+ * \return Number of packet words to process directly.
+ */
+static inline bufsize_t _sip_split(in_buffer_t packet, bufsize_t pktlen, noncebytes_t const* noncebytes,
+    uint8_t wordsize, uint8_t* tail, bufsize_t* taillen) {
+
+    bufsize_t const words = pktlen / wordsize;
+    bufsize_t const rest = pktlen % wordsize;
+
+    memcpy(tail, packet + words * wordsize, rest);
+    *taillen = rest;
+    if(noncebytes) {
+        memcpy(tail + rest, noncebytes->b, sizeof(noncebytes_t));
+        *taillen += sizeof(noncebytes_t);
+    }
+    return words;
+}
+
+/**********************************************************
+ *                       SipHash                          *
+ **********************************************************/
+
+#define ROTL64(x, b)    (uint64_t) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND do { \
+    v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32); \
+    v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32); \
+} while(0)
+
+#define SIPCOMPRESS(m) do { \
+    v3 ^= (m); \
+    for(uint8_t r = 0; r < SIPHASH_C_ROUNDS; r++) { SIPROUND; } \
+    v0 ^= (m); \
+} while(0)
+
+static void _siphash(uint64_t const key[2], in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, bitcount_t macbits, out_buffer_t out) {
+
+    bool const wide = macbits > 64;
+    uint64_t v0 = 0x736f6d6570736575ULL ^ key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ key[1];
+    uint8_t tail[16];
+    bufsize_t taillen;
+    uint64_t m;
+
+    if(wide) {
+        v1 ^= 0xee;
+    }
+
+    bufsize_t words = _sip_split(packet, pktlen, noncebytes, 8, tail, &taillen);
+    while(words > 0) {
+        m = _load_le64(packet);
+        SIPCOMPRESS(m);
+        packet += 8;
+        words--;
+    }
+    if(taillen >= 8) {
+        m = _load_le64(tail);
+        SIPCOMPRESS(m);
+        taillen -= 8;
+        memmove(tail, tail + 8, taillen);
+    }
+
+    /* Last block contains the message length modulo 256 in its MSB */
+    m = ((uint64_t) (pktlen + (noncebytes ? sizeof(noncebytes_t) : 0))) << 56;
+    for(uint8_t i = 0; i < taillen; i++) {
+        m |= ((uint64_t) tail[i]) << (8*i);
+    }
+    SIPCOMPRESS(m);
+
+    v2 ^= wide ? 0xee : 0xff;
+    for(uint8_t r = 0; r < SIPHASH_D_ROUNDS; r++) {
+        SIPROUND;
+    }
+    _store_le64(out, v0 ^ v1 ^ v2 ^ v3);
+
+    if(wide) {
+        v1 ^= 0xdd;
+        for(uint8_t r = 0; r < SIPHASH_D_ROUNDS; r++) {
+            SIPROUND;
+        }
+        _store_le64(out + 8, v0 ^ v1 ^ v2 ^ v3);
+    }
+}
+
+/**********************************************************
+ *                     HalfSipHash                        *
+ **********************************************************/
+
+#define ROTL32(x, b)    (uint32_t) (((x) << (b)) | ((x) >> (32 - (b))))
+
+#define HSIPROUND do { \
+    v0 += v1; v1 = ROTL32(v1, 5); v1 ^= v0; v0 = ROTL32(v0, 16); \
+    v2 += v3; v3 = ROTL32(v3, 8); v3 ^= v2; \
+    v0 += v3; v3 = ROTL32(v3, 7); v3 ^= v0; \
+    v2 += v1; v1 = ROTL32(v1, 13); v1 ^= v2; v2 = ROTL32(v2, 16); \
+} while(0)
+
+#define HSIPCOMPRESS(m) do { \
+    v3 ^= (m); \
+    for(uint8_t r = 0; r < SIPHASH_C_ROUNDS; r++) { HSIPROUND; } \
+    v0 ^= (m); \
+} while(0)
+
+static void _halfsiphash(uint64_t const key[2], in_buffer_t packet, bufsize_t pktlen,
+    noncebytes_t const* noncebytes, bitcount_t macbits, out_buffer_t out) {
+
+    bool const wide = macbits > 32;
+    uint32_t const k0 = (uint32_t) key[0];
+    uint32_t const k1 = (uint32_t) (key[0] >> 32);
+    uint32_t v0 = k0;
+    uint32_t v1 = k1;
+    uint32_t v2 = 0x6c796765 ^ k0;
+    uint32_t v3 = 0x74656462 ^ k1;
+    uint8_t tail[16];
+    bufsize_t taillen;
+    uint32_t m;
+
+    if(wide) {
+        v1 ^= 0xee;
+    }
+
+    bufsize_t words = _sip_split(packet, pktlen, noncebytes, 4, tail, &taillen);
+    while(words > 0) {
+        m = _load_le32(packet);
+        HSIPCOMPRESS(m);
+        packet += 4;
+        words--;
+    }
+    uint8_t const* t = tail;
+    while(taillen >= 4) {
+        m = _load_le32(t);
+        HSIPCOMPRESS(m);
+        t += 4;
+        taillen -= 4;
+    }
+
+    /* Last block contains the message length modulo 256 in its MSB */
+    m = ((uint32_t) (pktlen + (noncebytes ? sizeof(noncebytes_t) : 0))) << 24;
+    for(uint8_t i = 0; i < taillen; i++) {
+        m |= ((uint32_t) t[i]) << (8*i);
+    }
+    HSIPCOMPRESS(m);
+
+    v2 ^= wide ? 0xee : 0xff;
+    for(uint8_t r = 0; r < SIPHASH_D_ROUNDS; r++) {
+        HSIPROUND;
+    }
+    _store_le32(out, v1 ^ v3);
+
+    if(wide) {
+        v1 ^= 0xdd;
+        for(uint8_t r = 0; r < SIPHASH_D_ROUNDS; r++) {
+            HSIPROUND;
+        }
+        _store_le32(out + 4, v1 ^ v3);
+    }
+}
+
+/**********************************************************
+ *                    Module functions                    *
+ **********************************************************/
+
+/**
+ * \param maxout Output bytes of the hash, longer MACs would be zero padded
+ */
+static void* _sip_create(bufsize_t maclen, bufsize_t maxout) {
+    struct SipHashData* data;
+
+    if(maclen > maxout) {
+        error("MAC of %u bytes exceeds the %u byte output of (Half)SipHash", (unsigned int) maclen, (unsigned int) maxout);
+        return NULL;
+    }
+
+    data = (struct SipHashData*) mem_alloc(sizeof(struct SipHashData));
+    if(!data) {
+        return NULL;
+    }
+
+    memset(data->keys, 0, sizeof(data->keys));
+    return data;
+}
+
+void* siphash_create(bufsize_t maclen) {
+    return _sip_create(maclen, SIPHASH_MAX_OUT);
+}
+
+void* halfsiphash_create(bufsize_t maclen) {
+    return _sip_create(maclen, HALFSIPHASH_MAX_OUT);
+}
+
+void siphash_destroy(void* self) {
+    mem_free(self);
+}
+
+static out_buffer_t _sip_sign(_sip_fn_t* fn, void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct SipHashData* data = (struct SipHashData*) self;
+    bufsize_t const bytes = ceil_bits_to_bytes(macbits + extrabits);
+    memset(data->buffer, 0, bytes);
+
+    fn(data->keys[SIPHASH_KEYSLOT_SEND], packet, pktlen, noncebytes, macbits, data->buffer);
+
+    eval_timer_measure_mod("end mac");
+    /* Automatic truncation by library core */
+    return data->buffer;
+}
+
+static int16_t _sip_verify(_sip_fn_t* fn, void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+
+    eval_timer_measure_mod("begin mac");
+
+    struct SipHashData* data = (struct SipHashData*) self;
+    memset(data->buffer, 0, ceil_bits_to_bytes(bits));
+
+    fn(data->keys[SIPHASH_KEYSLOT_RECV], packet, pktlen, noncebytes, bits, data->buffer);
+
+    bool const valid = mac_equal_bits(mac, data->buffer, bits);
+
+    eval_timer_measure_mod("end mac");
+    return valid ? bits : -bits;
+}
+
+out_buffer_t siphash_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+    return _sip_sign(&_siphash, self, packet, pktlen, macbits, extrabits, noncebytes);
+}
+
+int16_t siphash_verify(void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+    return _sip_verify(&_siphash, self, packet, pktlen, mac, bits, noncebytes);
+}
+
+out_buffer_t halfsiphash_sign(void* self, in_buffer_t packet, bufsize_t pktlen,
+    bitcount_t macbits, bitcount_t extrabits, noncebytes_t const* noncebytes) {
+    return _sip_sign(&_halfsiphash, self, packet, pktlen, macbits, extrabits, noncebytes);
+}
+
+int16_t halfsiphash_verify(void* self, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes) {
+    return _sip_verify(&_halfsiphash, self, packet, pktlen, mac, bits, noncebytes);
+}
+
+void siphash_set_keys(void* self, void const* keys) {
+    struct SipHashData* data = (struct SipHashData*) self;
+    uint8_t const (*k)[SIPHASH_KEY_SIZE] = (uint8_t const (*)[SIPHASH_KEY_SIZE]) keys;
+
+    if(keys) {
+        /* Assume the caller knows the key format */
+        for(uint8_t s = 0; s < 2; s++) {
+            data->keys[s][0] = _load_le64(k[s]);
+            data->keys[s][1] = _load_le64(k[s] + 8);
+        }
+    }
+}
+
+mac_module_t siphash_module = {
+    &siphash_create,
+    &siphash_destroy,
+    &siphash_sign,
+    &siphash_verify,
+    &siphash_set_keys,
+    NULL,
+    false
+};
+
+mac_module_t halfsiphash_module = {
+    &halfsiphash_create,
+    &siphash_destroy,
+    &halfsiphash_sign,
+    &halfsiphash_verify,
+    &siphash_set_keys,
+    NULL,
+    false
+};
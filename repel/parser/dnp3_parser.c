@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * DNP3 link-layer parser.
+ *
+ * Link-layer frames start with a ten byte header, whose CRC-16 covers the start bytes,
+ * length, control, and addresses, followed by user data in 16 byte blocks, each with its
+ * own CRC. The parser embeds MAC bits in the constant start bytes, and optionally in the
+ * addresses of a connection between one master and one outstation. Only the header
+ * block changes, so only its CRC is recomputed, data blocks pass through untouched.
+ *
+ * The transport and application sequence numbers of frames with user data are no nonce:
+ * they wrap after 64 and 16 fragments and restart with the association, so a replayed
+ * fragment would still verify. All frames therefore carry embedded nonce bits.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel.h"
+#include "../repel_modules.h"
+#include "../repel_log.h"
+
+#include "platform.h"
+#include "../bitstring.h"
+#include "../crc16.h"
+#include "../eval_timer.h"
+
+/**********************************************************
+ *            Parameters to configure parser              *
+ **********************************************************/
+
+#ifndef DNP3_IS_MASTER
+/* Whether device has master role on connection */
+#define DNP3_IS_MASTER true
+#endif
+
+#ifndef DNP3_REUSE_ADDRESSES
+#define DNP3_REUSE_ADDRESSES false
+#endif
+
+#ifndef DNP3_MASTER_ADDRESS
+#define DNP3_MASTER_ADDRESS 1
+#endif
+
+#ifndef DNP3_OUTSTATION_ADDRESS
+#define DNP3_OUTSTATION_ADDRESS 10
+#endif
+
+/**********************************************************
+ *                 Parser implementation                  *
+ **********************************************************/
+
+#define DNP3_START_1    0x05
+#define DNP3_START_2    0x64
+#define DNP3_HEADER_LEN 8   /* Without CRC */
+#define DNP3_BLOCK_LEN  16
+#define DNP3_CRC_LEN    2
+/* Control and addresses counted by the length field */
+#define DNP3_LEN_MIN    5
+
+struct DNP3State {
+    bool is_master;
+    bool reuse_addresses;
+    uint16_t master_address;
+    uint16_t outstation_address;
+};
+
+static dnp3_config_t const dnp3_default_config = {
+    DNP3_IS_MASTER, DNP3_REUSE_ADDRESSES, DNP3_MASTER_ADDRESS, DNP3_OUTSTATION_ADDRESS
+};
+
+static inline void _set_header_crc(inout_buffer_t packet) {
+    uint16_t const crc = crc16_dnp(packet, DNP3_HEADER_LEN);
+    packet[DNP3_HEADER_LEN] = crc & 0xff;
+    packet[DNP3_HEADER_LEN + 1] = crc >> 8;
+}
+
+/**
+ * Sets a little endian address, returns whether it changed
+ */
+static inline bool _set_address(inout_buffer_t field, uint16_t address) {
+    bool const changed = field[0] != (address & 0xff) || field[1] != (address >> 8);
+    field[0] = address & 0xff;
+    field[1] = address >> 8;
+    return changed;
+}
+
+void* dnp3_create(void const* config, bitcount_t* max_embed_bits) {
+    dnp3_config_t const* conf = config ? (dnp3_config_t const*) config : &dnp3_default_config;
+
+    struct DNP3State* state = (struct DNP3State*) mem_alloc(sizeof(struct DNP3State));
+    if(!state) {
+        return NULL;
+    }
+    state->is_master = conf->is_master;
+    state->reuse_addresses = conf->reuse_addresses;
+    state->master_address = conf->master_address;
+    state->outstation_address = conf->outstation_address;
+
+    *max_embed_bits = 16;
+    if(conf->reuse_addresses) {
+        *max_embed_bits += 32;
+    }
+    return state;
+}
+
+void dnp3_destroy(void* self) {
+    mem_free(self);
+}
+
+parse_result_t dnp3_parse(void* self, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin parse");
+    state_from(struct DNP3State, self);
+
+    parse_fail_on_minlen(DNP3_HEADER_LEN + DNP3_CRC_LEN, buflen);
+
+    parse_result_t res;
+    res.pktlen = 0;
+    res.embed_bits = 0;
+    res.packet_has_nonce = false;
+
+    /* Start bytes carry MAC bits on authentication */
+    if(mode == EMBED && (packet[0] != DNP3_START_1 || packet[1] != DNP3_START_2)) {
+        error("DNP3 parser: Invalid start bytes 0x%x 0x%x", packet[0], packet[1]);
+        return res;
+    }
+    if(packet[2] < DNP3_LEN_MIN) {
+        error("DNP3 parser: Invalid length %u", packet[2]);
+        return res;
+    }
+
+    uint16_t const userlen = packet[2] - DNP3_LEN_MIN;
+    uint16_t const blocks = (userlen + DNP3_BLOCK_LEN - 1) / DNP3_BLOCK_LEN;
+    int32_t const pktlen = DNP3_HEADER_LEN + DNP3_CRC_LEN + userlen + (blocks * DNP3_CRC_LEN);
+    parse_fail_on_minlen(pktlen, buflen);
+
+    res.pktlen = pktlen;
+    res.embed_bits = 16 + (state->reuse_addresses ? 32 : 0);
+
+    eval_timer_measure_mod("end parse");
+    return res;
+}
+
+void dnp3_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) {
+    eval_timer_measure_mod("begin embed");
+    UNUSED(pktlen);
+    state_from(struct DNP3State, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    /* Start bytes */
+    bitstring_copy_u16(&pkt, &mac, 16);
+
+    if(state->reuse_addresses) {
+        /* Length, control */
+        bitstring_skip(&pkt, 16);
+        /* Destination, source */
+        bitstring_copy_u16(&pkt, &mac, 16);
+        bitstring_copy_u16(&pkt, &mac, 16);
+    }
+    _set_header_crc(packet);
+    eval_timer_measure_mod("end embed");
+}
+
+void dnp3_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) {
+    eval_timer_measure_mod("begin extract");
+    UNUSED(pktlen);
+    state_from(struct DNP3State, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    /* Start bytes */
+    bitstring_copy_u16(&mac, &pkt, 16);
+
+    if(state->reuse_addresses) {
+        /* Length, control */
+        bitstring_skip(&pkt, 16);
+        /* Destination, source */
+        bitstring_copy_u16(&mac, &pkt, 16);
+        bitstring_copy_u16(&mac, &pkt, 16);
+    }
+    eval_timer_measure_mod("end extract");
+}
+
+void dnp3_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin restore");
+    UNUSED(pktlen);
+    state_from(struct DNP3State, self);
+
+    bool changed = packet[0] != DNP3_START_1 || packet[1] != DNP3_START_2;
+    packet[0] = DNP3_START_1;
+    packet[1] = DNP3_START_2;
+
+    if(state->reuse_addresses) {
+        bool const from_master = state->is_master == (mode == EMBED);
+        uint16_t const dest = from_master ? state->outstation_address : state->master_address;
+        uint16_t const src = from_master ? state->master_address : state->outstation_address;
+
+        changed |= _set_address(packet + 4, dest);
+        changed |= _set_address(packet + 6, src);
+    }
+
+    /* An unmodified header keeps its CRC, which the MAC covers */
+    if(changed) {
+        _set_header_crc(packet);
+    }
+    eval_timer_measure_mod("end restore");
+}
+
+parser_module_t dnp3_parser = {
+    dnp3_create,
+    dnp3_destroy,
+    dnp3_parse,
+    dnp3_embed,
+    dnp3_extract,
+    dnp3_restore,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
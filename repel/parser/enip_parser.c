@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * EtherNet/IP encapsulation parser.
+ *
+ * Every encapsulated packet starts with a 24 byte header. Its options field must be zero,
+ * and targets echo the originator's sender context in their replies, so both carry MAC bits.
+ * The first sender context byte is kept as slot of the originator's context, which the
+ * originator restores when a reply verifies. Lost replies thus only leave a stale slot.
+ * The session handle is not touched, see enip_sessions.h to find a packet's connection.
+ * Parsing, embedding, and restoring neither allocate nor depend on previous packets.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel.h"
+#include "../repel_modules.h"
+#include "../repel_log.h"
+
+#include <string.h>
+
+#include "platform.h"
+#include "../bitstring.h"
+#include "../eval_timer.h"
+
+/**********************************************************
+ *            Parameters to configure parser              *
+ **********************************************************/
+
+#ifndef ENIP_IS_ORIGINATOR
+/* Whether device originates requests on connection, e.g., a scanner */
+#define ENIP_IS_ORIGINATOR true
+#endif
+
+#ifndef ENIP_REUSE_SENDER_CONTEXT
+#define ENIP_REUSE_SENDER_CONTEXT true
+#endif
+
+/**
+ * Sender contexts of outstanding requests an originator restores, power of two up to 256
+ */
+#ifndef ENIP_PENDING_CONTEXTS
+#ifdef CONTIKI
+#define ENIP_PENDING_CONTEXTS 4
+#else
+#define ENIP_PENDING_CONTEXTS 64
+#endif
+#endif
+
+#if ENIP_PENDING_CONTEXTS > 256 || (ENIP_PENDING_CONTEXTS & (ENIP_PENDING_CONTEXTS - 1)) != 0
+#error ENIP_PENDING_CONTEXTS must be a power of two up to 256
+#endif
+
+/**********************************************************
+ *                 Parser implementation                  *
+ **********************************************************/
+
+#define ENIP_HEADER_LEN         24
+#define ENIP_CONTEXT_OFFSET     12
+#define ENIP_CONTEXT_LEN        8
+#define ENIP_OPTIONS_OFFSET     20
+
+struct EnipState {
+    bool is_originator;
+    bool reuse_sender_context;
+    uint8_t next_slot;
+    uint8_t contexts[ENIP_PENDING_CONTEXTS][ENIP_CONTEXT_LEN];
+};
+
+static enip_config_t const enip_default_config = {
+    ENIP_IS_ORIGINATOR, ENIP_REUSE_SENDER_CONTEXT
+};
+
+/**
+ * Commands whose replies echo the request's sender context
+ */
+static inline bool _echoes_context(in_buffer_t packet) {
+    switch(packet[0] | (packet[1] << 8)) {
+        case 0x0004: /* ListServices */
+        case 0x0063: /* ListIdentity */
+        case 0x0064: /* ListInterfaces */
+        case 0x0065: /* RegisterSession */
+        case 0x006f: /* SendRRData */
+            return true;
+        default:
+            return false;
+    }
+}
+
+void* enip_create(void const* config, bitcount_t* max_embed_bits) {
+    enip_config_t const* conf = config ? (enip_config_t const*) config : &enip_default_config;
+
+    struct EnipState* state = (struct EnipState*) mem_alloc(sizeof(struct EnipState));
+    if(!state) {
+        return NULL;
+    }
+    memset(state, 0, sizeof(struct EnipState));
+    state->is_originator = conf->is_originator;
+    state->reuse_sender_context = conf->reuse_sender_context;
+
+    /* Options, sender context without slot */
+    *max_embed_bits = 32;
+    if(conf->reuse_sender_context) {
+        *max_embed_bits += 56;
+    }
+    return state;
+}
+
+void enip_destroy(void* self) {
+    mem_free(self);
+}
+
+parse_result_t enip_parse(void* self, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin parse");
+    UNUSED(mode);
+    state_from(struct EnipState, self);
+
+    parse_fail_on_minlen(ENIP_HEADER_LEN, buflen);
+
+    int32_t const pktlen = ENIP_HEADER_LEN + (packet[2] | (packet[3] << 8));
+    parse_fail_on_minlen(pktlen, buflen);
+
+    parse_result_t res;
+    res.pktlen = pktlen;
+    res.embed_bits = state->reuse_sender_context ? 32 + 56 : 32;
+    res.packet_has_nonce = false;
+
+    eval_timer_measure_mod("end parse");
+    return res;
+}
+
+void enip_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) {
+    eval_timer_measure_mod("begin embed");
+    UNUSED(pktlen);
+    state_from(struct EnipState, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    /* Command, length, session handle, status */
+    bitstring_skip(&pkt, 96);
+
+    /* Sender context */
+    if(state->reuse_sender_context) {
+        bitstring_skip(&pkt, 8);
+        bitstring_copy_u64(&pkt, &mac, 56);
+    } else {
+        bitstring_skip(&pkt, 64);
+    }
+
+    /* Options */
+    bitstring_copy_u32(&pkt, &mac, 32);
+    eval_timer_measure_mod("end embed");
+}
+
+void enip_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) {
+    eval_timer_measure_mod("begin extract");
+    UNUSED(pktlen);
+    state_from(struct EnipState, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    /* Command, length, session handle, status */
+    bitstring_skip(&pkt, 96);
+
+    /* Sender context */
+    if(state->reuse_sender_context) {
+        bitstring_skip(&pkt, 8);
+        bitstring_copy_u64(&mac, &pkt, 56);
+    } else {
+        bitstring_skip(&pkt, 64);
+    }
+
+    /* Options */
+    bitstring_copy_u32(&mac, &pkt, 32);
+    eval_timer_measure_mod("end extract");
+}
+
+void enip_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin restore");
+    UNUSED(pktlen);
+    state_from(struct EnipState, self);
+
+    if(state->reuse_sender_context) {
+        inout_buffer_t context = packet + ENIP_CONTEXT_OFFSET;
+
+        if(state->is_originator && mode == EMBED) {
+            /* Save the context of requests, its slot is sent along and echoed */
+            uint8_t slot = 0;
+            if(_echoes_context(packet)) {
+                slot = state->next_slot;
+                state->next_slot = (slot + 1) & (ENIP_PENDING_CONTEXTS - 1);
+                memcpy(state->contexts[slot], context, ENIP_CONTEXT_LEN);
+            }
+            context[0] = slot;
+        }
+        memset(context + 1, 0, ENIP_CONTEXT_LEN - 1);
+    }
+    memset(packet + ENIP_OPTIONS_OFFSET, 0, 4);
+    eval_timer_measure_mod("end restore");
+}
+
+void enip_verified(void* self, inout_buffer_t packet, bufsize_t pktlen) {
+    eval_timer_measure_mod("begin verified");
+    UNUSED(pktlen);
+    state_from(struct EnipState, self);
+
+    /* Originators restore the sender context of replies */
+    if(state->is_originator && state->reuse_sender_context && _echoes_context(packet)) {
+        inout_buffer_t context = packet + ENIP_CONTEXT_OFFSET;
+        memcpy(context, state->contexts[context[0] & (ENIP_PENDING_CONTEXTS - 1)], ENIP_CONTEXT_LEN);
+    }
+    eval_timer_measure_mod("end verified");
+}
+
+parser_module_t enip_parser = {
+    enip_create,
+    enip_destroy,
+    enip_parse,
+    enip_embed,
+    enip_extract,
+    enip_restore,
+    enip_verified,
+    NULL,
+    NULL,
+    NULL
+};
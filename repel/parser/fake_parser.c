@@ -59,7 +59,8 @@
 /* create functions currently do not accept no state */
 uint8_t fake_state;
 
-void* fake_create(bitcount_t* max_embed_bits) {
+void* fake_create(void const* config, bitcount_t* max_embed_bits) {
+    UNUSED(config);
     *max_embed_bits = MAX_MAC_BITS;
     return &fake_state;
 }
@@ -139,5 +140,8 @@ parser_module_t fake_parser = {
     fake_embed,
     fake_extract,
     fake_restore,
+    NULL,
+    NULL,
+    NULL,
     NULL
 };
\ No newline at end of file
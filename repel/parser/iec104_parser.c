@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * IEC 60870-5-104 parser.
+ *
+ * Each APDU starts with the APCI: start byte, length, and four control octets, which hold
+ * the send and receive sequence numbers of I-format frames. The start byte and unused control
+ * bits carry MAC and nonce bits, optionally together with the ASDU common address of a connection
+ * to a single station. S- and U-format frames repeat their contents.
+ *
+ * The sequence numbers are not used as nonce: they restart at zero with every TCP connection and
+ * STARTDT, and wrap after 32768 I-frames, so I-frames would verify again on the next connection.
+ * All frames carry embedded nonce bits instead, which leaves I-frames without common address
+ * 9 bits minus the nonce bits for the MAC. TCP delivers frames in order, so few nonce bits suffice.
+ * Use repel_embed_segment and repel_authenticate_segment to handle all APDUs of a TCP segment at once.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel.h"
+#include "../repel_modules.h"
+#include "../repel_log.h"
+
+#include "platform.h"
+#include "../bitstring.h"
+#include "../eval_timer.h"
+
+/**********************************************************
+ *            Parameters to configure parser              *
+ **********************************************************/
+
+#ifndef IEC104_REUSE_COMMON_ADDRESS
+#define IEC104_REUSE_COMMON_ADDRESS false
+#endif
+
+#ifndef IEC104_COMMON_ADDRESS
+#define IEC104_COMMON_ADDRESS 1
+#endif
+
+/**********************************************************
+ *                 Parser implementation                  *
+ **********************************************************/
+
+#define IEC104_START        0x68
+#define IEC104_APCI_LEN     6
+/* Control octets counted by the length field */
+#define IEC104_LEN_MIN      4
+#define IEC104_LEN_MAX      253
+/* Type, variable structure qualifier, cause of transmission, common address */
+#define IEC104_CA_OFFSET    (IEC104_APCI_LEN + 4)
+
+enum IEC104Format {
+    IEC104_I_FORMAT,
+    IEC104_S_FORMAT,
+    IEC104_U_FORMAT
+};
+
+struct IEC104State {
+    bool reuse_common_address;
+    uint16_t common_address;
+};
+
+static iec104_config_t const iec104_default_config = {
+    IEC104_REUSE_COMMON_ADDRESS, IEC104_COMMON_ADDRESS
+};
+
+static inline enum IEC104Format _format(in_buffer_t packet) {
+    if((packet[2] & 0x01) == 0) {
+        return IEC104_I_FORMAT;
+    }
+    return (packet[2] & 0x02) == 0 ? IEC104_S_FORMAT : IEC104_U_FORMAT;
+}
+
+static inline bool _has_common_address(struct IEC104State* state, bufsize_t pktlen) {
+    return state->reuse_common_address && pktlen >= IEC104_CA_OFFSET + 2;
+}
+
+void* iec104_create(void const* config, bitcount_t* max_embed_bits) {
+    iec104_config_t const* conf = config ? (iec104_config_t const*) config : &iec104_default_config;
+
+    struct IEC104State* state = (struct IEC104State*) mem_alloc(sizeof(struct IEC104State));
+    if(!state) {
+        return NULL;
+    }
+    state->reuse_common_address = conf->reuse_common_address;
+    state->common_address = conf->common_address;
+
+    /* U-format frames have most unused bits */
+    *max_embed_bits = 32;
+    return state;
+}
+
+void iec104_destroy(void* self) {
+    mem_free(self);
+}
+
+parse_result_t iec104_parse(void* self, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin parse");
+    state_from(struct IEC104State, self);
+
+    parse_fail_on_minlen(2, buflen);
+
+    parse_result_t res;
+    res.pktlen = 0;
+    res.embed_bits = 0;
+    res.packet_has_nonce = false;
+
+    /* Start byte carries MAC bits on authentication */
+    if(mode == EMBED && packet[0] != IEC104_START) {
+        error("IEC 104 parser: Invalid start byte 0x%x", packet[0]);
+        return res;
+    }
+    if(packet[1] < IEC104_LEN_MIN || packet[1] > IEC104_LEN_MAX) {
+        error("IEC 104 parser: Invalid length %u", packet[1]);
+        return res;
+    }
+
+    int32_t const pktlen = packet[1] + 2;
+    parse_fail_on_minlen(pktlen, buflen);
+    res.pktlen = pktlen;
+
+    switch(_format(packet)) {
+        case IEC104_I_FORMAT:
+            /* Start byte, receive sequence number LSB */
+            res.embed_bits = 8 + 1;
+            if(_has_common_address(state, pktlen)) {
+                res.embed_bits += 16;
+            }
+            break;
+        case IEC104_S_FORMAT:
+            /* Start byte, control octets 1 and 2 except format bits, receive sequence number LSB */
+            res.embed_bits = 8 + 6 + 8 + 1;
+            break;
+        case IEC104_U_FORMAT:
+            /* Start byte, control octets 2 to 4 */
+            res.embed_bits = 8 + 24;
+            break;
+    }
+
+    eval_timer_measure_mod("end parse");
+    return res;
+}
+
+void iec104_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) {
+    eval_timer_measure_mod("begin embed");
+    state_from(struct IEC104State, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    enum IEC104Format const format = _format(packet);
+
+    /* Start byte */
+    bitstring_copy_u8(&pkt, &mac, 8);
+    /* Length */
+    bitstring_skip(&pkt, 8);
+
+    switch(format) {
+        case IEC104_I_FORMAT:
+            bitstring_skip(&pkt, 16 + 7);
+            bitstring_copy_u8(&pkt, &mac, 1);
+            if(_has_common_address(state, pktlen)) {
+                bitstring_skip(&pkt, 8 + 32);
+                bitstring_copy_u16(&pkt, &mac, 16);
+            }
+            break;
+        case IEC104_S_FORMAT:
+            bitstring_copy_u8(&pkt, &mac, 6);
+            bitstring_skip(&pkt, 2);
+            bitstring_copy_u8(&pkt, &mac, 8);
+            bitstring_skip(&pkt, 7);
+            bitstring_copy_u8(&pkt, &mac, 1);
+            break;
+        case IEC104_U_FORMAT:
+            bitstring_skip(&pkt, 8);
+            bitstring_copy_u32(&pkt, &mac, 24);
+            break;
+    }
+    eval_timer_measure_mod("end embed");
+}
+
+void iec104_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) {
+    eval_timer_measure_mod("begin extract");
+    state_from(struct IEC104State, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    enum IEC104Format const format = _format(packet);
+
+    /* Start byte */
+    bitstring_copy_u8(&mac, &pkt, 8);
+    /* Length */
+    bitstring_skip(&pkt, 8);
+
+    switch(format) {
+        case IEC104_I_FORMAT:
+            bitstring_skip(&pkt, 16 + 7);
+            bitstring_copy_u8(&mac, &pkt, 1);
+            if(_has_common_address(state, pktlen)) {
+                bitstring_skip(&pkt, 8 + 32);
+                bitstring_copy_u16(&mac, &pkt, 16);
+            }
+            break;
+        case IEC104_S_FORMAT:
+            bitstring_copy_u8(&mac, &pkt, 6);
+            bitstring_skip(&pkt, 2);
+            bitstring_copy_u8(&mac, &pkt, 8);
+            bitstring_skip(&pkt, 7);
+            bitstring_copy_u8(&mac, &pkt, 1);
+            break;
+        case IEC104_U_FORMAT:
+            bitstring_skip(&pkt, 8);
+            bitstring_copy_u32(&mac, &pkt, 24);
+            break;
+    }
+    eval_timer_measure_mod("end extract");
+}
+
+void iec104_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin restore");
+    UNUSED(mode);
+    state_from(struct IEC104State, self);
+
+    packet[0] = IEC104_START;
+
+    switch(_format(packet)) {
+        case IEC104_I_FORMAT:
+            packet[4] &= 0xfe;
+            if(_has_common_address(state, pktlen)) {
+                packet[IEC104_CA_OFFSET] = state->common_address & 0xff;
+                packet[IEC104_CA_OFFSET + 1] = state->common_address >> 8;
+            }
+            break;
+        case IEC104_S_FORMAT:
+            packet[2] = 0x01;
+            packet[3] = 0x00;
+            packet[4] &= 0xfe;
+            break;
+        case IEC104_U_FORMAT:
+            packet[3] = 0x00;
+            packet[4] = 0x00;
+            packet[5] = 0x00;
+            break;
+    }
+    eval_timer_measure_mod("end restore");
+}
+
+parser_module_t iec104_parser = {
+    iec104_create,
+    iec104_destroy,
+    iec104_parse,
+    iec104_embed,
+    iec104_extract,
+    iec104_restore,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
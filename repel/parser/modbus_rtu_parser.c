@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Modbus RTU parser for serial lines and RTU over TCP.
+ *
+ * RTU frames have no spare fields, so the parser embeds MAC bits in the leading bits
+ * of fields that the specification limits to smaller values, e.g., the quantity of
+ * registers to read, and optionally in the slave address of a device that is alone
+ * on its connection. Embedding and restoring recompute the frame's CRC-16 when they
+ * modify the frame, so that devices receive valid frames.
+ *
+ * Many frames have no limited field: requests of functions 5, 6, 7, 8, 11, 12, 17, and 22,
+ * and most responses. Only the slave address carries their MAC bits, so the address is reused
+ * by default. Without address reuse, e.g., for several devices on one serial line, these frames
+ * are left unprotected, which the parser warns about on creation and for each such frame.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "../repel.h"
+#include "../repel_modules.h"
+#include "../repel_log.h"
+
+#include "platform.h"
+#include "../bitstring.h"
+#include "../crc16.h"
+#include "../eval_timer.h"
+
+/**********************************************************
+ *            Parameters to configure parser              *
+ **********************************************************/
+
+#ifndef MODBUS_RTU_IS_CLIENT
+/* Whether device has client (master) role on connection */
+#define MODBUS_RTU_IS_CLIENT true
+#endif
+
+#ifndef MODBUS_RTU_REUSE_ADDRESS
+/* Frames without limited fields are only protected with address reuse */
+#define MODBUS_RTU_REUSE_ADDRESS true
+#endif
+
+#ifndef MODBUS_RTU_ADDRESS
+#define MODBUS_RTU_ADDRESS 1
+#endif
+
+/**********************************************************
+ *                 Parser implementation                  *
+ **********************************************************/
+
+#define RTU_CRC_LEN 2
+
+struct ModbusRTUState {
+    bool is_client;
+    bool reuse_address;
+    uint8_t address;
+};
+
+static modbus_rtu_config_t const modbus_rtu_default_config = {
+    MODBUS_RTU_IS_CLIENT, MODBUS_RTU_REUSE_ADDRESS, MODBUS_RTU_ADDRESS
+};
+
+/**
+ * Length of a frame and the field whose leading bits are unused
+ */
+struct RTUFrame {
+    /**
+     * Frame length if positive, bytes missing if negative, zero for unknown functions
+     */
+    int32_t len;
+    /**
+     * Byte offset of the field
+     */
+    uint8_t field;
+    /**
+     * Leading bits of the field that are always zero
+     */
+    uint8_t spare;
+};
+
+#define frame_fail_on_minlen(minlen, buflen)  if(buflen < minlen) { return (struct RTUFrame) { ((int32_t) buflen) - ((int32_t) minlen), 0, 0 }; }
+
+static struct RTUFrame _request_frame(uint8_t const* pkt, bufsize_t buflen) {
+    switch(pkt[1]) {
+        case 1: /* Read Coils, at most 2000 */
+        case 2: /* Read Discrete Inputs */
+            return (struct RTUFrame) { 8, 4, 5 };
+        case 3: /* Read Holding Registers, at most 125 */
+        case 4: /* Read Input Registers */
+            return (struct RTUFrame) { 8, 4, 9 };
+        case 5: /* Write Single Coil */
+        case 6: /* Write Single Register */
+        case 8: /* Diagnostics */
+            return (struct RTUFrame) { 8, 0, 0 };
+        case 7: /* Read Exception Status */
+        case 11: /* Get Comm Event Counter */
+        case 12: /* Get Comm Event Log */
+        case 17: /* Report Server ID */
+            return (struct RTUFrame) { 4, 0, 0 };
+        case 15: /* Write Multiple Coils, at most 1968 */
+            frame_fail_on_minlen(7, buflen);
+            return (struct RTUFrame) { 9 + pkt[6], 4, 5 };
+        case 16: /* Write Multiple Registers, at most 123 */
+            frame_fail_on_minlen(7, buflen);
+            return (struct RTUFrame) { 9 + pkt[6], 4, 9 };
+        case 22: /* Mask Write Register */
+            return (struct RTUFrame) { 10, 0, 0 };
+        case 23: /* Read/Write Multiple Registers, reads at most 125 */
+            frame_fail_on_minlen(11, buflen);
+            return (struct RTUFrame) { 13 + pkt[10], 4, 9 };
+        default:
+            return (struct RTUFrame) { 0, 0, 0 };
+    }
+}
+
+static struct RTUFrame _response_frame(uint8_t const* pkt, bufsize_t buflen) {
+    if(pkt[1] & 0x80) {
+        /* Exception codes up to 0x0b */
+        return (struct RTUFrame) { 5, 2, 4 };
+    }
+    switch(pkt[1]) {
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+        case 12:
+        case 17:
+        case 23:
+            /* Byte count */
+            frame_fail_on_minlen(3, buflen);
+            return (struct RTUFrame) { 5 + pkt[2], 0, 0 };
+        case 5:
+        case 6:
+        case 8:
+        case 11:
+            return (struct RTUFrame) { 8, 0, 0 };
+        case 7:
+            return (struct RTUFrame) { 5, 0, 0 };
+        case 15: /* Echoes quantity */
+            return (struct RTUFrame) { 8, 4, 5 };
+        case 16:
+            return (struct RTUFrame) { 8, 4, 9 };
+        case 22:
+            return (struct RTUFrame) { 10, 0, 0 };
+        default:
+            return (struct RTUFrame) { 0, 0, 0 };
+    }
+}
+
+/**
+ * Clients send requests and receive responses, servers vice versa
+ */
+static inline struct RTUFrame _frame(struct ModbusRTUState* state, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) {
+    frame_fail_on_minlen(2, buflen);
+
+    bool const request = state->is_client == (mode == EMBED);
+    return request ? _request_frame(packet, buflen) : _response_frame(packet, buflen);
+}
+
+static inline void _set_crc(inout_buffer_t packet, bufsize_t pktlen) {
+    uint16_t const crc = crc16_modbus(packet, pktlen - RTU_CRC_LEN);
+    packet[pktlen - 2] = crc & 0xff;
+    packet[pktlen - 1] = crc >> 8;
+}
+
+void* modbus_rtu_create(void const* config, bitcount_t* max_embed_bits) {
+    modbus_rtu_config_t const* conf = config ? (modbus_rtu_config_t const*) config : &modbus_rtu_default_config;
+
+    struct ModbusRTUState* state = (struct ModbusRTUState*) mem_alloc(sizeof(struct ModbusRTUState));
+    if(!state) {
+        return NULL;
+    }
+    state->is_client = conf->is_client;
+    state->reuse_address = conf->reuse_address;
+    state->address = conf->address;
+
+    /* Quantity fields have the most spare bits */
+    *max_embed_bits = 9;
+    if(conf->reuse_address) {
+        *max_embed_bits += 8;
+    } else {
+        warn("Modbus RTU parser: Without address reuse, frames without limited fields are unprotected");
+    }
+    return state;
+}
+
+void modbus_rtu_destroy(void* self) {
+    mem_free(self);
+}
+
+parse_result_t modbus_rtu_parse(void* self, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin parse");
+    state_from(struct ModbusRTUState, self);
+
+    struct RTUFrame const frame = _frame(state, packet, buflen, mode);
+    parse_result_t res;
+    res.packet_has_nonce = false;
+    res.embed_bits = 0;
+
+    if(frame.len == 0) {
+        error("Modbus RTU parser: Unknown function 0x%x", packet[1]);
+    }
+    res.pktlen = frame.len;
+    if(frame.len > 0) {
+        parse_fail_on_minlen(frame.len, buflen);
+        res.embed_bits = frame.spare + (state->reuse_address ? 8 : 0);
+        if(res.embed_bits == 0) {
+            warn("Modbus RTU parser: Function 0x%x has no bits for a MAC without address reuse", packet[1]);
+        }
+    }
+
+    eval_timer_measure_mod("end parse");
+    return res;
+}
+
+void modbus_rtu_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) {
+    eval_timer_measure_mod("begin embed");
+    state_from(struct ModbusRTUState, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    struct RTUFrame const frame = _frame(state, packet, pktlen, EMBED);
+
+    /* Slave address */
+    if(state->reuse_address) {
+        bitstring_copy_u8(&pkt, &mac, 8);
+    } else {
+        bitstring_skip(&pkt, 8);
+    }
+    if(frame.spare > 0) {
+        bitstring_skip(&pkt, (frame.field - 1) * 8);
+        bitstring_copy_u16(&pkt, &mac, frame.spare);
+    }
+    _set_crc(packet, pktlen);
+    eval_timer_measure_mod("end embed");
+}
+
+void modbus_rtu_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) {
+    eval_timer_measure_mod("begin extract");
+    state_from(struct ModbusRTUState, self);
+    pkt_from(packet);
+    mac_from(macbuf);
+
+    struct RTUFrame const frame = _frame(state, packet, pktlen, AUTHENTICATE);
+
+    /* Slave address */
+    if(state->reuse_address) {
+        bitstring_copy_u8(&mac, &pkt, 8);
+    } else {
+        bitstring_skip(&pkt, 8);
+    }
+    if(frame.spare > 0) {
+        bitstring_skip(&pkt, (frame.field - 1) * 8);
+        bitstring_copy_u16(&mac, &pkt, frame.spare);
+    }
+    eval_timer_measure_mod("end extract");
+}
+
+void modbus_rtu_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) {
+    eval_timer_measure_mod("begin restore");
+    state_from(struct ModbusRTUState, self);
+
+    struct RTUFrame const frame = _frame(state, packet, pktlen, mode);
+    bool changed = false;
+
+    if(state->reuse_address && packet[0] != state->address) {
+        packet[0] = state->address;
+        changed = true;
+    }
+    if(frame.spare > 0) {
+        pkt_from(packet);
+        bitstring_skip(&pkt, frame.field * 8);
+        if(bitstring_peek_u16(&pkt, 0, frame.spare) != 0) {
+            bitstring_push_u16(&pkt, 0, frame.spare);
+            changed = true;
+        }
+    }
+
+    /* An unmodified frame keeps its CRC, which the MAC covers */
+    if(changed) {
+        _set_crc(packet, pktlen);
+    }
+    eval_timer_measure_mod("end restore");
+}
+
+parser_module_t modbus_rtu_parser = {
+    modbus_rtu_create,
+    modbus_rtu_destroy,
+    modbus_rtu_parse,
+    modbus_rtu_embed,
+    modbus_rtu_extract,
+    modbus_rtu_restore,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
@@ -40,6 +40,7 @@
  * 25.08.2021
  */
 
+#include "../repel.h"
 #include "../repel_modules.h"
 #include "../repel_log.h"
 
@@ -74,80 +75,199 @@
 
 #define MBAP_AND_FUNCTION_LEN   8
 
-#if MODBUS_TCP_REUSE_TID_BITS > 0
-static bufsize_t const tid_map_len = POW2(16 - MODBUS_TCP_REUSE_TID_BITS);
-#else
-static bufsize_t const tid_map_len = 1;
-#endif
-
 struct ModbusTCPState {
     /**
-     * Transaction Ids are remapped to the array indices.
-     * The transaction id zero is mapped to the value in tid0_index.
-     * All other zero map entries are unused.
+     * Transaction Id bits reused for MAC bits. The remaining bits index the transaction map.
+     */
+    uint8_t reuse_bits;
+    bool reuse_unit_id;
+    /**
+     * Transaction map entries, zero if Transaction Ids are not remapped, i.e., for servers
+     */
+    uint16_t map_len;
+    /**
+     * Free map ids are kept in a ring in the order they were freed,
+     * so that a map id is reused as late as possible.
+     */
+    uint16_t free_head;
+    uint16_t free_count;
+    /**
+     * Round trip histogram if measured. The send time of each map id follows the saved state.
      */
-    #if MODBUS_TCP_REUSE_TID_BITS > 0
-    uint16_t transaction_map[POW2(16 - MODBUS_TCP_REUSE_TID_BITS)];
-    #else
-    uint16_t transaction_map[1]; /* unused */
-    #endif
+    modbus_tcp_latency_t* latency;
+    /**
+     * Bitmap of map ids in use, followed by the transaction map, which stores
+     * the Transaction Id of each map id, and by the ring of free map ids.
+     * Located in the state, so that it can be saved by copying.
+     */
+    uint32_t used[];
+};
 
-    uint16_t tid0_index;
+static modbus_tcp_config_t const modbus_tcp_default_config = {
+    MODBUS_TCP_IS_CLIENT, MODBUS_TCP_REUSE_TID_BITS, MODBUS_TCP_REUSE_UNIT_ID, NULL
 };
 
-uint16_t _map_tid(struct ModbusTCPState* state, uint16_t tid) {
-    uint16_t ireserved = state->tid0_index;
+static inline uint16_t _used_words(uint16_t map_len) {
+    return (map_len + 31) / 32;
+}
+
+static inline uint16_t* _transaction_map(struct ModbusTCPState* state) {
+    return (uint16_t*) (state->used + _used_words(state->map_len));
+}
+
+static inline uint16_t* _free_ring(struct ModbusTCPState* state) {
+    return _transaction_map(state) + state->map_len;
+}
+
+static inline size_t _state_size(uint16_t map_len) {
+    return sizeof(struct ModbusTCPState) + _used_words(map_len) * sizeof(uint32_t) + 2 * (size_t) map_len * sizeof(uint16_t);
+}
 
-    if(ireserved < tid_map_len) {
-        return ireserved;
+/**
+ * Clock ticks at which the request of each map id was sent, zero if unknown
+ */
+static inline uint32_t* _sent_ticks(struct ModbusTCPState* state) {
+    return (uint32_t*) (_free_ring(state) + state->map_len);
+}
+
+static inline void _record_latency(modbus_tcp_latency_t* latency, uint32_t us) {
+    uint8_t bucket = 0;
+    while(bucket < MODBUS_TCP_LATENCY_BUCKETS - 1 && (us >> (bucket + 1)) > 0) {
+        bucket++;
     }
 
-    for(uint16_t i = 0; i < tid_map_len; i++) {
-        if(i != ireserved && state->transaction_map[i] == 0) {
-            if(tid == 0) {
-                state->tid0_index = i;
-            } else {
-                state->transaction_map[i] = tid;
-            }
-            return i;
+#ifdef CONTIKI
+    /* Single threaded, and 64 bit atomics need library support on microcontrollers */
+    latency->buckets[bucket]++;
+    latency->count++;
+    latency->sum_us += us;
+    if(us > latency->max_us) {
+        latency->max_us = us;
+    }
+#else
+    __atomic_fetch_add(&latency->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&latency->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&latency->sum_us, us, __ATOMIC_RELAXED);
+
+    uint32_t max = __atomic_load_n(&latency->max_us, __ATOMIC_RELAXED);
+    while(us > max && !__atomic_compare_exchange_n(&latency->max_us, &max, us, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#endif
+}
+
+uint32_t modbus_tcp_latency_percentile(modbus_tcp_latency_t const* latency, uint8_t percent) {
+    uint64_t total = 0;
+    for(uint8_t i = 0; i < MODBUS_TCP_LATENCY_BUCKETS; i++) {
+        total += latency->buckets[i];
+    }
+    if(total == 0) {
+        return 0;
+    }
+
+    uint64_t const rank = (total * (percent < 100 ? percent : 100) + 99) / 100;
+    uint64_t seen = 0;
+    for(uint8_t i = 0; i < MODBUS_TCP_LATENCY_BUCKETS - 1; i++) {
+        seen += latency->buckets[i];
+        if(seen >= rank && seen > 0) {
+            uint32_t const bound = ((uint32_t) 2 << i) - 1;
+            return bound < latency->max_us ? bound : latency->max_us;
         }
     }
-    error("Modbus TCP Client parser: Transaction Id Map is full.");
-    return tid % tid_map_len; /* Keep lower ID bits */
+    return latency->max_us;
 }
 
-uint16_t _unmap_tid(struct ModbusTCPState* state, uint16_t mapid) {
-    uint16_t tid =  state->transaction_map[mapid];
+uint16_t _map_tid(struct ModbusTCPState* state, uint16_t tid) {
+    if(state->free_count == 0) {
+        error("Modbus TCP Client parser: Transaction Id Map is full.");
+        return tid % state->map_len; /* Keep lower ID bits */
+    }
+
+    uint16_t const mapid = _free_ring(state)[state->free_head];
+    state->free_head = (state->free_head + 1) % state->map_len;
+    state->free_count--;
 
+    state->used[mapid / 32] |= (uint32_t) 1 << (mapid % 32);
+    _transaction_map(state)[mapid] = tid;
+    if(state->latency) {
+        uint32_t const now = (uint32_t) clk_ticks();
+        _sent_ticks(state)[mapid] = now != 0 ? now : 1;
+    }
+    return mapid;
+}
+
+static inline bool _mapid_used(struct ModbusTCPState* state, uint16_t mapid) {
+    return mapid < state->map_len && (state->used[mapid / 32] & ((uint32_t) 1 << (mapid % 32)));
+}
+
+static void _free_mapid(struct ModbusTCPState* state, uint16_t mapid) {
+    state->used[mapid / 32] &= ~((uint32_t) 1 << (mapid % 32));
+    _free_ring(state)[(state->free_head + state->free_count) % state->map_len] = mapid;
+    state->free_count++;
+}
+
+uint16_t _unmap_tid(struct ModbusTCPState* state, uint16_t mapid) {
     /* Hit empty entry */
-    if(tid == 0) {
-        if(mapid == state->tid0_index) {
-            /* Was not empty but stored TID is 0 */
-            state->tid0_index = tid_map_len;
-            return 0;
-        } else {
-            error("Modbus TCP Client parser: Unknown Map Id 0x%x. Treating as Transaction Id.", mapid);
-            return mapid;
+    if(!_mapid_used(state, mapid)) {
+        error("Modbus TCP Client parser: Unknown Map Id 0x%x. Treating as Transaction Id.", mapid);
+        return mapid;
+    }
+
+    _free_mapid(state, mapid);
+
+    if(state->latency && _sent_ticks(state)[mapid] != 0) {
+        /* Ticks wrap around, round trips are shorter. Narrower platform clocks wrap earlier */
+        uint32_t ticks = (uint32_t) clk_ticks() - _sent_ticks(state)[mapid];
+        if(sizeof(platform_time_t) < sizeof(uint32_t)) {
+            ticks = (platform_time_t) ticks;
         }
-    } else {
-        state->transaction_map[mapid] = 0;
-        return tid;
+        uint64_t const us = (uint64_t) ticks * 1000000 / clk_ticks_per_second();
+        _record_latency(state->latency, us < UINT32_MAX ? us : UINT32_MAX);
     }
+    return _transaction_map(state)[mapid];
 }
 
-void* modbus_tcp_create(bitcount_t* max_embed_bits) {
-    struct ModbusTCPState* state = (struct ModbusTCPState*) mem_alloc(sizeof(struct ModbusTCPState));
-    if(!state) {
+/**
+ * Empties the transaction map
+ */
+static void _reset_map(struct ModbusTCPState* state) {
+    state->free_head = 0;
+    state->free_count = state->map_len;
+    memset(state->used, 0, _used_words(state->map_len) * sizeof(uint32_t));
+    memset(_transaction_map(state), 0, state->map_len * sizeof(uint16_t));
+    for(uint16_t i = 0; i < state->map_len; i++) {
+        _free_ring(state)[i] = i;
+    }
+}
+
+void* modbus_tcp_create(void const* config, bitcount_t* max_embed_bits) {
+    modbus_tcp_config_t const* conf = config ? (modbus_tcp_config_t const*) config : &modbus_tcp_default_config;
+
+    if(conf->reuse_tid_bits >= 16) {
+        error("Modbus TCP parser: Cant reuse %u Transaction Identifier Bits", (unsigned int) conf->reuse_tid_bits);
         return NULL;
     }
-    memset(state->transaction_map, 0, tid_map_len);
-    state->tid0_index = tid_map_len;
 
-    *max_embed_bits = 16 + MODBUS_TCP_REUSE_TID_BITS;
+    /* Server does not remap */
+    uint16_t const map_len = conf->is_client && conf->reuse_tid_bits > 0 ? POW2(16 - conf->reuse_tid_bits) : 0;
 
-    #if MODBUS_TCP_REUSE_UNIT_ID
+    /* Send times are only kept if measured */
+    modbus_tcp_latency_t* const latency = map_len > 0 ? conf->latency : NULL;
+    size_t const sent_size = latency ? map_len * sizeof(uint32_t) : 0;
+
+    struct ModbusTCPState* state = (struct ModbusTCPState*) mem_alloc(_state_size(map_len) + sent_size);
+    if(!state) {
+        return NULL;
+    }
+    state->latency = latency;
+    state->reuse_bits = conf->reuse_tid_bits;
+    state->reuse_unit_id = conf->reuse_unit_id;
+    state->map_len = map_len;
+    _reset_map(state);
+    memset(_sent_ticks(state), 0, sent_size);
+
+    *max_embed_bits = 16 + conf->reuse_tid_bits;
+    if(conf->reuse_unit_id) {
         *max_embed_bits += 8;
-    #endif
+    }
 
     return state;
 }
@@ -156,11 +276,79 @@ void modbus_tcp_destroy(void* self) {
     mem_free(self);
 }
 
-parse_result_t modbus_tcp_parse(void* self, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) {
+/**
+ * Whether the free ring holds exactly the map ids not in use, so that loaded state cannot index beyond the map.
+ * Marks the free ids in the used bitmap to find duplicates and unmarks them again.
+ */
+static bool _valid_map(struct ModbusTCPState* state) {
+    uint16_t const map_len = state->map_len;
+
+    if(map_len == 0) {
+        return state->free_head == 0 && state->free_count == 0;
+    }
+    if(state->free_head >= map_len || state->free_count > map_len) {
+        return false;
+    }
+    /* Bits behind the map must be clear */
+    if(map_len % 32 != 0 && (state->used[map_len / 32] >> (map_len % 32)) != 0) {
+        return false;
+    }
+
+    uint16_t marked = 0;
+    bool valid = true;
+    while(marked < state->free_count) {
+        uint16_t const mapid = _free_ring(state)[(state->free_head + marked) % map_len];
+        if(mapid >= map_len || _mapid_used(state, mapid)) {
+            valid = false;
+            break;
+        }
+        state->used[mapid / 32] |= (uint32_t) 1 << (mapid % 32);
+        marked++;
+    }
+
+    uint32_t ids = 0;
+    for(uint16_t i = 0; i < _used_words(map_len); i++) {
+        for(uint32_t word = state->used[i]; word != 0; word &= word - 1) {
+            ids++;
+        }
+    }
+    while(marked > 0) {
+        marked--;
+        uint16_t const mapid = _free_ring(state)[(state->free_head + marked) % map_len];
+        state->used[mapid / 32] &= ~((uint32_t) 1 << (mapid % 32));
+    }
+    /* Free and used ids cover the map */
+    return valid && ids == map_len;
+}
+
+bool modbus_tcp_release_tid(repel_connection_t con, uint16_t tid) {
+    struct ModbusTCPState* state = (struct ModbusTCPState*) repel_parser_state(con, modbus_tcp_create);
+
+    if(!state) {
+        error("Modbus TCP parser: Releasing Transaction Id of a connection with another parser");
+        return false;
+    }
+
+    /* Servers do not remap. Requests are few, search the map */
+    for(uint16_t mapid = 0; mapid < state->map_len; mapid++) {
+        if(_mapid_used(state, mapid) && _transaction_map(state)[mapid] == tid) {
+            _free_mapid(state, mapid);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Packet functions take the role and Unit Identifier reuse as constant parameters.
+ * They are inlined into one function table per configuration below, which
+ * removes the checks from the packet path as with compile time parameters.
+ */
+
+static inline parse_result_t _parse(void* self, in_buffer_t packet, bufsize_t buflen, bool const reuse_unit_id) {
     eval_timer_measure_mod("begin parse");
+    state_from(struct ModbusTCPState, self);
     pkt_from(packet);
-    UNUSED(self);
-    UNUSED(mode);
 
     parse_result_t res;
     res.packet_has_nonce = false;
@@ -174,144 +362,218 @@ parse_result_t modbus_tcp_parse(void* self, in_buffer_t packet, bufsize_t buflen
     parse_fail_on_minlen(res.pktlen, buflen);
 
     /* There is a full packet in the buffer */
-    res.embed_bits = 16 + MODBUS_TCP_REUSE_TID_BITS;
+    res.embed_bits = 16 + state->reuse_bits;
 
-    #if MODBUS_TCP_REUSE_UNIT_ID
+    if(reuse_unit_id) {
         res.embed_bits += 8;
-    #endif
+    }
 
     eval_timer_measure_mod("end parse");
     return res;
 }
 
-void modbus_tcp_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) {
+static inline void _embed(void* self, inout_buffer_t packet, in_buffer_t macbuf, bool const reuse_unit_id) {
     eval_timer_measure_mod("begin embed");
+    state_from(struct ModbusTCPState, self);
     pkt_from(packet);
     mac_from(macbuf);
-    UNUSED(self);
-    UNUSED(pktlen);
 
     /* Transaction Identifier */
-    #if MODBUS_TCP_REUSE_TID_BITS > 0
-    bitstring_copy_u16(&pkt, &mac, MODBUS_TCP_REUSE_TID_BITS);
-    bitstring_skip(&pkt, 16 - MODBUS_TCP_REUSE_TID_BITS);
-
-    #else /* MODBUS_TCP_REUSE_TID_BITS <= 0 */
-    bitstring_skip(&pkt, 16);
-    #endif
+    if(state->reuse_bits > 0) {
+        bitstring_copy_u16(&pkt, &mac, state->reuse_bits);
+    }
+    bitstring_skip(&pkt, 16 - state->reuse_bits);
 
     /* Protocol Identifier */
     bitstring_copy_u16(&pkt, &mac, 16);
     /* Length */
     bitstring_skip(&pkt, 16);
 
-    #if MODBUS_TCP_REUSE_UNIT_ID
-    /* Unit Identifier */
-    bitstring_copy_u8(&pkt, &mac, 8);
-    #endif
+    if(reuse_unit_id) {
+        /* Unit Identifier */
+        bitstring_copy_u8(&pkt, &mac, 8);
+    }
     eval_timer_measure_mod("end embed");
 }
 
-void modbus_tcp_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) {
+static inline void _extract(void* self, inout_buffer_t packet, out_buffer_t macbuf, bool const reuse_unit_id) {
     eval_timer_measure_mod("begin extract");
+    state_from(struct ModbusTCPState, self);
     pkt_from(packet);
     mac_from(macbuf);
-    UNUSED(self);
-    UNUSED(pktlen);
 
     /* Transaction Identifier */
-    #if MODBUS_TCP_REUSE_TID_BITS > 0
-    bitstring_copy_u16(&mac, &pkt, MODBUS_TCP_REUSE_TID_BITS);
-    bitstring_skip(&pkt, 16 - MODBUS_TCP_REUSE_TID_BITS);
-
-    #else /* MODBUS_TCP_REUSE_TID_BITS <= 0 */
-    bitstring_skip(&pkt, 16);
-    #endif
+    if(state->reuse_bits > 0) {
+        bitstring_copy_u16(&mac, &pkt, state->reuse_bits);
+    }
+    bitstring_skip(&pkt, 16 - state->reuse_bits);
 
     /* Protocol Identifier */
     bitstring_copy_u16(&mac, &pkt, 16);
     /* Length */
     bitstring_skip(&pkt, 16);
 
-    #if MODBUS_TCP_REUSE_UNIT_ID
-    /* Unit Identifier */
-    bitstring_copy_u8(&mac, &pkt, 8);
-    #endif
+    if(reuse_unit_id) {
+        /* Unit Identifier */
+        bitstring_copy_u8(&mac, &pkt, 8);
+    }
     eval_timer_measure_mod("end extract");
 }
 
-void modbus_tcp_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) {
+static inline void _restore(void* self, inout_buffer_t packet, repel_mode_t mode, bool const is_client, bool const reuse_unit_id) {
     eval_timer_measure_mod("begin restore");
     state_from(struct ModbusTCPState, self);
     pkt_from(packet);
-    UNUSED(pktlen);
-    UNUSED(mode);
 
     /* Transaction Identifier */
-    #if MODBUS_TCP_REUSE_TID_BITS > 0
-    /* Only client remaps */
-    #if MODBUS_TCP_IS_CLIENT
-    /* Perform TID unmapping in verified and perform MAC calculation with mapped TID when receiving.
-        When sending, calculate MAC with mapped TID, perform mapping in restore. */
-    if(mode == EMBED) {
-        uint16_t tid = bitstring_peek_u16(&pkt, 0, 16);
-        uint16_t mapid = _map_tid(state, tid);
-        bitstring_push_u16(&pkt, 0, MODBUS_TCP_REUSE_TID_BITS);
-        bitstring_push_u16(&pkt, mapid, 16 - MODBUS_TCP_REUSE_TID_BITS);
+    if(state->reuse_bits > 0) {
+        /* Only client remaps, server expects small TIDs from client */
+        /* Perform TID unmapping in verified and perform MAC calculation with mapped TID when receiving.
+            When sending, calculate MAC with mapped TID, perform mapping in restore. */
+        if(is_client && mode == EMBED) {
+            uint16_t tid = bitstring_peek_u16(&pkt, 0, 16);
+            uint16_t mapid = _map_tid(state, tid);
+            bitstring_push_u16(&pkt, 0, state->reuse_bits);
+            bitstring_push_u16(&pkt, mapid, 16 - state->reuse_bits);
+        } else {
+            /* Erase MAC bits if any (if not, then 0 anyway) */
+            bitstring_push_u16(&pkt, 0, state->reuse_bits);
+            bitstring_skip(&pkt, 16 - state->reuse_bits);
+        }
     } else {
-        bitstring_push_u16(&pkt, 0, MODBUS_TCP_REUSE_TID_BITS);
-        bitstring_skip(&pkt, 16 - MODBUS_TCP_REUSE_TID_BITS);
-    }
-    #else
-    UNUSED(state);
-    /* Server expects small TIDs from client */
-    /* Erase MAC bits if any (if not, then 0 anyway) */
-    bitstring_push_u16(&pkt, 0, MODBUS_TCP_REUSE_TID_BITS);
-    bitstring_skip(&pkt, 16 - MODBUS_TCP_REUSE_TID_BITS);
-    #endif
-    #else /* MODBUS_TCP_REUSE_TID_BITS <= 0 */
-    UNUSED(state);
-    bitstring_skip(&pkt, 16);
-    #endif
+        bitstring_skip(&pkt, 16);
+    }
 
     /* Protocol Identifier */
     bitstring_push_u16(&pkt, 0, 16);
     /* Length */
     bitstring_skip(&pkt, 16);
 
-    #if MODBUS_TCP_REUSE_UNIT_ID
-    /* Unit Identifier */
-    bitstring_push_u8(&pkt, 255, 8);
-    #endif
+    if(reuse_unit_id) {
+        /* Unit Identifier */
+        bitstring_push_u8(&pkt, 255, 8);
+    }
     eval_timer_measure_mod("end restore");
 }
 
-void modbus_tcp_verified(void* self, inout_buffer_t packet, bufsize_t pktlen) {
+static void _verified(void* self, inout_buffer_t packet, bufsize_t pktlen) {
     eval_timer_measure_mod("begin verified");
     state_from(struct ModbusTCPState, self);
     pkt_from(packet);
     UNUSED(pktlen);
 
     /* Transaction Identifier */
-    #if MODBUS_TCP_REUSE_TID_BITS > 0 && MODBUS_TCP_IS_CLIENT
-    /* Unmap TID only after MAC was calculated as server MAC uses mapped TID */
-    uint16_t mapid = bitstring_peek_u16(&pkt, MODBUS_TCP_REUSE_TID_BITS, 16 - MODBUS_TCP_REUSE_TID_BITS);
-    uint16_t tid = _unmap_tid(state, mapid);
-    /* Restore TID saved in map */
-    bitstring_push_u16(&pkt, tid, 16);
-    #else
-    UNUSED(state);
-    UNUSED(pkt);
-    #endif
+    if(state->reuse_bits > 0) {
+        /* Unmap TID only after MAC was calculated as server MAC uses mapped TID */
+        uint16_t mapid = bitstring_peek_u16(&pkt, state->reuse_bits, 16 - state->reuse_bits);
+        uint16_t tid = _unmap_tid(state, mapid);
+        /* Restore TID saved in map */
+        bitstring_push_u16(&pkt, tid, 16);
+    }
     eval_timer_measure_mod("end verified parse");
 }
 
-parser_module_t modbus_tcp_parser = {
-    modbus_tcp_create,
-    modbus_tcp_destroy,
-    modbus_tcp_parse,
-    modbus_tcp_embed,
-    modbus_tcp_extract,
-    modbus_tcp_restore,
-    modbus_tcp_verified
-};
\ No newline at end of file
+bufsize_t modbus_tcp_save(void* self, out_buffer_t buf, bufsize_t len) {
+    state_from(struct ModbusTCPState, self);
+    size_t const size = _state_size(state->map_len);
+
+    if(len < size) {
+        return 0;
+    }
+    memcpy(buf, state, size);
+    /* Histogram and send times are local */
+    memset(buf + offsetof(struct ModbusTCPState, latency), 0, sizeof(state->latency));
+    return size;
+}
+
+bool modbus_tcp_load(void* self, in_buffer_t buf, bufsize_t len) {
+    state_from(struct ModbusTCPState, self);
+    struct ModbusTCPState saved;
+
+    /* Maps of parsers configured with different parameters differ in size */
+    if(len < sizeof(saved)) {
+        return false;
+    }
+    memcpy(&saved, buf, sizeof(saved));
+    if(saved.reuse_bits != state->reuse_bits || saved.reuse_unit_id != state->reuse_unit_id
+        || saved.map_len != state->map_len || len != _state_size(state->map_len)) {
+        return false;
+    }
+    modbus_tcp_latency_t* const latency = state->latency;
+    memcpy(state, buf, len);
+    state->latency = latency;
+
+    if(!_valid_map(state)) {
+        error("Modbus TCP parser: Invalid transaction map in saved state");
+        _reset_map(state);
+        return false;
+    }
+
+    /* Clocks differ across restarts, do not measure outstanding requests */
+    if(latency) {
+        memset(_sent_ticks(state), 0, state->map_len * sizeof(uint32_t));
+    }
+    return true;
+}
+
+parser_module_t* modbus_tcp_specialize(void const* config);
+
+/**
+ * Defines the functions and table of one configuration
+ */
+#define MODBUS_TCP_SPECIALIZED(STORAGE, NAME, IS_CLIENT, REUSE_UNIT_ID) \
+    static parse_result_t NAME##_parse(void* self, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) { \
+        UNUSED(mode); \
+        return _parse(self, packet, buflen, REUSE_UNIT_ID); \
+    } \
+    static void NAME##_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) { \
+        UNUSED(pktlen); \
+        _embed(self, packet, macbuf, REUSE_UNIT_ID); \
+    } \
+    static void NAME##_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) { \
+        UNUSED(pktlen); \
+        _extract(self, packet, macbuf, REUSE_UNIT_ID); \
+    } \
+    static void NAME##_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) { \
+        UNUSED(pktlen); \
+        _restore(self, packet, mode, IS_CLIENT, REUSE_UNIT_ID); \
+    } \
+    STORAGE parser_module_t NAME = { \
+        modbus_tcp_create, \
+        modbus_tcp_destroy, \
+        NAME##_parse, \
+        NAME##_embed, \
+        NAME##_extract, \
+        NAME##_restore, \
+        (IS_CLIENT) ? _verified : NULL, \
+        modbus_tcp_save, \
+        modbus_tcp_load, \
+        modbus_tcp_specialize \
+    };
+
+MODBUS_TCP_SPECIALIZED(static, modbus_tcp_client_uid, true, true)
+MODBUS_TCP_SPECIALIZED(static, modbus_tcp_client, true, false)
+MODBUS_TCP_SPECIALIZED(static, modbus_tcp_server_uid, false, true)
+MODBUS_TCP_SPECIALIZED(static, modbus_tcp_server, false, false)
+
+parser_module_t* modbus_tcp_specialize(void const* config) {
+    modbus_tcp_config_t const* conf = config ? (modbus_tcp_config_t const*) config : &modbus_tcp_default_config;
+
+    if(conf->is_client) {
+        return conf->reuse_unit_id ? &modbus_tcp_client_uid : &modbus_tcp_client;
+    }
+    return conf->reuse_unit_id ? &modbus_tcp_server_uid : &modbus_tcp_server;
+}
+
+/**
+ * Module of the default configuration, specialized for others on connection creation
+ */
+#if MODBUS_TCP_IS_CLIENT && MODBUS_TCP_REUSE_UNIT_ID
+MODBUS_TCP_SPECIALIZED(, modbus_tcp_parser, true, true)
+#elif MODBUS_TCP_IS_CLIENT
+MODBUS_TCP_SPECIALIZED(, modbus_tcp_parser, true, false)
+#elif MODBUS_TCP_REUSE_UNIT_ID
+MODBUS_TCP_SPECIALIZED(, modbus_tcp_parser, false, true)
+#else
+MODBUS_TCP_SPECIALIZED(, modbus_tcp_parser, false, false)
+#endif
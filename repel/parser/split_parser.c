@@ -34,6 +34,7 @@
  * Parser that overwrites the first packet bytes with a MAC, which it splits
  * into a configurable number of parts. Between each and before the first MAC
  * portion, the parser skips one bit. Requires at least 32 byte long packets.
+ * Without alignment experiments, MAC bits move through a precomputed bitstring layout.
  * Used for performance evaluation.
  *
  * \author
@@ -79,6 +80,44 @@ uint16_t split_parser_mac_splits = 0;
 
 #define _ceil_div(a, b) (((a) + (b) - 1) / (b))
 
+#if !EVAL_PKTALIGN && !EVAL_MACALIGN
+#define SPLIT_USE_LAYOUT true
+
+static bitstring_word_t split_words[_ceil_div(MIN_PKT_LEN, 8)];
+static bitstring_layout_t split_layout;
+/* Number of MAC portions of the layout, rebuilt when changed between runs */
+static int32_t split_layout_splits = -1;
+
+static void _update_layout() {
+    if(split_layout_splits == split_parser_mac_splits) {
+        return;
+    }
+
+    uint8_t mask[MIN_PKT_LEN];
+    memset(mask, 0, MIN_PKT_LEN);
+    bitstring_t str = bitstring_init(mask);
+
+    bitcount_t const segment_len = MAX_MAC_BITS / (split_parser_mac_splits + 1);
+    bitcount_t bits = MAX_MAC_BITS;
+    for(uint16_t s = 0; s <= split_parser_mac_splits; s++) {
+        /* Rest as last segment */
+        bitcount_t len = (s < split_parser_mac_splits) ? segment_len : bits;
+        bits -= len;
+
+        bitstring_skip(&str, OFFSET_BITS);
+        while(len > 8) {
+            bitstring_push_u8(&str, 0xff, 8);
+            len -= 8;
+        }
+        bitstring_push_u8(&str, 0xff >> (8 - len), len);
+    }
+    bitstring_layout_init(&split_layout, split_words, _ceil_div(MIN_PKT_LEN, 8), mask, MIN_PKT_LEN);
+    split_layout_splits = split_parser_mac_splits;
+}
+#else
+#define SPLIT_USE_LAYOUT false
+#endif
+
 void _bstr_copy_multibyte(bitstring_t* dst, bitstring_t* src, bitcount_t numbits) {
     /* Using u8 instead of u64 as u64 loops over u8's anyway, so remove some hidden complexity here */
     while(numbits > 8) {
@@ -105,7 +144,8 @@ void _bstr_byte_align(bitstring_t* bstr) {
     bstr->shift = 0;
 }
 
-void* split_create(bitcount_t* max_embed_bits) {
+void* split_create(void const* config, bitcount_t* max_embed_bits) {
+    UNUSED(config);
     *max_embed_bits = MAX_MAC_BITS;
     #if EVAL_MACALIGN
     for(int i = 0; i < MAX_MAC_BITS; i++) {
@@ -126,6 +166,9 @@ parse_result_t split_parse(void* self, in_buffer_t packet, bufsize_t buflen, rep
     UNUSED(mode);
 
     parse_fail_on_minlen(MIN_PKT_LEN, buflen);
+    #if SPLIT_USE_LAYOUT
+    _update_layout();
+    #endif
 
     parse_result_t res;
     res.packet_has_nonce = false;
@@ -138,6 +181,12 @@ parse_result_t split_parse(void* self, in_buffer_t packet, bufsize_t buflen, rep
 
 void split_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) {
     eval_timer_measure_mod("begin embed");
+    #if SPLIT_USE_LAYOUT
+    mac_from(macbuf);
+    UNUSED(self);
+    UNUSED(pktlen);
+    bitstring_scatter(&split_layout, packet, &mac);
+    #else
     pkt_from(packet);
     #if EVAL_MACALIGN
     bitstring_t mac = bitstring_init((inout_buffer_t) fmac);
@@ -173,12 +222,19 @@ void split_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_
     bitstring_skip(&pkt, OFFSET_BITS);
     #endif
     _bstr_copy_multibyte(&pkt, &mac, bits);
+    #endif
 
     eval_timer_measure_mod("end embed");
 }
 
 void split_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) {
     eval_timer_measure_mod("begin extract");
+    #if SPLIT_USE_LAYOUT
+    mac_from(macbuf);
+    UNUSED(self);
+    UNUSED(pktlen);
+    bitstring_gather(&split_layout, packet, &mac);
+    #else
     pkt_from(packet);
     #if EVAL_MACALIGN
     bitstring_t mac = bitstring_init((inout_buffer_t) fmac);
@@ -214,16 +270,20 @@ void split_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buff
     bitstring_skip(&pkt, OFFSET_BITS);
     #endif
     _bstr_copy_multibyte(&mac, &pkt, bits);
+    #endif
 
     eval_timer_measure_mod("end extract");
 }
 
 void split_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) {
     eval_timer_measure_mod("begin restore");
-    pkt_from(packet);
     UNUSED(self);
     UNUSED(pktlen);
     UNUSED(mode);
+    #if SPLIT_USE_LAYOUT
+    bitstring_layout_clear(&split_layout, packet);
+    #else
+    pkt_from(packet);
     bitcount_t const segment_len = MAX_MAC_BITS / (split_parser_mac_splits + 1);
     /* Bits yet to process */
     bitcount_t bits = MAX_MAC_BITS;
@@ -247,6 +307,7 @@ void split_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mo
     bitstring_skip(&pkt, OFFSET_BITS);
     #endif
     _bstr_zero_multibyte(&pkt, bits);
+    #endif
 
     eval_timer_measure_mod("end restore");
 }
@@ -258,5 +319,8 @@ parser_module_t split_parser = {
     split_embed,
     split_extract,
     split_restore,
+    NULL,
+    NULL,
+    NULL,
     NULL
 };
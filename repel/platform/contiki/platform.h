@@ -49,6 +49,7 @@
 
 #include "lib/heapmem.h"
 #include "sys/rtimer.h"
+#include "sys/clock.h"
 #include "sys/log.h"
 
 typedef rtimer_clock_t platform_time_t;
@@ -63,6 +64,16 @@ void mem_free(void* ptr);
 #define clk_ticks()             RTIMER_NOW()
 #define clk_ticks_per_second()  RTIMER_SECOND
 
+#ifndef REPEL_WALL_CLOCK_IS_SET
+/* Define as true if the application sets the clock, e.g., from a time server */
+#define REPEL_WALL_CLOCK_IS_SET false
+#endif
+
+/* Seconds since boot unless the application sets the clock */
+#define clk_wall_ms()           ((uint64_t) clock_seconds() * 1000)
+/* Whether wall clock timestamps continue across reboots */
+#define clk_wall_is_real()      REPEL_WALL_CLOCK_IS_SET
+
 
 
 #if REPEL_ENABLE_LOGGING
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Shared memory connection table.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "conn_table.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "platform.h"
+
+#define CONN_TABLE_MAGIC    { 'R', 'e', 'P', 'e', 'L', 'T', 'b', 'l' }
+#define CONN_TABLE_VERSION  1
+/* Slots on separate cache lines */
+#define CONN_TABLE_ALIGN    64
+
+struct ConnTableHeader {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t stride;
+    /**
+     * Processes must agree on the lock layout
+     */
+    uint32_t lock_size;
+};
+
+/**
+ * Followed by two copies of slot_size bytes of state
+ */
+struct ConnTableSlot {
+    pthread_mutex_t lock;
+    /**
+     * Incremented by every release, zero if the slot is empty
+     */
+    uint32_t generation;
+    uint16_t len[2];
+    uint8_t current;
+    /**
+     * Whether the holder may have used nonces beyond the current copy, because saving failed
+     */
+    uint8_t stale;
+    /**
+     * Whether a process acquired the empty slot and did not store state yet
+     */
+    uint8_t claimed;
+    uint8_t id_len;
+    uint8_t id[CONN_TABLE_MAX_ID_LEN];
+};
+
+/**
+ * Process-local knowledge of a slot
+ */
+struct ConnTableLocal {
+    /**
+     * Connection that released the slot last in this process
+     */
+    repel_connection_t con;
+    uint32_t generation;
+};
+
+struct ConnTable {
+    uint8_t* map;
+    size_t size;
+    uint32_t slot_count;
+    uint16_t slot_size;
+    size_t stride;
+    struct ConnTableLocal local[];
+};
+
+static uint8_t const conn_table_magic[8] = CONN_TABLE_MAGIC;
+
+static struct ConnTableSlot* _slot(conn_table_t const* table, uint32_t slot) {
+    return (struct ConnTableSlot*) (table->map + CONN_TABLE_ALIGN + (size_t) slot * table->stride);
+}
+
+static uint8_t* _copy(conn_table_t const* table, struct ConnTableSlot* slot, uint8_t c) {
+    return (uint8_t*) (slot + 1) + (size_t) c * table->slot_size;
+}
+
+/**
+ * Serializes initialization of the table between processes
+ */
+static bool _lock_file(int fd, short type) {
+    struct flock lock;
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = sizeof(struct ConnTableHeader);
+    return fcntl(fd, F_SETLKW, &lock) == 0;
+}
+
+/**
+ * Sets up the header and slot locks of a new table
+ */
+static bool _init(uint8_t* map, struct ConnTableHeader const* header) {
+    pthread_mutexattr_t attr;
+    bool valid = pthread_mutexattr_init(&attr) == 0
+        && pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) == 0
+        && pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) == 0;
+
+    for(uint32_t i = 0; valid && i < header->slot_count; i++) {
+        struct ConnTableSlot* slot = (struct ConnTableSlot*) (map + CONN_TABLE_ALIGN + (size_t) i * header->stride);
+        valid = pthread_mutex_init(&slot->lock, &attr) == 0;
+    }
+    pthread_mutexattr_destroy(&attr);
+
+    /* Header last, processes that find it can use the locks */
+    if(valid) {
+        memcpy(map, header, sizeof(*header));
+    }
+    return valid;
+}
+
+conn_table_t* conn_table_open(char const* name, uint32_t slot_count, uint16_t slot_size) {
+    struct ConnTableHeader header;
+    struct stat st;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, conn_table_magic, sizeof(conn_table_magic));
+    header.version = CONN_TABLE_VERSION;
+    header.slot_count = slot_count;
+    header.slot_size = slot_size;
+    header.stride = (sizeof(struct ConnTableSlot) + 2 * (uint32_t) slot_size + CONN_TABLE_ALIGN - 1) & ~(CONN_TABLE_ALIGN - 1);
+    header.lock_size = sizeof(pthread_mutex_t);
+
+    size_t const size = CONN_TABLE_ALIGN + (size_t) slot_count * header.stride;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if(fd < 0 || !_lock_file(fd, F_WRLCK) || fstat(fd, &st) != 0) {
+        error("Cannot open connection table '%s'", name);
+        if(fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    bool const created = st.st_size == 0;
+    void* map = MAP_FAILED;
+    if(created && ftruncate(fd, size) != 0) {
+        error("Cannot initialize connection table '%s'", name);
+    } else if((size_t) st.st_size != size && !created) {
+        error("Connection table '%s' has a different layout", name);
+    } else {
+        map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(map == MAP_FAILED) {
+            error("Cannot map connection table '%s'", name);
+        } else if(created && !_init((uint8_t*) map, &header)) {
+            error("Cannot initialize connection table '%s'", name);
+            munmap(map, size);
+            map = MAP_FAILED;
+        }
+    }
+    _lock_file(fd, F_UNLCK);
+    close(fd);
+    if(map == MAP_FAILED) {
+        return NULL;
+    }
+    if(memcmp(map, &header, sizeof(header)) != 0) {
+        error("Connection table '%s' has a different layout", name);
+        munmap(map, size);
+        return NULL;
+    }
+
+    conn_table_t* table = (conn_table_t*) mem_alloc(sizeof(conn_table_t) + (size_t) slot_count * sizeof(struct ConnTableLocal));
+    if(!table) {
+        error("Out of memory: Opening connection table failed");
+        munmap(map, size);
+        return NULL;
+    }
+    table->map = (uint8_t*) map;
+    table->size = size;
+    table->slot_count = slot_count;
+    table->slot_size = slot_size;
+    table->stride = header.stride;
+    for(uint32_t i = 0; i < slot_count; i++) {
+        table->local[i].con = NULL;
+        table->local[i].generation = 0;
+    }
+    return table;
+}
+
+void conn_table_close(conn_table_t* table) {
+    if(table) {
+        munmap(table->map, table->size);
+        mem_free(table);
+    }
+}
+
+/**
+ * Saves the connection to the older copy of a locked slot and makes it current.
+ * Grants the connection the nonces reserved by the new copy.
+ */
+static bool _save(conn_table_t* table, struct ConnTableSlot* slot, repel_connection_t con) {
+    uint8_t const next = slot->current ^ 1;
+    uint8_t* const copy = _copy(table, slot, next);
+
+    uint16_t const len = repel_save_live_state(con, copy, table->slot_size, CONN_TABLE_NONCE_HEADROOM);
+    if(len == 0) {
+        error("Connection state exceeds connection table slot size");
+        return false;
+    }
+
+    slot->len[next] = len;
+    slot->current = next;
+    slot->stale = 0;
+    slot->claimed = 0;
+    slot->generation = slot->generation + 1 == 0 ? 1 : slot->generation + 1;
+    repel_state_saved(con, copy);
+    return true;
+}
+
+conn_table_status_t conn_table_acquire(conn_table_t* table, uint32_t index, repel_connection_t con) {
+    if(index >= table->slot_count) {
+        error("Connection table slot out of range");
+        return CONN_TABLE_ERROR;
+    }
+
+    struct ConnTableSlot* slot = _slot(table, index);
+    struct ConnTableLocal* local = &table->local[index];
+    bool recover = false;
+
+    int const locked = pthread_mutex_lock(&slot->lock);
+    if(locked == EOWNERDEAD) {
+        warn("Recovering connection table slot %lu from a dead process", (unsigned long) index);
+        pthread_mutex_consistent(&slot->lock);
+        recover = true;
+    } else if(locked != 0) {
+        error("Cannot lock connection table slot %lu", (unsigned long) index);
+        return CONN_TABLE_ERROR;
+    }
+
+    if(slot->generation == 0) {
+        if(slot->claimed && (recover || slot->stale)) {
+            warn("Connection table slot %lu lost, new keys required", (unsigned long) index);
+            return CONN_TABLE_LOST;
+        }
+        slot->claimed = 1;
+        return CONN_TABLE_EMPTY;
+    }
+    recover = recover || slot->stale;
+
+    uint8_t const* const copy = _copy(table, slot, slot->current);
+    uint16_t const len = slot->len[slot->current];
+
+    if(recover) {
+        /* The dead or failed holder may have used nonces up to the reservation, skip them.
+         * Its step is limited by the embedded nonce bits, so the peer reconstructs the jump. */
+        if(repel_load_state(con, copy, len) && _save(table, slot, con)) {
+            return CONN_TABLE_LOADED;
+        }
+    } else if(local->con == con && local->generation == slot->generation) {
+        /* Unchanged since this connection released it */
+        repel_state_saved(con, copy);
+        return CONN_TABLE_LOADED;
+    } else if(repel_resume_state(con, copy, len)) {
+        /* Only the reservation of the copy is safe if this process dies */
+        repel_state_saved(con, copy);
+        return CONN_TABLE_LOADED;
+    }
+
+    error("Invalid state in connection table slot %lu", (unsigned long) index);
+    local->con = NULL;
+    pthread_mutex_unlock(&slot->lock);
+    return CONN_TABLE_ERROR;
+}
+
+bool conn_table_release(conn_table_t* table, uint32_t index, repel_connection_t con) {
+    struct ConnTableSlot* slot = _slot(table, index);
+    struct ConnTableLocal* local = &table->local[index];
+    bool saved = true;
+
+    if(con) {
+        saved = _save(table, slot, con);
+        /* The connection may be ahead of the slot */
+        slot->stale = !saved;
+    } else {
+        slot->generation = 0;
+        slot->claimed = 0;
+        slot->stale = 0;
+        slot->id_len = 0;
+    }
+
+    local->con = saved ? con : NULL;
+    local->generation = slot->generation;
+
+    pthread_mutex_unlock(&slot->lock);
+    return saved;
+}
+
+uint8_t const* conn_table_device(conn_table_t* table, uint32_t index, uint16_t* id_len) {
+    struct ConnTableSlot const* slot = _slot(table, index);
+    *id_len = slot->id_len;
+    return slot->id;
+}
+
+bool conn_table_set_device(conn_table_t* table, uint32_t index, void const* device_id, uint16_t id_len) {
+    struct ConnTableSlot* slot = _slot(table, index);
+
+    if(id_len > CONN_TABLE_MAX_ID_LEN) {
+        return false;
+    }
+    memcpy(slot->id, device_id, id_len);
+    slot->id_len = (uint8_t) id_len;
+    return true;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Connection table in shared memory, which lets several gateway processes on
+ * a host handle any connection and restart independently.
+ *
+ * Connections hold pointers to process-local MAC and parser instances, so the
+ * table holds their serialized state instead. A process locks a slot, which
+ * resumes the state in a process-local connection with the keys of the slot's
+ * device, processes packets, and releases the slot, which saves the state
+ * back. Slots are locked with robust process-shared mutexes. Each slot has two
+ * copies of the state and a release overwrites the older one, so a process
+ * that dies while holding a slot leaves the previous state intact. The next
+ * process then skips the send nonces that the dead process reserved.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef CONN_TABLE_H_
+#define CONN_TABLE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../repel.h"
+
+/**
+ * Send nonces a process may use per acquired slot. Connections with few embedded
+ * nonce bits reserve less, so that the peer follows the nonces skipped when
+ * recovering a slot from a dead process, see repel_save_state.
+ */
+#ifndef CONN_TABLE_NONCE_HEADROOM
+#define CONN_TABLE_NONCE_HEADROOM   4096
+#endif
+
+#ifndef CONN_TABLE_MAX_ID_LEN
+#define CONN_TABLE_MAX_ID_LEN       32
+#endif
+
+typedef struct ConnTable conn_table_t;
+
+typedef enum ConnTableStatus {
+    /**
+     * The slot was not acquired.
+     */
+    CONN_TABLE_ERROR,
+    /**
+     * The slot was acquired but holds no state. Set up the connection and release it to store its state.
+     */
+    CONN_TABLE_EMPTY,
+    /**
+     * The slot was acquired and the connection resumed its state.
+     */
+    CONN_TABLE_LOADED,
+    /**
+     * The slot was acquired but a process died before storing the state of its new connection,
+     * which may have sent packets. Set up the connection with new keys and release it.
+     */
+    CONN_TABLE_LOST
+} conn_table_status_t;
+
+/**
+ * Opens or creates a shared memory connection table and maps it.
+ * Remove the table with shm_unlink when no process uses it anymore.
+ *
+ * \param name Shared memory object name, see shm_open.
+ * \param slot_size Maximum serialized connection state size, see repel_save_live_state.
+ * \return Table or NULL if it cannot be mapped or has a different layout.
+ */
+conn_table_t* conn_table_open(char const* name, uint32_t slot_count, uint16_t slot_size);
+
+void conn_table_close(conn_table_t* table);
+
+/**
+ * Locks a slot and resumes its state in con. Blocks while another process holds the slot.
+ * The connection must use the same parser and MAC modules, and hold the keys of the slot's device,
+ * so use one process-local connection per slot. Resuming is skipped when con released the slot last.
+ */
+conn_table_status_t conn_table_acquire(conn_table_t* table, uint32_t slot, repel_connection_t con);
+
+/**
+ * Saves the state of con to an acquired slot and unlocks it.
+ *
+ * \param con Connection that acquired the slot, NULL to clear the slot.
+ * \return Whether the state was saved. The slot keeps its previous state otherwise.
+ */
+bool conn_table_release(conn_table_t* table, uint32_t slot, repel_connection_t con);
+
+/**
+ * Key reference of an acquired slot, e.g., to set up its connection with a key provider.
+ *
+ * \param id_len Set to the length of the device id, zero if none was set.
+ */
+uint8_t const* conn_table_device(conn_table_t* table, uint32_t slot, uint16_t* id_len);
+
+/**
+ * Sets the key reference of an acquired slot.
+ *
+ * \return False if the id exceeds CONN_TABLE_MAX_ID_LEN.
+ */
+bool conn_table_set_device(conn_table_t* table, uint32_t slot, void const* device_id, uint16_t id_len);
+
+#endif
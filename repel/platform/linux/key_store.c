@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Memory-mapped key store reader and writer.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "key_store.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "platform.h"
+
+struct KeyStore {
+    void* map;
+    size_t size;
+    struct KeyStoreHeader const* header;
+    uint32_t const* offsets;
+    key_store_record_t const* records;
+};
+
+static uint8_t const key_store_magic[8] = KEY_STORE_MAGIC;
+
+/**
+ * FNV-1a
+ */
+static uint32_t _hash(uint8_t const* id, uint16_t len) {
+    uint32_t h = 2166136261u;
+    for(uint16_t i = 0; i < len; i++) {
+        h = (h ^ id[i]) * 16777619u;
+    }
+    return h;
+}
+
+static size_t _records_start(uint32_t bucket_count) {
+    size_t const start = sizeof(struct KeyStoreHeader) + (bucket_count + 1) * sizeof(uint32_t);
+    /* Align records to cache lines */
+    return (start + sizeof(key_store_record_t) - 1) & ~(sizeof(key_store_record_t) - 1);
+}
+
+/**
+ * Syncs the directory of path, so that a rename within it is durable.
+ */
+static bool _sync_dir(char const* path) {
+    char const* slash = strrchr(path, '/');
+    size_t const len = slash ? (size_t) (slash - path) : 0;
+    char* dir = (char*) mem_alloc(len + 2);
+    if(!dir) {
+        return false;
+    }
+    if(slash) {
+        memcpy(dir, path, len > 0 ? len : 1);
+        dir[len > 0 ? len : 1] = '\0';
+    } else {
+        strcpy(dir, ".");
+    }
+
+    int const fd = open(dir, O_RDONLY);
+    mem_free(dir);
+    if(fd < 0) {
+        return false;
+    }
+    bool const synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+key_store_t* key_store_open(char const* path) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0) {
+        error("Cannot open key store '%s'", path);
+        return NULL;
+    }
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(struct KeyStoreHeader)) {
+        error("Key store '%s' too short", path);
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    /* The mapping stays valid without the descriptor */
+    close(fd);
+    if(map == MAP_FAILED) {
+        error("Cannot map key store '%s'", path);
+        return NULL;
+    }
+
+    struct KeyStoreHeader const* header = (struct KeyStoreHeader const*) map;
+    size_t const size = st.st_size;
+    bool valid = memcmp(header->magic, key_store_magic, sizeof(key_store_magic)) == 0
+        && header->version == KEY_STORE_VERSION
+        && header->byte_order == KEY_STORE_BYTE_ORDER
+        && header->bucket_count > 0
+        && (header->bucket_count & (header->bucket_count - 1)) == 0
+        && header->bucket_count < size / sizeof(uint32_t)
+        && header->record_count <= size / sizeof(key_store_record_t)
+        && _records_start(header->bucket_count) + header->record_count * sizeof(key_store_record_t) <= size;
+
+    if(valid) {
+        /* Offsets must be ascending and within the records */
+        uint32_t const* offsets = (uint32_t const*) (header + 1);
+        valid = offsets[0] == 0 && offsets[header->bucket_count] == header->record_count;
+        for(uint32_t b = 0; valid && b < header->bucket_count; b++) {
+            valid = offsets[b] <= offsets[b + 1];
+        }
+    }
+    if(!valid) {
+        error("Malformed key store '%s'", path);
+        munmap(map, size);
+        return NULL;
+    }
+
+    key_store_t* store = (key_store_t*) mem_alloc(sizeof(key_store_t));
+    if(!store) {
+        error("Out of memory: Opening key store failed");
+        munmap(map, size);
+        return NULL;
+    }
+
+    /* Lookups hit random pages */
+    posix_madvise(map, size, POSIX_MADV_RANDOM);
+
+    store->map = map;
+    store->size = size;
+    store->header = header;
+    store->offsets = (uint32_t const*) (header + 1);
+    store->records = (key_store_record_t const*) ((uint8_t const*) map + _records_start(header->bucket_count));
+    return store;
+}
+
+void key_store_close(key_store_t* store) {
+    if(store) {
+        munmap(store->map, store->size);
+        mem_free(store);
+    }
+}
+
+key_store_record_t const* key_store_find(key_store_t const* store, void const* device_id, uint16_t id_len) {
+    uint8_t const* id = (uint8_t const*) device_id;
+
+    if(id_len > KEY_STORE_MAX_ID_LEN) {
+        return NULL;
+    }
+
+    uint32_t const b = _hash(id, id_len) & (store->header->bucket_count - 1);
+    for(uint32_t r = store->offsets[b]; r < store->offsets[b + 1]; r++) {
+        key_store_record_t const* record = &store->records[r];
+        if(record->id_len == id_len && memcmp(record->id, id, id_len) == 0) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+bool key_store_set_keys(void* ctx, repel_connection_t con, void const* device_id, uint16_t id_len) {
+    key_store_record_t const* record = key_store_find((key_store_t const*) ctx, device_id, id_len);
+    if(!record) {
+        return false;
+    }
+    repel_set_keys(con, (void*) record->keys);
+    return true;
+}
+
+/**********************************************************
+ *                        Writer                          *
+ **********************************************************/
+
+bool key_store_write(char const* path, key_store_record_t const* records, uint32_t count) {
+    struct KeyStoreHeader header;
+    uint32_t buckets = 1;
+    uint32_t* offsets;
+    uint32_t* order;
+    bool written = false;
+
+    /* Average bucket size of at most one record */
+    while(buckets < count && buckets < (UINT32_C(1) << 31)) {
+        buckets <<= 1;
+    }
+
+    offsets = (uint32_t*) mem_alloc((buckets + 1) * sizeof(uint32_t));
+    order = (uint32_t*) mem_alloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    if(!offsets || !order) {
+        error("Out of memory: Writing key store failed");
+        mem_free(offsets);
+        mem_free(order);
+        return false;
+    }
+
+    /* Counting sort of records by bucket */
+    memset(offsets, 0, (buckets + 1) * sizeof(uint32_t));
+    for(uint32_t r = 0; r < count; r++) {
+        offsets[(_hash(records[r].id, records[r].id_len) & (buckets - 1)) + 1]++;
+    }
+    for(uint32_t b = 0; b < buckets; b++) {
+        offsets[b + 1] += offsets[b];
+    }
+    for(uint32_t r = 0; r < count; r++) {
+        uint32_t const b = _hash(records[r].id, records[r].id_len) & (buckets - 1);
+        /* offsets[b] temporarily points behind the bucket's records */
+        order[offsets[b]++] = r;
+    }
+    for(uint32_t b = buckets; b > 0; b--) {
+        offsets[b] = offsets[b - 1];
+    }
+    offsets[0] = 0;
+
+    memcpy(header.magic, key_store_magic, sizeof(key_store_magic));
+    header.version = KEY_STORE_VERSION;
+    header.byte_order = KEY_STORE_BYTE_ORDER;
+    header.record_count = count;
+    header.bucket_count = buckets;
+
+    /* Readers map the file, so replace it atomically instead of truncating it under them */
+    size_t const pathlen = strlen(path);
+    char* tmppath = (char*) mem_alloc(pathlen + sizeof(".XXXXXX"));
+    FILE* file = NULL;
+    if(tmppath) {
+        memcpy(tmppath, path, pathlen);
+        memcpy(tmppath + pathlen, ".XXXXXX", sizeof(".XXXXXX"));
+        int const fd = mkstemp(tmppath);
+        file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        if(fd >= 0 && !file) {
+            close(fd);
+            unlink(tmppath);
+        }
+    }
+    if(file) {
+        uint8_t const padding[sizeof(key_store_record_t)] = { 0 };
+        size_t const padlen = _records_start(buckets) - sizeof(header) - (buckets + 1) * sizeof(uint32_t);
+
+        written = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(offsets, sizeof(uint32_t), buckets + 1, file) == buckets + 1
+            && fwrite(padding, 1, padlen, file) == padlen;
+        for(uint32_t r = 0; written && r < count; r++) {
+            written = fwrite(&records[order[r]], sizeof(key_store_record_t), 1, file) == 1;
+        }
+        written = written && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        written = (fclose(file) == 0) && written;
+        written = written && rename(tmppath, path) == 0;
+        if(!written) {
+            unlink(tmppath);
+        } else if(!_sync_dir(path)) {
+            warn("Cannot sync directory of key store '%s'", path);
+        }
+    }
+    if(!written) {
+        error("Cannot write key store '%s'", path);
+    }
+
+    mem_free(tmppath);
+    mem_free(offsets);
+    mem_free(order);
+    return written;
+}
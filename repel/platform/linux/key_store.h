@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Memory-mapped key store, which holds the keys of many devices in a single
+ * file indexed by device ID. Processes map the file read-only and share its
+ * pages, lookups touch only the index bucket and the matching records.
+ *
+ * File layout, in host byte order:
+ * - struct KeyStoreHeader
+ * - bucket_count + 1 uint32_t record offsets: records of bucket b are
+ *   [offset[b], offset[b + 1]), with b = FNV-1a(device ID) % bucket_count
+ * - record_count struct KeyStoreRecord, ordered by bucket
+ *
+ * Keys use the hmac module's format, i.e., one 16 byte key each for send and
+ * receive directions, as seen by the process that opens the store.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef KEY_STORE_H_
+#define KEY_STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../repel.h"
+
+#define KEY_STORE_MAGIC         { 'R', 'e', 'P', 'e', 'L', 'K', 'e', 'y' }
+#define KEY_STORE_VERSION       1
+/**
+ * Detects files written on hosts with different byte order
+ */
+#define KEY_STORE_BYTE_ORDER    0x01020304u
+
+#define KEY_STORE_MAX_ID_LEN    30
+#define KEY_STORE_KEY_SIZE      16
+
+struct KeyStoreHeader {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t record_count;
+    /**
+     * Power of two
+     */
+    uint32_t bucket_count;
+};
+
+/**
+ * 64 bytes, one cache line
+ */
+typedef struct KeyStoreRecord key_store_record_t;
+struct KeyStoreRecord {
+    uint8_t id_len;
+    uint8_t id[KEY_STORE_MAX_ID_LEN + 1];
+    uint8_t keys[2][KEY_STORE_KEY_SIZE];
+};
+
+typedef struct KeyStore key_store_t;
+
+/**
+ * Maps a key store file read-only.
+ *
+ * \return Key store or NULL if the file cannot be mapped or is malformed.
+ */
+key_store_t* key_store_open(char const* path);
+
+void key_store_close(key_store_t* store);
+
+/**
+ * \return The device's record in the mapped file or NULL if there is none.
+ */
+key_store_record_t const* key_store_find(key_store_t const* store, void const* device_id, uint16_t id_len);
+
+/**
+ * Key provider hook for repel_create_device_connection with a key_store_t as ctx.
+ */
+bool key_store_set_keys(void* ctx, repel_connection_t con, void const* device_id, uint16_t id_len);
+
+static inline repel_key_provider_t key_store_provider(key_store_t* store) {
+    return (repel_key_provider_t) { &key_store_set_keys, store };
+}
+
+/**
+ * Writes a key store file from records in arbitrary order, for builder tools.
+ * Device IDs must be unique. Writes a temporary file in the same directory and renames
+ * it over path, so that processes that mapped the previous file keep reading it.
+ *
+ * \return Whether the file was written.
+ */
+bool key_store_write(char const* path, key_store_record_t const* records, uint32_t count);
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Modbus TCP gateway fan-in.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "modbus_mux.h"
+
+#include "platform.h"
+
+#define MBAP_HEADER_LEN 6
+/* Header, unit id, function code, exception code */
+#define EXCEPTION_LEN   (MBAP_HEADER_LEN + 3)
+/*
+ * Transaction Id of slot 0. The parser remaps at most 2^15 Transaction Ids and passes unknown
+ * ones through unchanged, so that late responses to released requests never match a slot.
+ */
+#define SLOT_TID_BASE   0x8000
+
+struct ModbusMuxSlot {
+    uint32_t client;
+    /**
+     * Tick at which the request was sent
+     */
+    uint32_t sent;
+    /**
+     * Transaction Id of the client's request
+     */
+    uint16_t tid;
+    /**
+     * Unit id and function code of the request, for the exception response on expiry
+     */
+    uint8_t unit;
+    uint8_t function;
+    bool pending;
+};
+
+struct ModbusMux {
+    repel_connection_t device;
+    modbus_mux_send_fn_t* send;
+    void* ctx;
+    uint32_t timeout;
+    uint32_t now;
+    uint16_t max_pending;
+    /**
+     * Free slots in the order they were freed, so that Transaction Ids are reused as late as possible
+     */
+    uint16_t free_head;
+    uint16_t free_count;
+    uint16_t* free_ring;
+    struct ModbusMuxSlot slots[];
+};
+
+static inline uint16_t _peek_u16(uint8_t const* buf) {
+    return (uint16_t) ((buf[0] << 8) | buf[1]);
+}
+
+static inline void _poke_u16(uint8_t* buf, uint16_t value) {
+    buf[0] = value >> 8;
+    buf[1] = value & 0xff;
+}
+
+static uint16_t _take_slot(modbus_mux_t* mux) {
+    uint16_t const slot = mux->free_ring[mux->free_head];
+    mux->free_head = (mux->free_head + 1) % mux->max_pending;
+    mux->free_count--;
+    return slot;
+}
+
+static void _free_slot(modbus_mux_t* mux, uint16_t slot) {
+    mux->slots[slot].pending = false;
+    mux->free_ring[(mux->free_head + mux->free_count) % mux->max_pending] = slot;
+    mux->free_count++;
+}
+
+modbus_mux_t* modbus_mux_create(repel_connection_t device, uint16_t max_pending, uint32_t timeout,
+    modbus_mux_send_fn_t* send, void* ctx) {
+    if(max_pending == 0 || max_pending > UINT16_MAX - SLOT_TID_BASE + 1) {
+        error("Modbus mux outstanding requests out of range");
+        return NULL;
+    }
+
+    modbus_mux_t* mux = (modbus_mux_t*) mem_alloc(sizeof(modbus_mux_t)
+        + max_pending * sizeof(struct ModbusMuxSlot) + max_pending * sizeof(uint16_t));
+    if(!mux) {
+        error("Out of memory: Creating Modbus mux failed");
+        return NULL;
+    }
+
+    mux->device = device;
+    mux->send = send;
+    mux->ctx = ctx;
+    mux->timeout = timeout;
+    mux->now = 0;
+    mux->max_pending = max_pending;
+    mux->free_head = 0;
+    mux->free_count = max_pending;
+    mux->free_ring = (uint16_t*) (mux->slots + max_pending);
+
+    for(uint16_t i = 0; i < max_pending; i++) {
+        mux->slots[i].pending = false;
+        mux->free_ring[i] = i;
+    }
+    return mux;
+}
+
+void modbus_mux_destroy(modbus_mux_t* mux) {
+    mem_free(mux);
+}
+
+int32_t modbus_mux_request(modbus_mux_t* mux, uint32_t client, void* requests, uint16_t len, uint16_t* partial_len) {
+    uint8_t* buf = (uint8_t*) requests;
+    uint16_t offset = 0;
+
+    /* Assign slots to the complete requests, as far as available */
+    while(offset + MBAP_HEADER_LEN <= len && mux->free_count > 0) {
+        uint8_t* mbap = buf + offset;
+        /* Length field does not count Transaction, Protocol Id, and itself */
+        uint32_t const frame = MBAP_HEADER_LEN + _peek_u16(mbap + 4);
+
+        if(offset + frame > len) {
+            break;
+        }
+
+        uint16_t const slot = _take_slot(mux);
+        mux->slots[slot].client = client;
+        mux->slots[slot].sent = mux->now;
+        mux->slots[slot].tid = _peek_u16(mbap);
+        /* Frames without PDU are rejected by the parser */
+        mux->slots[slot].unit = frame > MBAP_HEADER_LEN ? mbap[6] : 0;
+        mux->slots[slot].function = frame > MBAP_HEADER_LEN + 1 ? mbap[7] : 0;
+        mux->slots[slot].pending = true;
+        _poke_u16(mbap, SLOT_TID_BASE + slot);
+
+        offset += frame;
+    }
+
+    uint16_t unprotected = 0;
+    int32_t done = offset > 0 ? repel_embed_segment(mux->device, buf, offset, &unprotected) : 0;
+    bool const invalid = done == REPEL_SEGMENT_INVALID;
+    if(invalid) {
+        done = offset - unprotected;
+    }
+
+    /* Requests behind a parsing error or exhausted send nonces are not sent, undo their slots */
+    for(uint16_t pos = done; pos < offset; pos += MBAP_HEADER_LEN + _peek_u16(buf + pos + 4)) {
+        uint16_t const slot = _peek_u16(buf + pos) - SLOT_TID_BASE;
+        _poke_u16(buf + pos, mux->slots[slot].tid);
+        _free_slot(mux, slot);
+    }
+
+    *partial_len = len - done;
+    return invalid ? REPEL_SEGMENT_INVALID : done;
+}
+
+/**
+ * Routes a verified response back to its client
+ */
+static void _route_response(void* cbdata, void* packet, uint16_t packet_len, auth_result_t result) {
+    modbus_mux_t* mux = (modbus_mux_t*) cbdata;
+    uint8_t* mbap = (uint8_t*) packet;
+    uint16_t const slot = _peek_u16(mbap) - SLOT_TID_BASE;
+    (void) result;
+
+    /* Slots of expired requests and dropped clients are free */
+    if(slot >= mux->max_pending || !mux->slots[slot].pending) {
+        warn("Modbus mux: Dropping response to unknown request 0x%x", _peek_u16(mbap));
+        return;
+    }
+
+    struct ModbusMuxSlot const req = mux->slots[slot];
+    _free_slot(mux, slot);
+    _poke_u16(mbap, req.tid);
+    mux->send(mux->ctx, req.client, packet, packet_len);
+}
+
+/**
+ * Gives up the request of a slot, which also releases the Transaction Id the parser remapped it to
+ */
+static void _release_slot(modbus_mux_t* mux, uint16_t slot) {
+    modbus_tcp_release_tid(mux->device, SLOT_TID_BASE + slot);
+    _free_slot(mux, slot);
+}
+
+static void _drop_response(void* cbdata, void* packet, uint16_t packet_len, auth_result_t result) {
+    (void) cbdata;
+    (void) packet;
+    (void) result;
+
+    /* Its slot stays pending until it expires, as the Transaction Id is not authentic */
+    warn("Modbus mux: Dropping unauthentic response of %u bytes", (unsigned int) packet_len);
+}
+
+int32_t modbus_mux_response(modbus_mux_t* mux, void* responses, uint16_t len, uint16_t* partial_len) {
+    return repel_authenticate_segment(mux->device, responses, len, partial_len, &_route_response, &_drop_response, mux);
+}
+
+void modbus_mux_drop_client(modbus_mux_t* mux, uint32_t client) {
+    for(uint16_t i = 0; i < mux->max_pending; i++) {
+        if(mux->slots[i].pending && mux->slots[i].client == client) {
+            _release_slot(mux, i);
+        }
+    }
+}
+
+uint16_t modbus_mux_advance(modbus_mux_t* mux, uint32_t ticks) {
+    uint16_t expired = 0;
+
+    mux->now += ticks;
+    if(mux->timeout == 0) {
+        return 0;
+    }
+
+    for(uint16_t i = 0; i < mux->max_pending; i++) {
+        struct ModbusMuxSlot const req = mux->slots[i];
+        if(!req.pending || mux->now - req.sent < mux->timeout) {
+            continue;
+        }
+
+        _release_slot(mux, i);
+        expired++;
+
+        uint8_t response[EXCEPTION_LEN];
+        _poke_u16(response, req.tid);
+        _poke_u16(response + 2, 0);
+        _poke_u16(response + 4, EXCEPTION_LEN - MBAP_HEADER_LEN);
+        response[6] = req.unit;
+        response[7] = req.function | 0x80;
+        response[8] = MODBUS_MUX_EXCEPTION_NO_RESPONSE;
+        mux->send(mux->ctx, req.client, response, EXCEPTION_LEN);
+    }
+    if(expired > 0) {
+        warn("Modbus mux: %u requests expired without authentic response", (unsigned int) expired);
+    }
+    return expired;
+}
+
+uint16_t modbus_mux_pending(modbus_mux_t* mux) {
+    return mux->max_pending - mux->free_count;
+}
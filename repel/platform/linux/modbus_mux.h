@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Gateway fan-in that multiplexes many upstream Modbus TCP clients onto one
+ * protected connection to a device, for devices that accept few connections.
+ *
+ * The gateway rewrites the Transaction Id of each request to a slot that records
+ * the upstream client and its Transaction Id. The device connection's parser then
+ * remaps the slot to the Transaction Ids left by MAC bits, like for a single client,
+ * and restores it in the response, which routes the response back to its client.
+ * Requests are pipelined to the device without waiting for responses, up to the
+ * number of slots. Requests without authentic response expire after a timeout,
+ * which frees their slots and remapped Transaction Ids, see modbus_tcp_release_tid,
+ * and answers their clients with a Modbus exception.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef MODBUS_MUX_H_
+#define MODBUS_MUX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../repel.h"
+
+typedef struct ModbusMux modbus_mux_t;
+
+/**
+ * Sends a verified response to the upstream client that sent the request.
+ * The response carries the client's Transaction Id.
+ */
+typedef void modbus_mux_send_fn_t(void* ctx, uint32_t client, void* response, uint16_t len);
+
+/**
+ * Modbus exception code sent to clients whose requests expired
+ */
+#define MODBUS_MUX_EXCEPTION_NO_RESPONSE 0x0b
+
+/**
+ * Creates a multiplexer for a device connection created with modbus_tcp_parser in client role.
+ *
+ * \param max_pending Requests outstanding at the device at most. Must not exceed the Transaction Ids
+ * the parser remaps to, i.e., 2^(16 - reuse_tid_bits) of the connection's modbus_tcp_config_t.
+ * \param timeout Ticks of modbus_mux_advance after which outstanding requests expire, zero to never expire them.
+ * \return Multiplexer or NULL when out of memory or max_pending is zero or too large.
+ */
+modbus_mux_t* modbus_mux_create(repel_connection_t device, uint16_t max_pending, uint32_t timeout,
+    modbus_mux_send_fn_t* send, void* ctx);
+
+void modbus_mux_destroy(modbus_mux_t* mux);
+
+/**
+ * Protects pipelined requests of an upstream client for the device. Rewrites the requests'
+ * Transaction Ids and embeds their MACs with repel_embed_segment.
+ *
+ * \param client Identifies the upstream client to the send function.
+ * \return Number of bytes at the start of requests that are ready to be sent to the device,
+ * or REPEL_SEGMENT_INVALID if a request cannot be parsed. The requests before it are still ready to be sent.
+ * \param partial_len Receives the number of trailing bytes that were not processed: a partial request,
+ * or requests beyond max_pending outstanding ones. Pass them again once more bytes or responses arrived.
+ * On REPEL_SEGMENT_INVALID, the bytes from the invalid request on.
+ */
+int32_t modbus_mux_request(modbus_mux_t* mux, uint32_t client, void* requests, uint16_t len, uint16_t* partial_len);
+
+/**
+ * Authenticates responses from the device with repel_authenticate_segment and passes each
+ * verified response to the send function. Unauthentic responses and responses of dropped clients are discarded.
+ *
+ * \return Number of bytes processed at the start of responses, or REPEL_SEGMENT_INVALID if a response
+ * cannot be parsed, see repel_authenticate_segment.
+ * \param partial_len Receives the number of trailing bytes that were not processed, usually a partial response.
+ */
+int32_t modbus_mux_response(modbus_mux_t* mux, void* responses, uint16_t len, uint16_t* partial_len);
+
+/**
+ * Gives up outstanding requests of a client, e.g., when it disconnected, and discards their responses.
+ * Frees their slots and remapped Transaction Ids. The client's identifier may be reused afterwards.
+ */
+void modbus_mux_drop_client(modbus_mux_t* mux, uint32_t client);
+
+/**
+ * Advances the multiplexer's tick and expires requests outstanding for the timeout, e.g., because
+ * their response was lost or not authentic. Frees their slots and sends each client an exception
+ * response with MODBUS_MUX_EXCEPTION_NO_RESPONSE. Responses that arrive after their request
+ * expired are discarded until the parser reuses the remapped Transaction Id, which it does as late as possible.
+ * Visits all slots, so advance in coarse ticks.
+ *
+ * \return Number of expired requests.
+ */
+uint16_t modbus_mux_advance(modbus_mux_t* mux, uint32_t ticks);
+
+/**
+ * Number of requests outstanding at the device.
+ */
+uint16_t modbus_mux_pending(modbus_mux_t* mux);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Memory-mapped nonce coordinator.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "nonce_lease.h"
+
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "platform.h"
+
+#define NONCE_COORDINATOR_MAGIC     { 'R', 'e', 'P', 'e', 'L', 'N', 'n', 'c' }
+#define NONCE_COORDINATOR_VERSION   1
+
+/**
+ * Followed by one uint64_t counter of leased blocks per slot
+ */
+struct NonceCoordinatorHeader {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t block_bits;
+    uint32_t reserved;
+};
+
+/**
+ * Allocator context of a slot
+ */
+struct NonceLease {
+    nonce_coordinator_t* coordinator;
+    uint32_t slot;
+};
+
+struct NonceCoordinator {
+    uint8_t* map;
+    size_t size;
+    /**
+     * Block counters in the map, only accessed atomically
+     */
+    uint64_t* blocks;
+    uint32_t slot_count;
+    uint8_t block_bits;
+    struct NonceLease leases[];
+};
+
+static uint8_t const nonce_coordinator_magic[8] = NONCE_COORDINATOR_MAGIC;
+
+/**
+ * Serializes initialization of the file between processes
+ */
+static bool _lock(int fd, short type) {
+    struct flock lock;
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = 0;
+    lock.l_len = sizeof(struct NonceCoordinatorHeader);
+    return fcntl(fd, F_SETLKW, &lock) == 0;
+}
+
+nonce_coordinator_t* nonce_coordinator_open(char const* path, uint32_t slot_count, uint8_t block_bits) {
+    struct NonceCoordinatorHeader header;
+    struct stat st;
+    bool valid;
+
+    if(block_bits >= sizeof(nonce_t) * 8) {
+        error("Nonce blocks exceed the nonce width");
+        return NULL;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, nonce_coordinator_magic, sizeof(nonce_coordinator_magic));
+    header.version = NONCE_COORDINATOR_VERSION;
+    header.slot_count = slot_count;
+    header.block_bits = block_bits;
+
+    size_t const size = sizeof(header) + (size_t) slot_count * sizeof(uint64_t);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if(fd < 0 || !_lock(fd, F_WRLCK) || fstat(fd, &st) != 0) {
+        error("Cannot open nonce coordinator '%s'", path);
+        if(fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    if(st.st_size == 0) {
+        /* New file, zero blocks leased */
+        valid = ftruncate(fd, size) == 0 && pwrite(fd, &header, sizeof(header), 0) == sizeof(header) && fsync(fd) == 0;
+        if(!valid) {
+            error("Cannot initialize nonce coordinator '%s'", path);
+        }
+    } else {
+        valid = (size_t) st.st_size == size;
+        if(!valid) {
+            error("Nonce coordinator '%s' has a different layout", path);
+        }
+    }
+
+    void* map = valid ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    _lock(fd, F_UNLCK);
+    close(fd);
+    if(!valid) {
+        return NULL;
+    }
+    if(map == MAP_FAILED) {
+        error("Cannot map nonce coordinator '%s'", path);
+        return NULL;
+    }
+    if(memcmp(map, &header, sizeof(header)) != 0) {
+        error("Nonce coordinator '%s' has a different layout", path);
+        munmap(map, size);
+        return NULL;
+    }
+
+    nonce_coordinator_t* coordinator = (nonce_coordinator_t*) mem_alloc(sizeof(nonce_coordinator_t)
+        + (size_t) slot_count * sizeof(struct NonceLease));
+    if(!coordinator) {
+        error("Out of memory: Opening nonce coordinator failed");
+        munmap(map, size);
+        return NULL;
+    }
+    coordinator->map = (uint8_t*) map;
+    coordinator->size = size;
+    coordinator->blocks = (uint64_t*) (coordinator->map + sizeof(header));
+    coordinator->slot_count = slot_count;
+    coordinator->block_bits = block_bits;
+    for(uint32_t i = 0; i < slot_count; i++) {
+        coordinator->leases[i].coordinator = coordinator;
+        coordinator->leases[i].slot = i;
+    }
+    return coordinator;
+}
+
+void nonce_coordinator_close(nonce_coordinator_t* coordinator) {
+    if(coordinator) {
+        munmap(coordinator->map, coordinator->size);
+        mem_free(coordinator);
+    }
+}
+
+static bool nonce_coordinator_lease(void* ctx, repel_connection_t con, nonce_t* first, nonce_t* end) {
+    struct NonceLease const* lease = (struct NonceLease const*) ctx;
+    nonce_coordinator_t const* coordinator = lease->coordinator;
+    uint8_t const bits = coordinator->block_bits;
+    (void) con;
+
+    uint64_t* const counter = &coordinator->blocks[lease->slot];
+    uint64_t const block = __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+
+    if(block >= (NONCE_MAX >> bits)) {
+        error("Nonce coordinator slot %lu exhausted", (unsigned long) lease->slot);
+        return false;
+    }
+
+    /* The lease must be durable before its nonces are used */
+    size_t const pagesize = (size_t) sysconf(_SC_PAGESIZE);
+    uint8_t* const page = coordinator->map + ((size_t) ((uint8_t*) counter - coordinator->map) & ~(pagesize - 1));
+    if(msync(page, (uint8_t*) (counter + 1) - page, MS_SYNC) != 0) {
+        error("Syncing nonce coordinator failed");
+        return false;
+    }
+
+    *first = (nonce_t) block << bits;
+    *end = *first + ((nonce_t) 1 << bits);
+    return true;
+}
+
+repel_nonce_allocator_t nonce_coordinator_allocator(nonce_coordinator_t* coordinator, uint32_t slot) {
+    repel_nonce_allocator_t allocator = { NULL, NULL };
+
+    if(slot < coordinator->slot_count) {
+        allocator.lease = nonce_coordinator_lease;
+        allocator.ctx = &coordinator->leases[slot];
+    } else {
+        error("Nonce coordinator slot out of range");
+    }
+    return allocator;
+}
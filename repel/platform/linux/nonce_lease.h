@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Nonce coordinator that leases disjoint blocks of send nonces to gateways
+ * on the same host, which protect packets of the same logical connections.
+ *
+ * The coordinator is a memory-mapped file with one block counter per slot,
+ * i.e., per logical connection. Processes that map the same file lease with
+ * an atomic increment, so leasing needs no locks or round-trips. The file is
+ * synced before a lease is used, so leases survive restarts.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef NONCE_LEASE_H_
+#define NONCE_LEASE_H_
+
+#include <stdint.h>
+
+#include "../../repel.h"
+
+typedef struct NonceCoordinator nonce_coordinator_t;
+
+/**
+ * Opens or creates a coordinator file and maps it.
+ *
+ * \param block_bits Leases blocks of 2^block_bits nonces, aligned to their size.
+ * Receivers pass the same value to repel_set_nonce_window.
+ * \return Coordinator or NULL if the file cannot be mapped or has a different layout.
+ */
+nonce_coordinator_t* nonce_coordinator_open(char const* path, uint32_t slot_count, uint8_t block_bits);
+
+void nonce_coordinator_close(nonce_coordinator_t* coordinator);
+
+/**
+ * Allocator that leases the nonces of a slot, for repel_set_nonce_allocator.
+ * Valid until the coordinator is closed.
+ */
+repel_nonce_allocator_t nonce_coordinator_allocator(nonce_coordinator_t* coordinator, uint32_t slot);
+
+#endif
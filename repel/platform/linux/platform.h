@@ -66,6 +66,19 @@ static inline platform_time_t clk_ticks() {
 
 #define clk_ticks_per_second()  10000000 /* 100ns precision */
 
+/**
+ * Coarse wall clock in milliseconds, synchronized between hosts via NTP
+ */
+static inline uint64_t clk_wall_ms() {
+    struct timespec time = {0, 0};
+    clock_gettime(CLOCK_REALTIME_COARSE, &time);
+
+    return ((uint64_t) time.tv_sec * 1000) + (time.tv_nsec / 1000000);
+}
+
+/* Whether wall clock timestamps continue across reboots */
+#define clk_wall_is_real()      true
+
 #ifndef LOGTAG
 #define LOGTAG "Repel"
 #endif
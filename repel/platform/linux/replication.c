@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Active/standby replication of connection state.
+ *
+ * Messages, in host byte order as both nodes run on the same host type:
+ * - Batch: struct BatchHeader, then per connection struct RecordHeader and its state
+ * - Acknowledgement: the batch's sequence number
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "replication.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "platform.h"
+
+struct BatchHeader {
+    uint32_t seq;
+    uint32_t count;
+};
+
+struct RecordHeader {
+    uint32_t slot;
+    uint16_t len;
+};
+
+#define RECORD_HEADER_LEN   (sizeof(uint32_t) + sizeof(uint16_t))
+
+struct Replication {
+    int socket;
+    uint32_t seq;
+    uint32_t slot_count;
+    uint16_t slot_size;
+    /**
+     * Active node: State last sent per slot, to skip unchanged connections.
+     * Prefixed by its length.
+     */
+    uint8_t* sent;
+    /**
+     * Batch message under construction / received
+     */
+    uint8_t msg[REPLICATION_MAX_MSG];
+};
+
+static replication_t* _create(int sock, uint32_t slot_count, uint16_t slot_size, bool active) {
+    size_t const sentlen = active ? (size_t) slot_count * (sizeof(uint16_t) + slot_size) : 0;
+    replication_t* rep = (replication_t*) mem_alloc(sizeof(replication_t) + sentlen);
+
+    if(!rep) {
+        error("Out of memory: Creating replication failed");
+        close(sock);
+        return NULL;
+    }
+    if(sizeof(struct BatchHeader) + RECORD_HEADER_LEN + slot_size > REPLICATION_MAX_MSG) {
+        error("Replication slot size exceeds message size");
+        close(sock);
+        mem_free(rep);
+        return NULL;
+    }
+
+    rep->socket = sock;
+    rep->seq = 0;
+    rep->slot_count = slot_count;
+    rep->slot_size = slot_size;
+    rep->sent = active ? (uint8_t*) (rep + 1) : NULL;
+    if(active) {
+        /* Zero length, sends every connection in the first batch */
+        memset(rep->sent, 0, sentlen);
+    }
+    return rep;
+}
+
+static bool _address(struct sockaddr_un* addr, char const* path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr->sun_path)) {
+        error("Replication socket path too long");
+        return false;
+    }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+replication_t* replication_connect(char const* path, uint32_t slot_count, uint16_t slot_size) {
+    struct sockaddr_un addr;
+
+    if(!_address(&addr, path)) {
+        return NULL;
+    }
+    /* Sequenced packets preserve message boundaries */
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if(sock < 0 || connect(sock, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        error("Cannot connect to standby at '%s': %s", path, strerror(errno));
+        if(sock >= 0) {
+            close(sock);
+        }
+        return NULL;
+    }
+    return _create(sock, slot_count, slot_size, true);
+}
+
+replication_t* replication_listen(char const* path, uint32_t slot_count, uint16_t slot_size) {
+    struct sockaddr_un addr;
+
+    if(!_address(&addr, path)) {
+        return NULL;
+    }
+    int lsock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    unlink(path);
+    if(lsock < 0 || bind(lsock, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(lsock, 1) != 0) {
+        error("Cannot listen for active node at '%s': %s", path, strerror(errno));
+        if(lsock >= 0) {
+            close(lsock);
+        }
+        return NULL;
+    }
+
+    int sock = accept(lsock, NULL, NULL);
+    close(lsock);
+    unlink(path);
+    if(sock < 0) {
+        error("Accepting active node failed: %s", strerror(errno));
+        return NULL;
+    }
+    return _create(sock, slot_count, slot_size, false);
+}
+
+void replication_close(replication_t* rep) {
+    if(rep) {
+        close(rep->socket);
+        mem_free(rep);
+    }
+}
+
+/**********************************************************
+ *                      Active node                       *
+ **********************************************************/
+
+static uint8_t* _sent(replication_t const* rep, uint32_t slot) {
+    return rep->sent + (size_t) slot * (sizeof(uint16_t) + rep->slot_size);
+}
+
+/**
+ * Sends the batch in msg, waits for its acknowledgement and grants the leases.
+ */
+static bool _flush(replication_t* rep, size_t len, repel_connection_t const* cons) {
+    struct BatchHeader header;
+    uint32_t ack;
+    ssize_t n;
+
+    memcpy(&header, rep->msg, sizeof(header));
+    if(send(rep->socket, rep->msg, len, MSG_NOSIGNAL) != (ssize_t) len) {
+        error("Replication to standby failed: %s", strerror(errno));
+        return false;
+    }
+    do {
+        n = recv(rep->socket, &ack, sizeof(ack), 0);
+    } while(n < 0 && errno == EINTR);
+    if(n != sizeof(ack) || ack != header.seq) {
+        error("Standby did not acknowledge replication");
+        return false;
+    }
+
+    /* The standby knows the leases now */
+    size_t off = sizeof(header);
+    for(uint32_t r = 0; r < header.count; r++) {
+        struct RecordHeader record;
+        memcpy(&record.slot, rep->msg + off, sizeof(uint32_t));
+        memcpy(&record.len, rep->msg + off + sizeof(uint32_t), sizeof(uint16_t));
+        repel_state_saved(cons[record.slot], rep->msg + off + RECORD_HEADER_LEN);
+
+        /* Only acknowledged state counts as unchanged for the next batch */
+        uint8_t* sent = _sent(rep, record.slot);
+        memcpy(sent, &record.len, sizeof(record.len));
+        memcpy(sent + sizeof(record.len), rep->msg + off + RECORD_HEADER_LEN, record.len);
+        off += RECORD_HEADER_LEN + record.len;
+    }
+    return true;
+}
+
+bool replication_sync(replication_t* rep, repel_connection_t const* cons, uint32_t count) {
+    struct BatchHeader header = { rep->seq, 0 };
+    size_t len = sizeof(header);
+
+    if(count > rep->slot_count) {
+        count = rep->slot_count;
+    }
+
+    for(uint32_t slot = 0; slot < count; slot++) {
+        if(!cons[slot]) {
+            continue;
+        }
+        if(len + RECORD_HEADER_LEN + rep->slot_size > REPLICATION_MAX_MSG) {
+            memcpy(rep->msg, &header, sizeof(header));
+            if(!_flush(rep, len, cons)) {
+                return false;
+            }
+            header.seq = ++rep->seq;
+            header.count = 0;
+            len = sizeof(header);
+        }
+
+        uint8_t* state = rep->msg + len + RECORD_HEADER_LEN;
+        uint16_t const statelen = repel_save_state(cons[slot], state, rep->slot_size, REPLICATION_NONCE_HEADROOM);
+        if(statelen == 0) {
+            error("Connection state exceeds replication slot size");
+            continue;
+        }
+
+        /* Skip unchanged connections */
+        uint8_t* sent = _sent(rep, slot);
+        uint16_t sentlen;
+        memcpy(&sentlen, sent, sizeof(sentlen));
+        if(sentlen == statelen && memcmp(sent + sizeof(sentlen), state, statelen) == 0) {
+            continue;
+        }
+
+        memcpy(rep->msg + len, &slot, sizeof(uint32_t));
+        memcpy(rep->msg + len + sizeof(uint32_t), &statelen, sizeof(uint16_t));
+        len += RECORD_HEADER_LEN + statelen;
+        header.count++;
+    }
+
+    if(header.count == 0) {
+        return true;
+    }
+    memcpy(rep->msg, &header, sizeof(header));
+    bool const flushed = _flush(rep, len, cons);
+    rep->seq++;
+    return flushed;
+}
+
+/**********************************************************
+ *                     Standby node                       *
+ **********************************************************/
+
+int32_t replication_receive(replication_t* rep, repel_connection_t const* cons, uint32_t count) {
+    struct BatchHeader header;
+    int32_t applied = 0;
+    ssize_t len;
+
+    do {
+        len = recv(rep->socket, rep->msg, REPLICATION_MAX_MSG, 0);
+    } while(len < 0 && errno == EINTR);
+    if(len < (ssize_t) sizeof(header)) {
+        /* Orderly shutdown or crash of the active node */
+        return -1;
+    }
+    memcpy(&header, rep->msg, sizeof(header));
+
+    size_t off = sizeof(header);
+    for(uint32_t r = 0; r < header.count; r++) {
+        struct RecordHeader record;
+        if(off + RECORD_HEADER_LEN > (size_t) len) {
+            error("Truncated replication message");
+            return -1;
+        }
+        memcpy(&record.slot, rep->msg + off, sizeof(uint32_t));
+        memcpy(&record.len, rep->msg + off + sizeof(uint32_t), sizeof(uint16_t));
+        off += RECORD_HEADER_LEN;
+        if(off + record.len > (size_t) len) {
+            error("Truncated replication message");
+            return -1;
+        }
+
+        if(record.slot < count && cons[record.slot]
+            && repel_load_state(cons[record.slot], rep->msg + off, record.len)) {
+            applied++;
+        } else {
+            warn("Cannot apply replicated state of slot %lu", (unsigned long) record.slot);
+        }
+        off += record.len;
+    }
+
+    if(send(rep->socket, &header.seq, sizeof(header.seq), MSG_NOSIGNAL) != sizeof(header.seq)) {
+        return -1;
+    }
+    return applied;
+}
+
+void replication_takeover(replication_t* rep, repel_connection_t const* cons, uint32_t count) {
+    for(uint32_t slot = 0; slot < count; slot++) {
+        if(cons[slot] && repel_save_state(cons[slot], rep->msg, rep->slot_size, REPEL_HEADROOM_UNLIMITED) > 0) {
+            repel_state_saved(cons[slot], rep->msg);
+        }
+    }
+}
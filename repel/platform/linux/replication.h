@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Active/standby replication of connection state over a Unix socket.
+ *
+ * The active node periodically sends the serialized state of its connections
+ * (see repel_save_state) to the standby, in batches of one message per up to
+ * REPLICATION_MAX_MSG bytes. Connections whose state did not change since the
+ * last batch are skipped. Each state carries a lease of send nonces, which the
+ * active node only uses once the standby acknowledged the batch. A standby
+ * that takes over thus never repeats the active node's nonces.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef REPLICATION_H_
+#define REPLICATION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../repel.h"
+
+/**
+ * Send nonces leased per connection and batch, must exceed the packets a
+ * connection sends between two batches to not stall. Connections with few
+ * embedded nonce bits lease less, so that the peer follows the nonce jump
+ * after a takeover, see repel_save_state.
+ */
+#ifndef REPLICATION_NONCE_HEADROOM
+#define REPLICATION_NONCE_HEADROOM  4096
+#endif
+
+#ifndef REPLICATION_MAX_MSG
+#define REPLICATION_MAX_MSG         65536
+#endif
+
+typedef struct Replication replication_t;
+
+/**
+ * Active node: Connects to the standby listening on a Unix socket.
+ *
+ * \param slot_count Size of the connection tables on both nodes.
+ * \param slot_size Maximum serialized connection state size.
+ */
+replication_t* replication_connect(char const* path, uint32_t slot_count, uint16_t slot_size);
+
+/**
+ * Standby node: Waits for the active node to connect.
+ */
+replication_t* replication_listen(char const* path, uint32_t slot_count, uint16_t slot_size);
+
+void replication_close(replication_t* rep);
+
+/**
+ * Active node: Sends the changed state of the connection table to the standby
+ * and grants the leased nonces once acknowledged. Entries of cons may be NULL.
+ * Call from the thread processing the connections' packets.
+ *
+ * \return False if the standby is gone, connections keep their previous leases then.
+ */
+bool replication_sync(replication_t* rep, repel_connection_t const* cons, uint32_t count);
+
+/**
+ * Standby node: Applies one batch from the active node to the connection table.
+ *
+ * \return Number of applied connection states, negative when the active node is gone.
+ */
+int32_t replication_receive(replication_t* rep, repel_connection_t const* cons, uint32_t count);
+
+/**
+ * Standby node: Takes over after the active node is gone, before closing rep.
+ * Lifts the nonce leases, so that the connections can send again.
+ */
+void replication_takeover(replication_t* rep, repel_connection_t const* cons, uint32_t count);
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Memory-mapped connection state store.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#include "state_store.h"
+
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "platform.h"
+
+#define STATE_STORE_MAGIC   { 'R', 'e', 'P', 'e', 'L', 'S', 't', 't' }
+#define STATE_STORE_VERSION 1
+
+struct StateStoreHeader {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t copy_size;
+};
+
+/**
+ * Followed by slot_size bytes of state
+ */
+struct StateCopy {
+    /**
+     * Zero when never written. The copy with the larger generation is current.
+     */
+    uint32_t generation;
+    uint32_t checksum;
+    uint16_t len;
+};
+
+struct StateStore {
+    uint8_t* map;
+    size_t size;
+    uint32_t slot_count;
+    uint16_t slot_size;
+    size_t copy_size;
+};
+
+static uint8_t const state_store_magic[8] = STATE_STORE_MAGIC;
+
+/**
+ * FNV-1a over length and state, detects torn writes
+ */
+static uint32_t _checksum(struct StateCopy const* copy) {
+    uint8_t const* data = (uint8_t const*) (copy + 1);
+    uint32_t h = 2166136261u ^ copy->generation;
+
+    h = (h ^ (copy->len & 0xff)) * 16777619u;
+    h = (h ^ (copy->len >> 8)) * 16777619u;
+    for(uint16_t i = 0; i < copy->len; i++) {
+        h = (h ^ data[i]) * 16777619u;
+    }
+    return h;
+}
+
+static struct StateCopy* _copy(state_store_t const* store, uint32_t slot, uint8_t c) {
+    return (struct StateCopy*) (store->map + sizeof(struct StateStoreHeader) + (2 * (size_t) slot + c) * store->copy_size);
+}
+
+static bool _valid(state_store_t const* store, struct StateCopy const* copy) {
+    return copy->generation > 0 && copy->len <= store->slot_size && copy->checksum == _checksum(copy);
+}
+
+/**
+ * \return The newest valid copy of a slot or NULL
+ */
+static struct StateCopy* _current(state_store_t const* store, uint32_t slot) {
+    struct StateCopy* a = _copy(store, slot, 0);
+    struct StateCopy* b = _copy(store, slot, 1);
+    bool const avalid = _valid(store, a);
+    bool const bvalid = _valid(store, b);
+
+    if(avalid && bvalid) {
+        return a->generation > b->generation ? a : b;
+    }
+    return avalid ? a : (bvalid ? b : NULL);
+}
+
+state_store_t* state_store_open(char const* path, uint32_t slot_count, uint16_t slot_size) {
+    struct StateStoreHeader header;
+    struct stat st;
+
+    memcpy(header.magic, state_store_magic, sizeof(state_store_magic));
+    header.version = STATE_STORE_VERSION;
+    header.slot_count = slot_count;
+    header.slot_size = slot_size;
+    /* Align copies for their header fields */
+    header.copy_size = (sizeof(struct StateCopy) + slot_size + 7) & ~7u;
+
+    size_t const size = sizeof(header) + 2 * (size_t) slot_count * header.copy_size;
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        error("Cannot open state store '%s'", path);
+        if(fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    if(st.st_size == 0) {
+        /* New file, zero filled copies are empty */
+        if(ftruncate(fd, size) != 0 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            error("Cannot initialize state store '%s'", path);
+            close(fd);
+            return NULL;
+        }
+    } else if((size_t) st.st_size != size) {
+        error("State store '%s' has a different layout", path);
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        error("Cannot map state store '%s'", path);
+        return NULL;
+    }
+    if(memcmp(map, &header, sizeof(header)) != 0) {
+        error("State store '%s' has a different layout", path);
+        munmap(map, size);
+        return NULL;
+    }
+
+    state_store_t* store = (state_store_t*) mem_alloc(sizeof(state_store_t));
+    if(!store) {
+        error("Out of memory: Opening state store failed");
+        munmap(map, size);
+        return NULL;
+    }
+    store->map = (uint8_t*) map;
+    store->size = size;
+    store->slot_count = slot_count;
+    store->slot_size = slot_size;
+    store->copy_size = header.copy_size;
+    return store;
+}
+
+void state_store_close(state_store_t* store) {
+    if(store) {
+        msync(store->map, store->size, MS_SYNC);
+        munmap(store->map, store->size);
+        mem_free(store);
+    }
+}
+
+/**
+ * Writes the connection state to the older copy of a slot.
+ *
+ * \return The written copy or NULL on failure.
+ */
+static struct StateCopy* _save(state_store_t* store, uint32_t slot, repel_connection_t con) {
+    struct StateCopy* current = _current(store, slot);
+    struct StateCopy* next = _copy(store, slot, current == _copy(store, slot, 0) ? 1 : 0);
+
+    uint16_t const len = repel_save_state(con, next + 1, store->slot_size, STATE_STORE_NONCE_HEADROOM);
+    if(len == 0) {
+        error("Connection state exceeds state store slot size");
+        /* Possibly overwritten */
+        next->generation = 0;
+        return NULL;
+    }
+
+    next->generation = current ? current->generation + 1 : 1;
+    next->len = len;
+    next->checksum = _checksum(next);
+    return next;
+}
+
+bool state_store_checkpoint(state_store_t* store, uint32_t first_slot, repel_connection_t const* cons, uint32_t count) {
+    bool saved = true;
+
+    if(first_slot > store->slot_count || count > store->slot_count - first_slot) {
+        error("State store slots out of range");
+        return false;
+    }
+
+    for(uint32_t i = 0; i < count; i++) {
+        if(cons[i] && !_save(store, first_slot + i, cons[i])) {
+            saved = false;
+        }
+    }
+    if(count == 0) {
+        return saved;
+    }
+
+    /* One sync for all connections, page aligned */
+    size_t const pagesize = (size_t) sysconf(_SC_PAGESIZE);
+    uint8_t* const begin = (uint8_t*) _copy(store, first_slot, 0);
+    uint8_t* const end = (uint8_t*) _copy(store, first_slot + count - 1, 1) + store->copy_size;
+    uint8_t* const aligned = store->map + ((size_t) (begin - store->map) & ~(pagesize - 1));
+
+    if(msync(aligned, end - aligned, MS_SYNC) != 0) {
+        error("Syncing state store failed");
+        return false;
+    }
+
+    /* Only durable reservations may be used */
+    for(uint32_t i = 0; i < count; i++) {
+        struct StateCopy const* current = cons[i] ? _current(store, first_slot + i) : NULL;
+        if(current) {
+            repel_state_saved(cons[i], current + 1);
+        }
+    }
+    return saved;
+}
+
+bool state_store_restore(state_store_t* store, uint32_t slot, repel_connection_t con) {
+    if(slot >= store->slot_count) {
+        return false;
+    }
+
+    struct StateCopy const* current = _current(store, slot);
+    if(!current || !repel_load_state(con, current + 1, current->len)) {
+        return false;
+    }
+    return state_store_checkpoint(store, slot, &con, 1);
+}
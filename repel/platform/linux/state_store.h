@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ * Memory-mapped file of connection state slots, which lets a restarted
+ * gateway resume its connections without replaying nonces.
+ *
+ * Each slot has two copies. A checkpoint overwrites the older copy, so a crash
+ * while writing leaves the previous checkpoint intact. A checkpoint of many
+ * connections syncs the file once and only then grants the connections their
+ * reserved nonces, see repel_save_state.
+ *
+ * \author
+ * Nils Rothaug
+ *
+ * \date
+ * 18.10.2026
+ */
+
+#ifndef STATE_STORE_H_
+#define STATE_STORE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../repel.h"
+
+/**
+ * Send nonces reserved per checkpoint, must exceed the packets a connection
+ * sends between two checkpoints to not stall. Connections with few embedded
+ * nonce bits reserve less, see repel_save_state.
+ */
+#ifndef STATE_STORE_NONCE_HEADROOM
+#define STATE_STORE_NONCE_HEADROOM  4096
+#endif
+
+typedef struct StateStore state_store_t;
+
+/**
+ * Opens or creates a state file and maps it.
+ *
+ * \param slot_size Maximum serialized connection state size, see repel_save_state.
+ * \return State store or NULL if the file cannot be mapped or has a different layout.
+ */
+state_store_t* state_store_open(char const* path, uint32_t slot_count, uint16_t slot_size);
+
+void state_store_close(state_store_t* store);
+
+/**
+ * Saves the state of count connections to consecutive slots and reserves
+ * STATE_STORE_NONCE_HEADROOM send nonces for each. Entries of cons may be NULL
+ * to skip slots. Call from the thread processing the connections' packets.
+ *
+ * \return Whether the checkpoint is durable. Connections keep their previous reservation otherwise.
+ */
+bool state_store_checkpoint(state_store_t* store, uint32_t first_slot, repel_connection_t const* cons, uint32_t count);
+
+/**
+ * Loads the state of a slot into a connection and checkpoints it right away,
+ * so that the connection can send again. Packets the connection accepted after
+ * its last checkpoint can be replayed to it once, see repel_load_state.
+ *
+ * \return False if the slot is empty or invalid, the connection is unchanged then.
+ */
+bool state_store_restore(state_store_t* store, uint32_t slot, repel_connection_t con);
+
+#endif
@@ -32,6 +32,8 @@
 #include "repel.h"
 #include "repel_modules.h"
 
+#include <string.h>
+
 #include "platform.h"
 #include "bitstring.h"
 #include "eval_timer.h"
@@ -40,19 +42,83 @@ struct RepelConnection {
     parser_module_t* parser;
     mac_module_t* macalgo;
     void* parser_state;
-    void* mac_state;
+    struct {
+        /**
+         * MAC module instance holding the keys of the current epoch.
+         */
+        void* current;
+        /**
+         * Instance holding the keys of the previous epoch during the grace period, NULL otherwise.
+         */
+        void* previous;
+        /**
+         * Instance published by repel_rotate_keys, but not yet adopted by the packet path.
+         * Only accessed atomically.
+         */
+        void* pending;
+        /**
+         * Written atomically by the packet path, read atomically from other threads.
+         */
+        uint32_t epoch;
+        /**
+         * Packets to verify with the current keys until the previous keys are dropped.
+         */
+        uint16_t grace;
+    } keys;
+    bufsize_t mac_bytes;
     struct {
         nonce_t send;
         nonce_t recv;
+        /**
+         * Send nonces from here on are not reserved in durable state, see repel_save_state.
+         */
+        nonce_t send_limit;
+        /**
+         * Whether send nonces continue after a restart: loaded from or reserved in saved state, or leased.
+         */
+        bool durable;
         uint8_t embed_bits;
+        /**
+         * Receive window of interleaved nonce blocks, see repel_set_nonce_window.
+         * Entry block % REPEL_NONCE_WINDOW_BLOCKS holds the highest nonce received in the block plus one,
+         * zero if unused.
+         */
+        nonce_t window[REPEL_NONCE_WINDOW_BLOCKS];
+        uint8_t window_bits;
+        bool windowed;
+        /**
+         * Derives nonces from a clock when set, see repel_set_nonce_clock.
+         */
+        repel_nonce_clock_t clock;
     } nonce;
     /**
-     * Buffer for parser to store extracted bits in.
+     * Leases send nonces when set, see repel_set_nonce_allocator.
+     */
+    repel_nonce_allocator_t allocator;
+    struct {
+        /**
+         * Coarse clock read on packets, see repel_set_idle_clock. NULL if unset.
+         */
+        uint32_t const* clock;
+        uint32_t last_seen;
+    } idle;
+    /**
+     * Buffers for the MACs of a segment batch, one per packet. Allocated by the first segment call,
+     * so that connections that process single packets do not pay for them.
+     */
+    uint8_t* batchbuf;
+    /**
+     * Buffer for parser to store extracted bits in
      */
     uint8_t extrbuf[];
 };
 
 repel_connection_t repel_create_connection(parser_module_t* parser, mac_module_t* macalgo, uint8_t embed_nonce_bits) {
+    return repel_create_configured_connection(parser, NULL, macalgo, embed_nonce_bits);
+}
+
+repel_connection_t repel_create_configured_connection(parser_module_t* parser, void const* parser_config,
+    mac_module_t* macalgo, uint8_t embed_nonce_bits) {
 
     do_startup_logging();
 
@@ -60,7 +126,10 @@ repel_connection_t repel_create_connection(parser_module_t* parser, mac_module_t
     bufsize_t mac_bytes;
     void *pstate, *mstate;
 
-    pstate = parser->create(&max_embed_bits);
+    if(parser->specialize) {
+        parser = parser->specialize(parser_config);
+    }
+    pstate = parser->create(parser_config, &max_embed_bits);
     mac_bytes = ceil_bits_to_bytes(max_embed_bits);
     mstate = macalgo->create(mac_bytes);
 
@@ -78,25 +147,386 @@ repel_connection_t repel_create_connection(parser_module_t* parser, mac_module_t
     con->parser_state = pstate;
 
     con->macalgo = macalgo;
-    con->mac_state = mstate;
+    con->mac_bytes = mac_bytes;
+    con->keys.current = mstate;
+    con->keys.previous = NULL;
+    con->keys.pending = NULL;
+    con->keys.epoch = 0;
+    con->keys.grace = 0;
 
     con->nonce.send = 0;
     con->nonce.recv = 0;
+    con->nonce.send_limit = NONCE_MAX;
+    con->nonce.durable = false;
     con->nonce.embed_bits = embed_nonce_bits;
+    con->nonce.window_bits = 0;
+    con->nonce.windowed = false;
+    con->nonce.clock.now = NULL;
+
+    con->allocator.lease = NULL;
+    con->allocator.ctx = NULL;
+
+    con->idle.clock = NULL;
+    con->idle.last_seen = 0;
 
+    con->batchbuf = NULL;
+
+    return con;
+}
+
+repel_connection_t repel_create_device_connection(parser_module_t* parser, void const* parser_config,
+    mac_module_t* macalgo, uint8_t embed_nonce_bits,
+    repel_key_provider_t const* provider, void const* device_id, uint16_t id_len) {
+
+    repel_connection_t con = repel_create_configured_connection(parser, parser_config, macalgo, embed_nonce_bits);
+    if(con && !provider->set_keys(provider->ctx, con, device_id, id_len)) {
+        warn("No keys for device, dropping connection");
+        repel_destroy_connection(con);
+        return NULL;
+    }
     return con;
 }
 
 void repel_destroy_connection(repel_connection_t con) {
     if(con) {
         con->parser->destroy(con->parser_state);
-        con->macalgo->destroy(con->mac_state);
+        con->macalgo->destroy(con->keys.current);
+        if(con->keys.previous) {
+            con->macalgo->destroy(con->keys.previous);
+        }
+        if(con->keys.pending) {
+            con->macalgo->destroy(con->keys.pending);
+        }
+        mem_free(con->batchbuf);
         mem_free(con);
     }
 }
 
 void repel_set_keys(repel_connection_t con, void* keys) {
-    con->macalgo->set_keys(con->mac_state, keys);
+    con->macalgo->set_keys(con->keys.current, keys);
+}
+
+bool repel_rotate_keys(repel_connection_t con, void* keys) {
+    /* Prepare the shadow instance without touching the one in use */
+    void* next = con->macalgo->create(con->mac_bytes);
+    if(!next) {
+        error("Out of memory: Rotating keys failed");
+        return false;
+    }
+    con->macalgo->set_keys(next, keys);
+
+    /* Publish. The packet path never saw an instance that we get back here */
+    void* replaced = __atomic_exchange_n(&con->keys.pending, next, __ATOMIC_ACQ_REL);
+    if(replaced) {
+        con->macalgo->destroy(replaced);
+    }
+    return true;
+}
+
+uint32_t repel_key_epoch(repel_connection_t con) {
+    return __atomic_load_n(&con->keys.epoch, __ATOMIC_RELAXED);
+}
+
+void repel_set_nonce_allocator(repel_connection_t con, repel_nonce_allocator_t const* allocator) {
+    if(allocator) {
+        con->allocator = *allocator;
+        /* Lease on the next packet */
+        con->nonce.send_limit = con->nonce.send;
+        con->nonce.durable = true;
+    } else {
+        con->allocator.lease = NULL;
+        con->allocator.ctx = NULL;
+    }
+}
+
+/**
+ * Leases the next block of send nonces from the connection's allocator.
+ */
+static bool _lease_nonces(repel_connection_t con) {
+    nonce_t first, end;
+
+    if(!con->allocator.lease || !con->allocator.lease(con->allocator.ctx, con, &first, &end) || first >= end) {
+        return false;
+    }
+    con->nonce.send = first;
+    con->nonce.send_limit = end;
+    return true;
+}
+
+bool repel_set_nonce_window(repel_connection_t con, uint8_t block_bits) {
+    if(block_bits >= sizeof(nonce_t) * 8) {
+        return false;
+    }
+    con->nonce.window_bits = block_bits;
+    con->nonce.windowed = true;
+
+    /* Nothing older than the last received nonce is accepted */
+    for(uint8_t i = 0; i < REPEL_NONCE_WINDOW_BLOCKS; i++) {
+        con->nonce.window[i] = 0;
+    }
+    if(con->nonce.recv > 0) {
+        nonce_t const top = (con->nonce.recv - 1) >> block_bits;
+
+        for(uint8_t i = 0; i < REPEL_NONCE_WINDOW_BLOCKS && i <= top; i++) {
+            nonce_t const block = top - i;
+            /* Last nonce of older blocks, so that their next nonce is out of the block */
+            con->nonce.window[block % REPEL_NONCE_WINDOW_BLOCKS] = i == 0 ? con->nonce.recv : (block + 1) << block_bits;
+        }
+    }
+    return true;
+}
+
+/**
+ * Lowest nonce that may be accepted with a receive window
+ */
+static nonce_t _window_floor(repel_connection_t con) {
+    if(con->nonce.recv == 0) {
+        return 0;
+    }
+    nonce_t const top = (con->nonce.recv - 1) >> con->nonce.window_bits;
+    return top < REPEL_NONCE_WINDOW_BLOCKS ? 0 : (top - REPEL_NONCE_WINDOW_BLOCKS + 1) << con->nonce.window_bits;
+}
+
+/**
+ * Whether nonce was not yet received in its block, for nonces not below the window floor
+ */
+static bool _window_accepts(repel_connection_t con, nonce_t nonce) {
+    nonce_t const block = nonce >> con->nonce.window_bits;
+    nonce_t const next = con->nonce.window[block % REPEL_NONCE_WINDOW_BLOCKS];
+
+    /* An entry of another block is older and thereby out of the window */
+    return next == 0 || ((next - 1) >> con->nonce.window_bits) != block || nonce >= next;
+}
+
+void repel_set_idle_clock(repel_connection_t con, uint32_t const* clock) {
+    con->idle.clock = clock;
+    con->idle.last_seen = clock ? *clock : 0;
+}
+
+uint32_t repel_last_seen(repel_connection_t con) {
+    return con->idle.last_seen;
+}
+
+uint64_t repel_wallclock_ms(void* ctx) {
+    (void) ctx;
+    return clk_wall_ms();
+}
+
+/**
+ * Whether nonces of timestamps up to the given one fit above counter_bits
+ */
+static inline bool _clock_fits(repel_nonce_clock_t const* clock, uint64_t ticks) {
+    return clock->counter_bits == 0 || (ticks >> (sizeof(nonce_t) * 8 - clock->counter_bits)) == 0;
+}
+
+bool repel_set_nonce_clock(repel_connection_t con, repel_nonce_clock_t const* clock) {
+    if(!clock) {
+        con->nonce.clock.now = NULL;
+        return true;
+    }
+    if(clock->counter_bits >= sizeof(nonce_t) * 8 || con->nonce.embed_bits == 0) {
+        error("Clock nonces need embedded nonce bits and counter bits below the nonce width");
+        return false;
+    }
+    if(clock->now == repel_wallclock_ms && !clk_wall_is_real()) {
+        error("Platform wall clock restarts at boot, clock nonces would repeat");
+        return false;
+    }
+
+    /* As many timestamps ahead as passed so far, so that nonces do not wrap while the clock is used */
+    uint64_t const now = clock->now(clock->ctx);
+    if(!_clock_fits(clock, 2 * (now + clock->skew) + 1)) {
+        error("Clock timestamps leave too few bits for %u counter bits", (unsigned int) clock->counter_bits);
+        return false;
+    }
+    con->nonce.clock = *clock;
+
+    /* Timestamps up to skew ticks ahead may have been received before */
+    nonce_t const start = (now + clock->skew + 1) << clock->counter_bits;
+    if(con->nonce.recv < start) {
+        con->nonce.recv = start;
+    }
+    return true;
+}
+
+/**
+ * Advances the send nonce to the current timestamp.
+ *
+ * \return False if the sender ran skew ticks ahead of the clock.
+ */
+static bool _clock_send_nonce(repel_connection_t con) {
+    repel_nonce_clock_t const* clock = &con->nonce.clock;
+    uint64_t const now = clock->now(clock->ctx);
+
+    if(!_clock_fits(clock, now + clock->skew)) {
+        error("Clock timestamps overflow the nonce");
+        return false;
+    }
+    if(con->nonce.send < (now << clock->counter_bits)) {
+        con->nonce.send = now << clock->counter_bits;
+    }
+    return (con->nonce.send >> clock->counter_bits) <= now + clock->skew;
+}
+
+/**
+ * Reconstructs a received nonce from its lower bits, closest to the current timestamp.
+ *
+ * \return Whether the timestamp is within the clock skew and the nonce was not received before.
+ */
+static bool _clock_recv_nonce(repel_connection_t con, nonce_t recv, nonce_t* nonce, bitcount_t noncebits) {
+    repel_nonce_clock_t const* clock = &con->nonce.clock;
+    uint64_t const now = clock->now(clock->ctx);
+
+    if(!_clock_fits(clock, now + clock->skew)) {
+        return false;
+    }
+    if(noncebits < sizeof(nonce_t) * 8) {
+        /* Wraps around like the nonce's lower bits */
+        nonce_t const base = (now << clock->counter_bits) - ((nonce_t) 1 << (noncebits - 1));
+        *nonce = base + ((*nonce - base) & ~(NONCE_MASK << noncebits));
+    }
+
+    uint64_t const time = *nonce >> clock->counter_bits;
+    return *nonce >= recv && time + clock->skew >= now && time <= now + clock->skew;
+}
+
+/**
+ * Reconstructs a received nonce from the noncebits behind the MAC.
+ * Without receive window or clock, the nonce is the closest at or above recv.
+ *
+ * \return Whether the nonce was not received before.
+ */
+static bool _recv_nonce(repel_connection_t con, nonce_t recv, inout_buffer_t mac, bitcount_t macbits,
+    bitcount_t noncebits, nonce_t* nonce) {
+
+    if(noncebits == 0) {
+        *nonce = recv;
+        return true;
+    }
+
+    bitstring_t macstr = bitstring_init(mac);
+    bitstring_skip(&macstr, macbits);
+    *nonce = bitstring_pop_u64(&macstr, noncebits); /* Handles endianness */
+
+    if(con->nonce.clock.now) {
+        return _clock_recv_nonce(con, recv, nonce, noncebits);
+    } else if(con->nonce.windowed) {
+        /* Closest nonce with these lower bits at or above the window */
+        const nonce_t floor = _window_floor(con);
+        const nonce_t mask = noncebits < sizeof(nonce_t) * 8 ? ~(NONCE_MASK << noncebits) : NONCE_MASK;
+
+        *nonce = floor + ((*nonce - floor) & mask);
+        return _window_accepts(con, *nonce);
+    }
+
+    /* Determine upper bits from connection nonce */
+    *nonce |= recv & (NONCE_MASK << noncebits);
+    if(*nonce < recv) {
+        *nonce += 1 << noncebits;
+    }
+    return true;
+}
+
+/**
+ * Estimated number of packets lost before a received nonce
+ */
+static uint16_t _packet_loss(repel_connection_t con, nonce_t nonce) {
+    const nonce_t recv = con->nonce.recv;
+
+    if(nonce < recv || con->nonce.clock.now) {
+        /* Interleaved block of another sender, or unknown for timestamps */
+        return 0;
+    }
+    return nonce - recv < UINT16_MAX ? nonce - recv : UINT16_MAX;
+}
+
+/**
+ * Marks the nonce of a verified packet as received.
+ */
+static void _accept_nonce(repel_connection_t con, nonce_t nonce) {
+    /* nonce accounts for lost packets, do not touch if packet not verified */
+    if(con->nonce.windowed && !con->nonce.clock.now) {
+        con->nonce.window[(nonce >> con->nonce.window_bits) % REPEL_NONCE_WINDOW_BLOCKS] = nonce + 1;
+    }
+    if(nonce >= con->nonce.recv) {
+        con->nonce.recv = nonce + 1;
+    }
+}
+
+/**
+ * Whether the send nonce may be used, after leasing nonces or advancing to the clock if necessary.
+ */
+static bool _next_send_nonce(repel_connection_t con) {
+    if(con->nonce.clock.now) {
+        return _clock_send_nonce(con);
+    }
+    if(con->macalgo->needs_unique_nonces && !con->nonce.durable) {
+        error("MAC module must not repeat nonces, save state, lease nonces, or set a clock before sending");
+        return false;
+    }
+    return con->nonce.send < con->nonce.send_limit || _lease_nonces(con);
+}
+
+/**
+ * Switches to keys published by repel_rotate_keys, if any.
+ * Called by the packet path before using the keys, i.e., when it holds no references to them.
+ */
+static void _adopt_pending_keys(repel_connection_t con) {
+    /* Avoid the atomic exchange on every packet */
+    if(__atomic_load_n(&con->keys.pending, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+
+    void* next = __atomic_exchange_n(&con->keys.pending, NULL, __ATOMIC_ACQUIRE);
+    if(next) {
+        if(con->keys.previous) {
+            con->macalgo->destroy(con->keys.previous);
+        }
+        con->keys.previous = con->keys.current;
+        con->keys.current = next;
+        /* Read by repel_key_epoch on other threads */
+        uint32_t const epoch = __atomic_add_fetch(&con->keys.epoch, 1, __ATOMIC_RELAXED);
+        con->keys.grace = REPEL_KEY_GRACE_PACKETS;
+        info("Switched to key epoch %lu", (unsigned long) epoch);
+    }
+}
+
+/**
+ * Completes verification with the current keys' result 'protection'
+ * by verifying with the previous keys during the grace period.
+ * Sets epoch to the key epoch that verified the packet.
+ */
+static int16_t _verify_previous(repel_connection_t con, int16_t protection, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes, uint32_t* epoch) {
+
+    *epoch = con->keys.epoch;
+
+    if(con->keys.previous) {
+        if(protection <= 0) {
+            int16_t const old = con->macalgo->verify(con->keys.previous, packet, pktlen, mac, bits, noncebytes);
+            if(old > 0) {
+                protection = old;
+                *epoch = con->keys.epoch - 1;
+            }
+        }
+        /* Counts packets of either epoch, so that a peer that keeps the previous keys cannot extend the grace period */
+        if(protection > 0 && (con->keys.grace == 0 || --con->keys.grace == 0)) {
+            con->macalgo->destroy(con->keys.previous);
+            con->keys.previous = NULL;
+        }
+    }
+    return protection;
+}
+
+/**
+ * Verifies with the current keys, and with the previous keys during the grace period.
+ * Sets epoch to the key epoch that verified the packet.
+ */
+static int16_t _verify(repel_connection_t con, in_buffer_t packet, bufsize_t pktlen,
+    in_buffer_t mac, bitcount_t bits, noncebytes_t const* noncebytes, uint32_t* epoch) {
+
+    int16_t const protection = con->macalgo->verify(con->keys.current, packet, pktlen, mac, bits, noncebytes);
+    return _verify_previous(con, protection, packet, pktlen, mac, bits, noncebytes, epoch);
 }
 
 uint16_t repel_embed(repel_connection_t con, void* packet, uint16_t packet_size) {
@@ -104,6 +534,8 @@ uint16_t repel_embed(repel_connection_t con, void* packet, uint16_t packet_size)
 
     inout_buffer_t pktbytes = (inout_buffer_t) packet;
 
+    _adopt_pending_keys(con);
+
     parse_result_t pinfo = con->parser->parse(con->parser_state, pktbytes, packet_size, EMBED);
     /* Expecting well formatted packets as input => bail on length mismatch */
     if(pinfo.pktlen != packet_size || pinfo.embed_bits == 0) {
@@ -126,11 +558,18 @@ uint16_t repel_embed(repel_connection_t con, void* packet, uint16_t packet_size)
             eval_timer_print("embed", pinfo.pktlen);
             return 0; /* No MAC protection */
         }
+        if(!_next_send_nonce(con)) {
+            /* Nonce could repeat after a restart or on another sender */
+            warn("Send nonces exhausted, waiting for state checkpoint, nonce lease, or clock");
+            eval_timer_measure("abort");
+            eval_timer_print("embed", pinfo.pktlen);
+            return 0;
+        }
 
         noncebytes_t netnonce = netendian_nonce(con->nonce.send);
 
         macbits -= noncebits;
-        mac = con->macalgo->sign(con->mac_state, pktbytes, pinfo.pktlen, macbits, noncebits, &netnonce);
+        mac = con->macalgo->sign(con->keys.current, pktbytes, pinfo.pktlen, macbits, noncebits, &netnonce);
 
         /* Embed Nonce bits behind MAC in buffer */
         if(noncebits > 0) {
@@ -140,10 +579,13 @@ uint16_t repel_embed(repel_connection_t con, void* packet, uint16_t packet_size)
         }
         con->nonce.send++;
     } else {
-        mac = con->macalgo->sign(con->mac_state, pktbytes, pinfo.pktlen, macbits, 0, NULL);
+        mac = con->macalgo->sign(con->keys.current, pktbytes, pinfo.pktlen, macbits, 0, NULL);
     }
 
     con->parser->embed(con->parser_state, pktbytes, pinfo.pktlen, mac);
+    if(con->idle.clock) {
+        con->idle.last_seen = *con->idle.clock;
+    }
 
     eval_timer_measure("done");
     eval_timer_print("embed", pinfo.pktlen);
@@ -159,6 +601,8 @@ int32_t repel_authenticate(repel_connection_t con, void* packet, uint16_t buffer
     auth_result_t auth;
     inout_buffer_t pktbytes = (inout_buffer_t) packet;
 
+    _adopt_pending_keys(con);
+
     const parse_result_t pinfo = con->parser->parse(con->parser_state, pktbytes, buffer_size, AUTHENTICATE);
 
     if(pinfo.pktlen < 0) {
@@ -179,6 +623,7 @@ int32_t repel_authenticate(repel_connection_t con, void* packet, uint16_t buffer
     if(auth.nonce_embedded) {
 
         nonce_t nonce;
+        bool replayed = false;
         noncebits = con->nonce.embed_bits;
 
         if(pinfo.embed_bits <= noncebits) {
@@ -188,43 +633,31 @@ int32_t repel_authenticate(repel_connection_t con, void* packet, uint16_t buffer
         }
 
         /* Reconstruct  nonce from extracted bits */
-        if(noncebits > 0) {
-            macbits -= noncebits;
-
-            bitstring_t macstr = bitstring_init(mac);
-            bitstring_skip(&macstr, macbits);
-            nonce = bitstring_pop_u64(&macstr, noncebits); /* Handles endianness */
-
-            /* Determine upper bits from connection nonce  */
-            const nonce_t recv = con->nonce.recv;
-            nonce_t upper = recv & (NONCE_MASK << noncebits);
+        macbits -= noncebits;
+        replayed = !_recv_nonce(con, con->nonce.recv, mac, macbits, noncebits, &nonce);
+        auth.packet_loss = _packet_loss(con, nonce);
 
-            nonce |= upper;
-            if(nonce < recv) {
-                nonce += 1 << noncebits;
-            }
-            if(nonce - recv < UINT16_MAX) {
-                auth.packet_loss =  nonce - recv;
-            } else {
-                auth.packet_loss = UINT16_MAX;
-            }
+        noncebytes_t netnonce = netendian_nonce(nonce);
+        if(replayed) {
+            /* Fails without verification */
+            protection = 0;
+            auth.key_epoch = con->keys.epoch;
         } else {
-            nonce = con->nonce.recv;
-            auth.packet_loss = 0;
+            protection = _verify(con, pktbytes, pinfo.pktlen, mac, macbits, &netnonce, &auth.key_epoch);
         }
-
-        noncebytes_t netnonce = netendian_nonce(nonce);
-        protection = con->macalgo->verify(con->mac_state, pktbytes, pinfo.pktlen, mac, macbits, &netnonce);
         if(protection > 0) {
-            /* nonce accounts for lost packets, do not touch if packet not verified */
-            con->nonce.recv = nonce + 1;
+            _accept_nonce(con, nonce);
         }
     } else {
-        protection = con->macalgo->verify(con->mac_state, pktbytes, pinfo.pktlen, mac, macbits, NULL);
+        protection = _verify(con, pktbytes, pinfo.pktlen, mac, macbits, NULL, &auth.key_epoch);
     }
 
     if(protection > 0) {
         auth.protection_level = protection;
+        /* Unauthentic packets do not keep a connection alive */
+        if(con->idle.clock) {
+            con->idle.last_seen = *con->idle.clock;
+        }
         /* This callback is optional */
         if(con->parser->verified) {
             con->parser->verified(con->parser_state, pktbytes, pinfo.pktlen);
@@ -250,6 +683,462 @@ int32_t repel_authenticate(repel_connection_t con, void* packet, uint16_t buffer
     return pinfo.pktlen;
 }
 
+/**
+ * Packets per segment batch, after allocating the batch buffers if necessary.
+ * Falls back to single packet batches in the extract buffer when out of memory.
+ */
+static uint16_t _segment_batch(repel_connection_t con) {
+    if(!con->batchbuf) {
+        con->batchbuf = (uint8_t*) mem_alloc(REPEL_SEGMENT_BATCH * con->mac_bytes);
+        if(!con->batchbuf) {
+            warn("Out of memory: Processing segment packet by packet");
+            return 1;
+        }
+    }
+    return REPEL_SEGMENT_BATCH;
+}
+
+/**
+ * MAC buffer of the packet at index in a segment batch
+ */
+static inline inout_buffer_t _batch_mac(repel_connection_t con, uint16_t index) {
+    return con->batchbuf ? con->batchbuf + index * con->mac_bytes : con->extrbuf;
+}
+
+int32_t repel_embed_segment(repel_connection_t con, void* segment, uint16_t segment_size, uint16_t* partial_len) {
+    eval_timer_start();
+
+    inout_buffer_t segbytes = (inout_buffer_t) segment;
+    mac_batch_job_t jobs[REPEL_SEGMENT_BATCH];
+    noncebytes_t netnonces[REPEL_SEGMENT_BATCH];
+    nonce_t nonces[REPEL_SEGMENT_BATCH];
+    bitcount_t noncebits[REPEL_SEGMENT_BATCH];
+    uint16_t offset = 0;
+    bool stop = false;
+    bool invalid = false;
+
+    uint16_t const batch = _segment_batch(con);
+
+    _adopt_pending_keys(con);
+
+    while(!stop && offset < segment_size) {
+        uint16_t count = 0;
+
+        /* Parse and restore the next batch of packets */
+        while(count < batch && offset < segment_size) {
+            inout_buffer_t pktbytes = segbytes + offset;
+            parse_result_t pinfo = con->parser->parse(con->parser_state, pktbytes, segment_size - offset, EMBED);
+
+            if(pinfo.pktlen <= 0) {
+                /* Partial packet or parsing error */
+                invalid = pinfo.pktlen == 0;
+                stop = true;
+                break;
+            }
+            if(pinfo.embed_bits == 0) {
+                offset += pinfo.pktlen;
+                continue;
+            }
+
+            noncebits[count] = pinfo.packet_has_nonce ? 0 : con->nonce.embed_bits;
+            if(!pinfo.packet_has_nonce && pinfo.embed_bits > noncebits[count] && !_next_send_nonce(con)) {
+                /* Before restore, the caller passes the packet again */
+                warn("Send nonces exhausted, waiting for state checkpoint, nonce lease, or clock");
+                stop = true;
+                break;
+            }
+
+            con->parser->restore(con->parser_state, pktbytes, pinfo.pktlen, EMBED);
+            if(pinfo.embed_bits <= noncebits[count]) {
+                offset += pinfo.pktlen;
+                continue; /* No MAC protection */
+            }
+
+            mac_batch_job_t* job = &jobs[count];
+            job->packet = pktbytes;
+            job->pktlen = pinfo.pktlen;
+            job->bits = pinfo.embed_bits - noncebits[count];
+            job->mac = _batch_mac(con, count);
+            job->noncebytes = NULL;
+
+            if(!pinfo.packet_has_nonce) {
+                nonces[count] = con->nonce.send;
+                netnonces[count] = netendian_nonce(con->nonce.send);
+                job->noncebytes = &netnonces[count];
+                con->nonce.send++;
+            }
+
+            offset += pinfo.pktlen;
+            count++;
+        }
+
+        if(count == 0) {
+            continue;
+        }
+        mac_batch(con->macalgo, con->keys.current, jobs, count, EMBED);
+
+        for(uint16_t j = 0; j < count; j++) {
+            mac_batch_job_t* job = &jobs[j];
+
+            /* Embed Nonce bits behind MAC in buffer */
+            if(noncebits[j] > 0) {
+                bitstring_t macstr = bitstring_init(job->mac);
+                bitstring_skip(&macstr, job->bits);
+                bitstring_push_u64(&macstr, nonces[j], noncebits[j]); /* Handles endianness */
+            }
+            con->parser->embed(con->parser_state, (inout_buffer_t) job->packet, job->pktlen, job->mac);
+        }
+        if(con->idle.clock) {
+            con->idle.last_seen = *con->idle.clock;
+        }
+    }
+
+    eval_timer_measure("done");
+    eval_timer_print("embed segment", offset);
+
+    *partial_len = segment_size - offset;
+    return invalid ? REPEL_SEGMENT_INVALID : offset;
+}
+
+/**
+ * Packet of a segment batch in authentication
+ */
+struct SegmentPacket {
+    bitcount_t embed_bits;
+    bool has_nonce;
+    /**
+     * Nonce reconstructed for the batch, assuming all previous packets verify
+     */
+    nonce_t nonce;
+    bool replayed;
+};
+
+int32_t repel_authenticate_segment(repel_connection_t con, void* segment, uint16_t segment_size, uint16_t* partial_len,
+    auth_callback_fn_t* on_auth_success, auth_callback_fn_t* on_auth_failed, void* cbdata) {
+
+    eval_timer_start();
+
+    inout_buffer_t segbytes = (inout_buffer_t) segment;
+    mac_batch_job_t jobs[REPEL_SEGMENT_BATCH];
+    noncebytes_t netnonces[REPEL_SEGMENT_BATCH];
+    struct SegmentPacket pkts[REPEL_SEGMENT_BATCH];
+    uint16_t offset = 0;
+    bool stop = false;
+    bool invalid = false;
+
+    uint16_t const batch = _segment_batch(con);
+
+    _adopt_pending_keys(con);
+
+    while(!stop && offset < segment_size) {
+        uint16_t count = 0;
+        uint16_t batchlen = 0;
+        nonce_t recv = con->nonce.recv;
+
+        /* Parse, extract, and restore the next batch of packets */
+        while(count < batch && offset + batchlen < segment_size) {
+            inout_buffer_t pktbytes = segbytes + offset + batchlen;
+            parse_result_t pinfo = con->parser->parse(con->parser_state, pktbytes, segment_size - offset - batchlen, AUTHENTICATE);
+
+            if(pinfo.pktlen <= 0) {
+                /* Partial packet or parsing error */
+                invalid = pinfo.pktlen == 0;
+                stop = true;
+                break;
+            }
+
+            mac_batch_job_t* job = &jobs[count];
+            struct SegmentPacket* pkt = &pkts[count];
+
+            job->packet = pktbytes;
+            job->pktlen = pinfo.pktlen;
+            job->mac = _batch_mac(con, count);
+            job->bits = pinfo.embed_bits;
+            job->noncebytes = NULL;
+
+            pkt->embed_bits = pinfo.embed_bits;
+            pkt->has_nonce = pinfo.packet_has_nonce;
+            pkt->replayed = false;
+
+            con->parser->extract(con->parser_state, pktbytes, pinfo.pktlen, job->mac);
+            con->parser->restore(con->parser_state, pktbytes, pinfo.pktlen, AUTHENTICATE);
+
+            if(!pinfo.packet_has_nonce) {
+                bitcount_t const noncebits = con->nonce.embed_bits;
+
+                if(pinfo.embed_bits > noncebits) {
+                    job->bits -= noncebits;
+                    pkt->replayed = !_recv_nonce(con, recv, job->mac, job->bits, noncebits, &pkt->nonce);
+                    netnonces[count] = netendian_nonce(pkt->nonce);
+                    job->noncebytes = &netnonces[count];
+
+                    if(!pkt->replayed && pkt->nonce >= recv) {
+                        recv = pkt->nonce + 1;
+                    }
+                } else {
+                    /* No MAC protection, skipped like by repel_authenticate */
+                    job->bits = 0;
+                }
+            }
+
+            batchlen += pinfo.pktlen;
+            count++;
+        }
+
+        mac_batch(con->macalgo, con->keys.current, jobs, count, AUTHENTICATE);
+
+        /* Complete verification in order, as if the packets were authenticated one by one */
+        for(uint16_t j = 0; j < count; j++) {
+            mac_batch_job_t* job = &jobs[j];
+            struct SegmentPacket* pkt = &pkts[j];
+            inout_buffer_t pktbytes = (inout_buffer_t) job->packet;
+            int16_t protection;
+            auth_result_t auth;
+
+            offset += job->pktlen;
+            auth.nonce_embedded = !pkt->has_nonce;
+            auth.packet_loss = 0;
+
+            if(job->bits == 0) {
+                /* No MAC protection, reported like unauthentic packets */
+                auth.protection_level = 0;
+                auth.key_epoch = con->keys.epoch;
+                if(on_auth_failed) {
+                    on_auth_failed(cbdata, pktbytes, job->pktlen, auth);
+                }
+                continue;
+            }
+
+            if(auth.nonce_embedded) {
+                nonce_t nonce;
+                bool const replayed = !_recv_nonce(con, con->nonce.recv, job->mac, job->bits, con->nonce.embed_bits, &nonce);
+
+                auth.packet_loss = _packet_loss(con, nonce);
+                if(replayed) {
+                    /* Fails without verification */
+                    protection = 0;
+                    auth.key_epoch = con->keys.epoch;
+                } else if(nonce == pkt->nonce && !pkt->replayed) {
+                    protection = _verify_previous(con, job->result, pktbytes, job->pktlen,
+                        job->mac, job->bits, job->noncebytes, &auth.key_epoch);
+                } else {
+                    /* A previous packet failed, reconstructed differently without it */
+                    noncebytes_t netnonce = netendian_nonce(nonce);
+                    protection = _verify(con, pktbytes, job->pktlen, job->mac, job->bits, &netnonce, &auth.key_epoch);
+                }
+                if(protection > 0) {
+                    _accept_nonce(con, nonce);
+                }
+            } else {
+                protection = _verify_previous(con, job->result, pktbytes, job->pktlen,
+                    job->mac, job->bits, NULL, &auth.key_epoch);
+            }
+
+            if(protection > 0) {
+                auth.protection_level = protection;
+                if(con->idle.clock) {
+                    con->idle.last_seen = *con->idle.clock;
+                }
+                if(con->parser->verified) {
+                    con->parser->verified(con->parser_state, pktbytes, job->pktlen);
+                }
+                if(on_auth_success) {
+                    on_auth_success(cbdata, pktbytes, job->pktlen, auth);
+                }
+            } else {
+                auth.protection_level = -protection;
+                if(on_auth_failed) {
+                    on_auth_failed(cbdata, pktbytes, job->pktlen, auth);
+                }
+            }
+        }
+    }
+
+    eval_timer_measure("done");
+    eval_timer_print("authenticate segment", offset);
+
+    *partial_len = segment_size - offset;
+    return invalid ? REPEL_SEGMENT_INVALID : offset;
+}
+
+/**
+ * Connection state as serialized by repel_save_state, followed by parser state
+ */
+struct SavedState {
+    nonce_t send_reserved;
+    nonce_t recv;
+    /**
+     * Live state, only saved by repel_save_live_state
+     */
+    nonce_t send;
+    nonce_t send_limit;
+    nonce_t window[REPEL_NONCE_WINDOW_BLOCKS];
+    bool durable;
+    uint32_t key_epoch;
+    /**
+     * Granularity of send_reserved, bounds the nonce jump after a restart to twice this
+     */
+    uint32_t reserve_step;
+    bufsize_t parser_len;
+    bool live;
+};
+
+/**
+ * Limits the reservation granularity such that the nonce jump after a restart stays within half the
+ * range the peer reconstructs from the embedded nonce bits, leaving the other half for lost packets.
+ */
+static uint32_t _reserve_step(repel_connection_t con, uint32_t headroom) {
+    bitcount_t const bits = con->nonce.embed_bits;
+
+    if(con->nonce.clock.now || bits >= 34 || headroom == REPEL_HEADROOM_UNLIMITED) {
+        /* Timestamps do not jump, larger ranges exceed any headroom, unlimited reservations are not loaded */
+        return headroom;
+    }
+    uint32_t const limit = bits >= 2 ? (uint32_t) 1 << (bits - 2) : 1;
+    return headroom < limit ? headroom : limit;
+}
+
+/**
+ * Whether the peer reconstructs nonces that jumped by up to twice step.
+ */
+static bool _reserve_step_recoverable(repel_connection_t con, uint32_t step) {
+    bitcount_t const bits = con->nonce.embed_bits;
+
+    if(con->nonce.clock.now || step == 0 || bits >= 34) {
+        return true;
+    }
+    return bits >= 2 && step <= (uint32_t) 1 << (bits - 2);
+}
+
+static uint16_t _save_state(repel_connection_t con, void* buf, uint16_t len, uint32_t headroom, bool live) {
+    struct SavedState saved;
+    out_buffer_t out = (out_buffer_t) buf;
+
+    if(len < sizeof(saved)) {
+        return 0;
+    }
+    /* Equal state must serialize to equal bytes, including padding */
+    memset(&saved, 0, sizeof(saved));
+
+    /* Rounded up to a multiple of headroom, so that the reservation only changes every headroom nonces */
+    headroom = _reserve_step(con, headroom);
+    saved.reserve_step = headroom;
+    if(headroom == 0) {
+        saved.send_reserved = con->nonce.send;
+    } else if(headroom == REPEL_HEADROOM_UNLIMITED) {
+        saved.send_reserved = NONCE_MAX;
+    } else if(con->nonce.send / headroom + 2 <= NONCE_MAX / headroom) {
+        saved.send_reserved = (con->nonce.send / headroom + 2) * headroom;
+    } else {
+        saved.send_reserved = NONCE_MAX;
+    }
+    saved.recv = con->nonce.recv;
+    saved.key_epoch = con->keys.epoch;
+    saved.parser_len = 0;
+
+    saved.live = live;
+    if(live) {
+        saved.send = con->nonce.send;
+        saved.send_limit = con->nonce.send_limit;
+        saved.durable = con->nonce.durable;
+        memcpy(saved.window, con->nonce.window, sizeof(saved.window));
+    }
+
+    if(con->parser->save) {
+        saved.parser_len = con->parser->save(con->parser_state, out + sizeof(saved), len - sizeof(saved));
+        if(saved.parser_len == 0) {
+            return 0;
+        }
+    }
+
+    memcpy(out, &saved, sizeof(saved));
+    return sizeof(saved) + saved.parser_len;
+}
+
+uint16_t repel_save_state(repel_connection_t con, void* buf, uint16_t len, uint32_t headroom) {
+    return _save_state(con, buf, len, headroom, false);
+}
+
+uint16_t repel_save_live_state(repel_connection_t con, void* buf, uint16_t len, uint32_t headroom) {
+    return _save_state(con, buf, len, headroom, true);
+}
+
+void repel_state_saved(repel_connection_t con, void const* buf) {
+    struct SavedState saved;
+    memcpy(&saved, buf, sizeof(saved));
+    /* Leased nonces are reserved by the allocator */
+    if(!con->allocator.lease) {
+        con->nonce.send_limit = saved.send_reserved;
+    }
+    con->nonce.durable = true;
+}
+
+/**
+ * Validates saved state and loads the parser state.
+ */
+static bool _load_state(repel_connection_t con, void const* buf, uint16_t len, struct SavedState* saved) {
+    in_buffer_t in = (in_buffer_t) buf;
+
+    if(len < sizeof(*saved)) {
+        return false;
+    }
+    memcpy(saved, in, sizeof(*saved));
+    if(sizeof(*saved) + saved->parser_len != len) {
+        return false;
+    }
+    if(saved->parser_len > 0
+        && !(con->parser->load && con->parser->load(con->parser_state, in + sizeof(*saved), saved->parser_len))) {
+        return false;
+    }
+    con->nonce.recv = saved->recv;
+    __atomic_store_n(&con->keys.epoch, saved->key_epoch, __ATOMIC_RELAXED);
+    return true;
+}
+
+bool repel_load_state(repel_connection_t con, void const* buf, uint16_t len) {
+    struct SavedState saved;
+
+    if(!_load_state(con, buf, len, &saved)) {
+        return false;
+    }
+    if(!_reserve_step_recoverable(con, saved.reserve_step)) {
+        warn("Peer cannot reconstruct send nonces after restart with %u embedded nonce bits",
+            (unsigned) con->nonce.embed_bits);
+    }
+
+    /* Nonces up to the reservation may have been used before the restart */
+    con->nonce.send = saved.send_reserved;
+    con->nonce.send_limit = saved.send_reserved;
+    con->nonce.durable = true;
+    if(con->nonce.windowed) {
+        repel_set_nonce_window(con, con->nonce.window_bits);
+    }
+    return true;
+}
+
+bool repel_resume_state(repel_connection_t con, void const* buf, uint16_t len) {
+    struct SavedState saved;
+
+    if(len < sizeof(saved)) {
+        return false;
+    }
+    /* Check before the parser state is touched */
+    memcpy(&saved, buf, sizeof(saved));
+    if(!saved.live || !_load_state(con, buf, len, &saved)) {
+        return false;
+    }
+
+    con->nonce.send = saved.send;
+    con->nonce.send_limit = saved.send_limit;
+    con->nonce.durable = saved.durable;
+    memcpy(con->nonce.window, saved.window, sizeof(saved.window));
+    return true;
+}
+
+void* repel_parser_state(repel_connection_t con, parser_create_fn_t* create) {
+    return con->parser->create == create ? con->parser_state : NULL;
+}
+
 int32_t _eval_parse_pkt_len(repel_connection_t con, void* packet, uint16_t packet_size) {
     inout_buffer_t pktbytes = (inout_buffer_t) packet;
     parse_result_t pinfo = con->parser->parse(con->parser_state, pktbytes, packet_size, EMBED);
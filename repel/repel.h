@@ -60,6 +60,10 @@ struct AuthenticateResult {
      * Whether the library embedded a nonce in the packet.
      */
     bool nonce_embedded;
+    /**
+     * Key epoch whose keys were used for verification, see repel_rotate_keys.
+     */
+    uint32_t key_epoch;
 };
 
 /**
@@ -86,6 +90,42 @@ typedef struct RepelConnection* repel_connection_t;
  */
 repel_connection_t repel_create_connection(parser_module_t* parser, mac_module_t* macalgo, uint8_t embed_nonce_bits);
 
+/**
+ * Like repel_create_connection, but configures the parser, e.g., with a modbus_tcp_config_t.
+ *
+ * \param parser_config Parser specific configuration, NULL selects the parser's defaults.
+ */
+repel_connection_t repel_create_configured_connection(parser_module_t* parser, void const* parser_config,
+    mac_module_t* macalgo, uint8_t embed_nonce_bits);
+
+/**
+ * Key provider hook that looks up or derives the keys of a device and sets
+ * them with repel_set_keys. The keys' format must match the connection's MAC module.
+ *
+ * \return Whether keys for the device were set.
+ */
+typedef bool repel_key_provider_fn_t(void* ctx, repel_connection_t con, void const* device_id, uint16_t id_len);
+
+typedef struct RepelKeyProvider repel_key_provider_t;
+struct RepelKeyProvider {
+    repel_key_provider_fn_t* set_keys;
+    /**
+     * Opaque provider data, passed as ctx.
+     */
+    void* ctx;
+};
+
+/**
+ * Like repel_create_configured_connection, but sets the keys for a device with a key provider.
+ *
+ * \param parser_config Parser specific configuration, NULL selects the parser's defaults.
+ * \param device_id Identifies the remote device, e.g., by its address. Format defined by the key provider.
+ * \return The new connection or NULL when out of memory or the provider has no keys for the device.
+ */
+repel_connection_t repel_create_device_connection(parser_module_t* parser, void const* parser_config,
+    mac_module_t* macalgo, uint8_t embed_nonce_bits,
+    repel_key_provider_t const* provider, void const* device_id, uint16_t id_len);
+
 /**
  * Call to free connection state.
  */
@@ -95,9 +135,35 @@ void repel_destroy_connection(repel_connection_t con);
  * Sets the session and MAC implementation specific key.
  * Passing a key which does match the expacted size and format
  * of the MAC implementation in use causes undefined behaviour.
+ * Must not run concurrently with packet processing, use repel_rotate_keys on live connections.
  */
 void repel_set_keys(repel_connection_t con, void* keys);
 
+/**
+ * Number of packets that verify with the new or the previous keys before keys of the previous epoch are rejected.
+ */
+#ifndef REPEL_KEY_GRACE_PACKETS
+#define REPEL_KEY_GRACE_PACKETS 16
+#endif
+
+/**
+ * Starts a new key epoch. Installs the keys in a new MAC module instance and publishes it
+ * atomically, so it may be called from another thread while packets are processed.
+ * The next embedded or authenticated packet switches to the new keys.
+ * Verification still accepts the previous keys until REPEL_KEY_GRACE_PACKETS
+ * packets verified with either keys, so peers must switch within that many packets.
+ *
+ * \return Whether the keys were installed, false when out of memory.
+ */
+bool repel_rotate_keys(repel_connection_t con, void* keys);
+
+/**
+ * Current key epoch, i.e., the number of key rotations the connection has adopted.
+ * Restored by repel_load_state and repel_resume_state, which do not restore the keys themselves.
+ * May be called from any thread.
+ */
+uint32_t repel_key_epoch(repel_connection_t con);
+
 /**
  * Calculates and embeds the packet's MAC according to MAC implementation and parser configured in session.
  *
@@ -125,6 +191,228 @@ uint16_t repel_embed(repel_connection_t con, void* packet, uint16_t packet_size)
 int32_t repel_authenticate(repel_connection_t con, void* packet, uint16_t buffer_size,
     auth_callback_fn_t* on_auth_success, auth_callback_fn_t* on_auth_failed, void* cbdata);
 
+/**
+ * Packets per MAC batch when processing segments, see repel_embed_segment.
+ * Each connection reserves an extract buffer per packet.
+ */
+#ifndef REPEL_SEGMENT_BATCH
+#ifdef CONTIKI
+#define REPEL_SEGMENT_BATCH 2
+#else
+#define REPEL_SEGMENT_BATCH 16
+#endif
+#endif
+
+/**
+ * Returned by repel_embed_segment and repel_authenticate_segment when a packet cannot be parsed.
+ * The packets before it were processed, partial_len covers the bytes from the invalid packet on,
+ * which will not parse once more bytes arrive either.
+ */
+#define REPEL_SEGMENT_INVALID (-1)
+
+/**
+ * Embeds MACs in all complete packets of a segment, e.g., pipelined Modbus TCP requests
+ * received in one TCP segment. Parses the segment in one pass and calculates the MACs of
+ * up to REPEL_SEGMENT_BATCH packets at once with the MAC module's batch function.
+ * Packets that cannot carry a MAC remain unprotected like with repel_embed.
+ *
+ * \return Number of bytes processed at the segment start, i.e., of the complete packets,
+ * or REPEL_SEGMENT_INVALID on a parsing error.
+ *
+ * \param partial_len Receives the number of trailing bytes that were not processed. Usually a partial
+ * packet the caller completes with the next segment. Also covers packets behind a packet that found
+ * the send nonces exhausted, or from an invalid packet on.
+ */
+int32_t repel_embed_segment(repel_connection_t con, void* segment, uint16_t segment_size, uint16_t* partial_len);
+
+/**
+ * Removes embedded MACs from all complete packets of a segment and validates them,
+ * calling one callback per packet in order. Equivalent to calling repel_authenticate
+ * for each packet, but verifies up to REPEL_SEGMENT_BATCH packets at once with the MAC
+ * module's batch function. Packets that carry no MAC, for which repel_authenticate returns zero,
+ * are passed to on_auth_failed with protection level zero.
+ * Parsers must not change a packet's restored contents depending on previous packets being verified.
+ *
+ * \return Number of bytes processed at the segment start, i.e., of the complete packets,
+ * or REPEL_SEGMENT_INVALID on a parsing error.
+ *
+ * \param partial_len Receives the number of trailing bytes that were not processed. Usually a partial
+ * packet the caller completes with the next segment. Also covers the bytes from an invalid packet on.
+ */
+int32_t repel_authenticate_segment(repel_connection_t con, void* segment, uint16_t segment_size, uint16_t* partial_len,
+    auth_callback_fn_t* on_auth_success, auth_callback_fn_t* on_auth_failed, void* cbdata);
+
+/**
+ * Headroom that grants all remaining send nonces, for state that is never loaded again,
+ * e.g., when a standby takes over for good.
+ */
+#define REPEL_HEADROOM_UNLIMITED UINT32_MAX
+
+/**
+ * Serializes the connection's nonces, key epoch, and parser state, e.g., to a file that
+ * survives restarts. The saved send nonce reserves at least 'headroom' nonces beyond the current one,
+ * rounded such that saving again yields the same reservation until the connection used 'headroom' nonces.
+ * Without nonce clock, headroom is limited to a quarter of the nonce range given by the embedded nonce bits,
+ * such that the peer still reconstructs the nonces that skip the reservation after a restart.
+ * Once the saved state is durable, call repel_state_saved to let the connection use them.
+ * Connections that were saved or loaded stop embedding when they exhaust their reservation,
+ * so that no nonce repeats after a restart. Call from the thread processing the connection's packets.
+ *
+ * \return Number of bytes written to buf, zero if len is too small.
+ */
+uint16_t repel_save_state(repel_connection_t con, void* buf, uint16_t len, uint32_t headroom);
+
+/**
+ * Like repel_save_state, but additionally saves the exact send nonce, nonce lease, and receive window,
+ * so that another connection can continue with repel_resume_state.
+ */
+uint16_t repel_save_live_state(repel_connection_t con, void* buf, uint16_t len, uint32_t headroom);
+
+/**
+ * Grants the connection the nonces reserved in state saved by repel_save_state.
+ */
+void repel_state_saved(repel_connection_t con, void const* buf);
+
+/**
+ * Restores state saved by repel_save_state on a connection with the same parser and MAC modules.
+ * Sending resumes behind the reserved nonces, after the next repel_state_saved.
+ * Warns if the peer cannot reconstruct nonces behind the reservation, e.g., with less than two embedded nonce bits.
+ * The receive nonce is restored as saved: packets accepted after the state was saved
+ * verify once more if replayed to the restored connection. Save state after receiving to narrow this window,
+ * or switch to new keys with repel_rotate_keys after loading to close it.
+ * The saved key epoch is restored, but not the keys: the caller must set the keys of that epoch,
+ * e.g., from a key store by repel_key_epoch, before the connection processes packets.
+ *
+ * \return Whether buf held valid state.
+ */
+bool repel_load_state(repel_connection_t con, void const* buf, uint16_t len);
+
+/**
+ * Continues exactly where the connection saved by repel_save_live_state stopped, e.g., when
+ * processes that share connection state hand a connection over. Unlike repel_load_state, no nonces
+ * are skipped, so the saved state must not be resumed twice. The connection keeps the saved
+ * connection's send limit, call repel_state_saved to grant the saved reservation instead.
+ * Like repel_load_state, restores the key epoch but not the keys.
+ *
+ * \return Whether buf held valid live state.
+ */
+bool repel_resume_state(repel_connection_t con, void const* buf, uint16_t len);
+
+/**
+ * Nonce allocator hook that leases a block of send nonces, e.g., from a coordinator
+ * shared by several gateways that protect packets of the same logical connection.
+ * Blocks leased for one connection must be disjoint across all its senders.
+ *
+ * \param first Set to the first nonce of the block.
+ * \param end Set to the nonce behind the block.
+ * \return Whether a block was leased.
+ */
+typedef bool repel_nonce_lease_fn_t(void* ctx, repel_connection_t con, nonce_t* first, nonce_t* end);
+
+typedef struct RepelNonceAllocator repel_nonce_allocator_t;
+struct RepelNonceAllocator {
+    repel_nonce_lease_fn_t* lease;
+    /**
+     * Opaque allocator data, passed as ctx.
+     */
+    void* ctx;
+};
+
+/**
+ * Lets the connection send with nonces leased from an allocator instead of counting them locally.
+ * The next embedded packet leases the first block, the connection leases the next block when it
+ * exhausted the current one. Reservations of repel_state_saved do not apply to leased nonces.
+ *
+ * \param allocator Copied into the connection. NULL to keep counting behind the current lease.
+ */
+void repel_set_nonce_allocator(repel_connection_t con, repel_nonce_allocator_t const* allocator);
+
+/**
+ * Number of nonce blocks the receiver tracks with repel_set_nonce_window.
+ */
+#ifndef REPEL_NONCE_WINDOW_BLOCKS
+#ifdef CONTIKI
+#define REPEL_NONCE_WINDOW_BLOCKS 2
+#else
+#define REPEL_NONCE_WINDOW_BLOCKS 8
+#endif
+#endif
+
+/**
+ * Accepts interleaved nonces of several senders that lease blocks of 2^block_bits nonces
+ * aligned to their size, see repel_set_nonce_allocator. Nonces must increase within a block,
+ * and blocks may be up to REPEL_NONCE_WINDOW_BLOCKS - 1 blocks older than the newest
+ * block received. Without a window, nonces must increase across all packets.
+ * Senders should embed enough nonce bits to count the whole window, i.e., more than
+ * block_bits + log2(REPEL_NONCE_WINDOW_BLOCKS).
+ * Nonces older than the last received nonce are considered seen when the window is set.
+ *
+ * \return False if block_bits exceeds the nonce width.
+ */
+bool repel_set_nonce_window(repel_connection_t con, uint8_t block_bits);
+
+/**
+ * Clock for clock-derived nonces, returns a coarse timestamp in ticks.
+ * Senders and receivers of a connection must use synchronized clocks with the same tick.
+ */
+typedef uint64_t repel_clock_fn_t(void* ctx);
+
+/**
+ * Platform wall clock in milliseconds, ctx is unused. On Contiki, it counts from boot
+ * unless the application sets the clock and defines REPEL_WALL_CLOCK_IS_SET.
+ */
+uint64_t repel_wallclock_ms(void* ctx);
+
+typedef struct RepelNonceClock repel_nonce_clock_t;
+struct RepelNonceClock {
+    repel_clock_fn_t* now;
+    /**
+     * Opaque clock data, passed as ctx.
+     */
+    void* ctx;
+    /**
+     * Low nonce bits that count packets within a tick.
+     */
+    uint8_t counter_bits;
+    /**
+     * Ticks a received timestamp may deviate from the receiver's clock.
+     * Senders borrow at most as many ticks ahead when they send more than 2^counter_bits packets per tick.
+     */
+    uint32_t skew;
+};
+
+/**
+ * Derives nonces from a clock instead of counting them, so that the connection keeps hardly any state
+ * and any gateway with the connection's keys can take over its packets. Nonces are the
+ * timestamp followed by a counter of counter_bits bits, which replaces counter nonces,
+ * leases, and the receive window. Receivers accept nonces within the clock skew that exceed the last one.
+ * Senders should embed more than counter_bits + log2(2 * skew + 1) nonce bits.
+ * To not replay packets received before it was set, the receiver accepts
+ * timestamps only after skew ticks. Likewise, a gateway that takes over sending
+ * must wait skew ticks after the last packet of the previous sender.
+ *
+ * The clock must not restart, e.g., at boot, or timestamps and nonces repeat under the same keys.
+ *
+ * \param clock Copied into the connection. NULL to return to counter nonces.
+ * \return False if the connection embeds no nonce bits, if the timestamps and counter_bits would
+ * overflow the nonce before the clock doubles, or if the clock is the platform wall clock but restarts at boot.
+ */
+bool repel_set_nonce_clock(repel_connection_t con, repel_nonce_clock_t const* clock);
+
+/**
+ * Lets the connection record the value of a coarse clock whenever it embeds or verifies a packet,
+ * e.g., the tick of an idle wheel. Reading a variable keeps clock sources off the packet path.
+ * The clock must be advanced by the thread processing the connection's packets.
+ *
+ * \param clock NULL to stop recording.
+ */
+void repel_set_idle_clock(repel_connection_t con, uint32_t const* clock);
+
+/**
+ * Clock value of the last embedded or verified packet, or of the call to repel_set_idle_clock.
+ */
+uint32_t repel_last_seen(repel_connection_t con);
+
 /**
  * Hacky function for eval: We send packets from TCP trace without knowing the app layer length.
  * Instead of parsing the length for each protocol, we ask the parser.
@@ -139,6 +427,53 @@ int32_t _eval_parse_pkt_len(repel_connection_t con, void* packet, uint16_t packe
  */
 extern mac_module_t hmac_module;
 
+/**
+ * SHA-256 truncated HMAC through the Linux kernel crypto API (AF_ALG), which
+ * may offload it to accelerators. Supports batches, falls back to software.
+ * Uses the same key format as hmac_module.
+ */
+extern mac_module_t afalg_hmac_module;
+
+/**
+ * AES-128 truncated CMAC, accelerated with AES-NI when available.
+ * Uses the same key format as hmac_module.
+ */
+extern mac_module_t cmac_module;
+
+/**
+ * AES-128 truncated GMAC using the library nonce as IV, accelerated with
+ * PCLMULQDQ when available. Send and receive keys must differ. A repeated IV
+ * allows forgeries, so connections only embed library nonces after repel_load_state,
+ * repel_state_saved, repel_set_nonce_allocator, or repel_set_nonce_clock.
+ */
+extern mac_module_t gmac_module;
+
+/**
+ * SipHash-2-4 truncated MAC with 64 or 128 bit output, for short packets.
+ * Uses the same key format as hmac_module. Creating connections fails if
+ * the parser embeds more than 128 bits, including nonce bits.
+ */
+extern mac_module_t siphash_module;
+
+/**
+ * HalfSipHash-2-4 truncated MAC with 32 or 64 bit output, for 32 bit microcontrollers.
+ * Uses the same key format as hmac_module, but only the first 8 bytes of each key.
+ * Creating connections fails if the parser embeds more than 64 bits, including nonce bits.
+ */
+extern mac_module_t halfsiphash_module;
+
+/**
+ * Keyed BLAKE2s truncated MAC, for 32 bit microcontrollers without SHA hardware.
+ * Uses the same key format as hmac_module.
+ */
+extern mac_module_t blake2s_module;
+
+/**
+ * Keyed BLAKE3 truncated MAC, accelerated with SSE4.1 when available.
+ * Uses the same key format as hmac_module.
+ */
+extern mac_module_t blake3_module;
+
 /**
  * Test MAC module that does not provide integrity or replay protection.
  */
@@ -146,6 +481,168 @@ extern mac_module_t fakemac_module;
 
 extern parser_module_t modbus_tcp_parser;
 
+#ifndef MODBUS_TCP_LATENCY_BUCKETS
+#define MODBUS_TCP_LATENCY_BUCKETS 24
+#endif
+
+/**
+ * Histogram of Modbus request/response round trip times measured by clients, from protecting the request
+ * to verifying the matching response. Connections to the same device may share one histogram.
+ * On Linux, updated atomically, so that connections on several threads may record into it.
+ */
+typedef struct ModbusTCPLatency modbus_tcp_latency_t;
+struct ModbusTCPLatency {
+    /**
+     * Bucket i counts round trips below 2^(i+1) microseconds and at least 2^i microseconds, except for i = 0.
+     * The last bucket also counts all longer round trips.
+     */
+    uint32_t buckets[MODBUS_TCP_LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+};
+
+/**
+ * Upper bound of the round trip time in microseconds that the given percentage of recorded round trips
+ * did not exceed, according to the histogram's resolution. Zero if the histogram is empty.
+ */
+uint32_t modbus_tcp_latency_percentile(modbus_tcp_latency_t const* latency, uint8_t percent);
+
+/**
+ * Releases the remapped Transaction Id of a request of a client connection that will not get
+ * a response, e.g., because it was lost or the request was given up. Otherwise, its map entry
+ * stays in use until a response verifies, and lost responses eventually fill the map.
+ *
+ * \param tid Transaction Id of the request before remapping.
+ * \return Whether a request with the Transaction Id was outstanding.
+ */
+bool modbus_tcp_release_tid(repel_connection_t con, uint16_t tid);
+
+/**
+ * Configuration of modbus_tcp_parser connections. Connections created without configuration
+ * use MODBUS_TCP_IS_CLIENT, MODBUS_TCP_REUSE_TID_BITS, and MODBUS_TCP_REUSE_UNIT_ID.
+ */
+typedef struct ModbusTCPConfig modbus_tcp_config_t;
+struct ModbusTCPConfig {
+    /**
+     * Whether this end of the connection is the Modbus client. Clients remap Transaction Ids.
+     */
+    bool is_client;
+    /**
+     * Transaction Identifier bits reused for MAC bits, below 16. Clients remap Transaction Ids
+     * to the remaining bits, so fewer reused bits allow more outstanding requests.
+     */
+    uint8_t reuse_tid_bits;
+    /**
+     * Whether the Unit Identifier is reused for MAC bits.
+     */
+    bool reuse_unit_id;
+    /**
+     * Histogram that client connections record round trip times into, NULL to not measure them.
+     * Must outlive the connection.
+     */
+    modbus_tcp_latency_t* latency;
+};
+
+/**
+ * Modbus RTU parser for serial lines and RTU over TCP.
+ * Recomputes the CRC-16 of frames it modifies.
+ */
+extern parser_module_t modbus_rtu_parser;
+
+/**
+ * Configuration of modbus_rtu_parser connections. Connections created without configuration
+ * use MODBUS_RTU_IS_CLIENT, MODBUS_RTU_REUSE_ADDRESS, and MODBUS_RTU_ADDRESS.
+ */
+typedef struct ModbusRTUConfig modbus_rtu_config_t;
+struct ModbusRTUConfig {
+    /**
+     * Whether this end of the connection is the Modbus client (master), which sends requests.
+     */
+    bool is_client;
+    /**
+     * Whether the slave address is reused for MAC bits. Only for connections to a single device.
+     * Without reuse, frames of functions 5, 6, 7, 8, 11, 12, 17, 22, and most responses are unprotected.
+     */
+    bool reuse_address;
+    /**
+     * Slave address of the device, restored if reused.
+     */
+    uint8_t address;
+};
+
+/**
+ * DNP3 link-layer parser, recomputes only the header CRC of frames it modifies.
+ */
+extern parser_module_t dnp3_parser;
+
+/**
+ * Configuration of dnp3_parser connections. Connections created without configuration
+ * use DNP3_IS_MASTER, DNP3_REUSE_ADDRESSES, DNP3_MASTER_ADDRESS, and DNP3_OUTSTATION_ADDRESS.
+ */
+typedef struct DNP3Config dnp3_config_t;
+struct DNP3Config {
+    /**
+     * Whether this end of the connection is the master, which polls the outstation.
+     */
+    bool is_master;
+    /**
+     * Whether the link-layer addresses are reused for MAC bits. Only for connections between
+     * one master and one outstation.
+     */
+    bool reuse_addresses;
+    /**
+     * Link-layer addresses, restored if reused.
+     */
+    uint16_t master_address;
+    uint16_t outstation_address;
+};
+
+/**
+ * IEC 60870-5-104 parser. All APDUs carry embedded nonce bits, since the sequence numbers
+ * of I-format APDUs restart with each TCP connection. I-format APDUs have 9 bits for MAC and
+ * nonce bits, or 25 bits if the common address is reused, so create connections with few nonce bits.
+ */
+extern parser_module_t iec104_parser;
+
+/**
+ * Configuration of iec104_parser connections. Connections created without configuration
+ * use IEC104_REUSE_COMMON_ADDRESS and IEC104_COMMON_ADDRESS.
+ */
+typedef struct IEC104Config iec104_config_t;
+struct IEC104Config {
+    /**
+     * Whether the ASDU common address of I-format APDUs is reused for MAC bits.
+     * Only for connections to a single station.
+     */
+    bool reuse_common_address;
+    /**
+     * Common address of the station, restored if reused.
+     */
+    uint16_t common_address;
+};
+
+/**
+ * EtherNet/IP encapsulation parser, embeds in the sender context and options of the header.
+ */
+extern parser_module_t enip_parser;
+
+/**
+ * Configuration of enip_parser connections. Connections created without configuration
+ * use ENIP_IS_ORIGINATOR and ENIP_REUSE_SENDER_CONTEXT.
+ */
+typedef struct EnipConfig enip_config_t;
+struct EnipConfig {
+    /**
+     * Whether this end of the connection originates requests, e.g., a scanner, and receives replies.
+     */
+    bool is_originator;
+    /**
+     * Whether the sender context is reused for MAC bits, which the originator restores in replies.
+     */
+    bool reuse_sender_context;
+};
+
 /**
  * Test parser module that overwrites the first packet bytes with MAC bits.
  */
@@ -122,6 +122,39 @@ typedef int16_t mac_verify_fn_t(void* self, in_buffer_t packet, bufsize_t pktlen
  */
 typedef void mac_set_keys_fn_t(void* self, void const* keys);
 
+/**
+ * A single packet of a batched MAC calculation.
+ */
+typedef struct MacBatchJob mac_batch_job_t;
+struct MacBatchJob {
+    in_buffer_t packet;
+    bufsize_t pktlen;
+    /**
+     * Nonce in network byte order or NULL when unused.
+     */
+    noncebytes_t const* noncebytes;
+    /**
+     * EMBED: MAC bits to calculate. AUTHENTICATE: Length of the extracted MAC in bits.
+     */
+    bitcount_t bits;
+    /**
+     * EMBED: Receives the first ceil_bits_to_bytes(bits) MAC bytes.
+     * AUTHENTICATE: MAC extracted from packet.
+     */
+    uint8_t* mac;
+    /**
+     * AUTHENTICATE: Verification result like the return value of mac_verify_fn_t.
+     */
+    int16_t result;
+};
+
+/**
+ * Optional, may be NULL. Signs (EMBED) or verifies (AUTHENTICATE) several packets at once,
+ * which allows implementations to submit the work to an accelerator together.
+ * Callers use mac_batch(), which falls back to sign and verify.
+ */
+typedef void mac_batch_fn_t(void* self, mac_batch_job_t* jobs, uint16_t count, repel_mode_t mode);
+
 struct MacModule {
     mac_create_fn_t* const create;
     module_destroy_fn_t* const destroy;
@@ -129,6 +162,15 @@ struct MacModule {
     mac_sign_fn_t* const sign;
     mac_verify_fn_t* const verify;
     mac_set_keys_fn_t* const set_keys;
+
+    mac_batch_fn_t* const batch;
+
+    /**
+     * Whether a repeated nonce under the same keys breaks the MAC itself, not only replay protection,
+     * as it does for GMAC. Connections then only embed with nonces that survive restarts,
+     * i.e., reserved by saved state or leases, or derived from a clock.
+     */
+    bool const needs_unique_nonces;
 };
 
 /**********************************************************
@@ -161,11 +203,12 @@ struct ParseResult {
  *
  * \return Module instance data.
  *
+ * \param config Parser specific configuration, NULL selects the parser's defaults.
  * \param max_embed_bits Must be set by the parser to the maximum
  * number of bits the parser can embed in any packet.
  * Used to determine the buffer size supplied to embed.
  */
-typedef void* parser_create_fn_t(bitcount_t* max_embed_bits);
+typedef void* parser_create_fn_t(void const* config, bitcount_t* max_embed_bits);
 
 /**
  * Parses a packet to determine its length and how many bits can be embedded in this packet.
@@ -216,6 +259,28 @@ typedef void parser_restore_fn_t(void* self, inout_buffer_t packet, bufsize_t pk
  */
 typedef void parser_verified_fn_t(void* self, inout_buffer_t packet, bufsize_t pktlen);
 
+/**
+ * Optional, may be NULL. Serializes the connection specific parser state,
+ * e.g., to resume the connection after a restart.
+ *
+ * \return Number of bytes written to buf, zero if len is too small.
+ */
+typedef bufsize_t parser_save_fn_t(void* self, out_buffer_t buf, bufsize_t len);
+
+/**
+ * Optional, may be NULL. Restores parser state serialized by parser_save_fn_t.
+ *
+ * \return Whether buf held valid state.
+ */
+typedef bool parser_load_fn_t(void* self, in_buffer_t buf, bufsize_t len);
+
+/**
+ * Optional, may be NULL. Returns a module whose functions are specialized for the configuration,
+ * e.g., with parameters that would otherwise be checked per packet fixed at compile time.
+ * The connection uses the returned module, including its create function, instead.
+ */
+typedef parser_module_t* parser_specialize_fn_t(void const* config);
+
 struct ParserModule {
     parser_create_fn_t* const create;
     module_destroy_fn_t* const destroy;
@@ -225,12 +290,74 @@ struct ParserModule {
     parser_extract_fn_t* const extract;
     parser_restore_fn_t* const restore;
     parser_verified_fn_t* const verified;
+
+    parser_save_fn_t* const save;
+    parser_load_fn_t* const load;
+
+    parser_specialize_fn_t* const specialize;
 };
 
+/**********************************************************
+ *                   MAC util functions                   *
+ **********************************************************/
+
+/**
+ * Compares the leading bits of two MACs in constant time.
+ * Bits following the first 'bits' bits are ignored.
+ *
+ * \return Whether the leading bits are equal.
+ */
+static inline bool mac_equal_bits(in_buffer_t a, in_buffer_t b, bitcount_t bits) {
+    bufsize_t const fullbytes = bits / 8;
+    bufsize_t const oddbits = bits % 8;
+    uint8_t diff = 0;
+
+    for(bufsize_t i = 0; i < fullbytes; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    if(oddbits > 0) {
+        /* Only MSBs contain MAC bits */
+        diff |= (a[fullbytes] ^ b[fullbytes]) & (uint8_t) (0xff << (8 - oddbits));
+    }
+    return diff == 0;
+}
+
+/**
+ * Signs or verifies a batch of packets with the module's batch function,
+ * or one packet after the other if the module has none.
+ */
+static inline void mac_batch(mac_module_t* module, void* self, mac_batch_job_t* jobs, uint16_t count, repel_mode_t mode) {
+    if(module->batch) {
+        module->batch(self, jobs, count, mode);
+        return;
+    }
+
+    for(uint16_t j = 0; j < count; j++) {
+        mac_batch_job_t* job = &jobs[j];
+        if(mode == EMBED) {
+            out_buffer_t mac = module->sign(self, job->packet, job->pktlen, job->bits, 0, job->noncebytes);
+            for(bufsize_t i = 0; i < ceil_bits_to_bytes(job->bits); i++) {
+                job->mac[i] = mac[i];
+            }
+        } else {
+            job->result = module->verify(self, job->packet, job->pktlen, job->mac, job->bits, job->noncebytes);
+        }
+    }
+}
+
 /**********************************************************
  *                 Parser util functions                  *
  **********************************************************/
 
+/**
+ * State of a connection's parser, for parser functions that take a connection.
+ *
+ * \param create Create function of the parser, which is shared by its specializations.
+ * \return State or NULL if the connection uses a different parser.
+ */
+struct RepelConnection;
+void* repel_parser_state(struct RepelConnection* con, parser_create_fn_t* create);
+
 #define state_from(TYPE, param) TYPE* state = (TYPE*) param
 /**
  * Defines bitstring_t pkt;
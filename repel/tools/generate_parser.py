@@ -0,0 +1,426 @@
+"""
+Copyright (c) 2021, Nils Rothaug
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived
+from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+OF THE POSSIBILITY OF SUCH DAMAGE.
+"""
+
+"""
+Generates a stateless parser module from a JSON protocol spec, e.g., example.json:
+
+{
+    "name": "example",
+    "description": "Modbus TCP with MAC bits in protocol identifier and unit identifier",
+    "min_length": 8,
+    "length": { "offset": 4, "bytes": 2, "endian": "big", "adjust": 6 },
+    "packet_has_nonce": false,
+    "fields": [
+        { "name": "protocol identifier", "offset": 2, "bits": 16, "restore": 0 },
+        { "name": "unit identifier", "offset": 6, "bits": 8, "restore": 255 }
+    ]
+}
+
+The packet length is the length field's value times "scale" (default 1) plus "adjust",
+or "length": { "fixed": <bytes> } for fixed size packets of at least the minimum length.
+Packets longer than 65535 bytes are rejected as invalid. Fields lie within the minimum
+length. They start at byte "offset" plus "skip" bits (default 0, counted from the most
+significant bit), hold MAC bits, and are restored to the "restore" value, which is stored
+"endian" (default big) if the field consists of whole bytes and most significant bit first otherwise.
+
+All offsets are folded into constants. Adjacent fields are fused, and byte aligned runs
+of fields are copied and restored bytewise instead of with bitstring calls.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+
+LICENSE = '''/*
+ * Copyright (c) 2021, Nils Rothaug
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+'''
+
+
+class SpecError(Exception):
+    pass
+
+
+# Packet lengths fit bufsize_t
+MAX_LENGTH = 0xffff
+
+
+def integer(obj, key, what, minimum, maximum, default=None):
+    """Value of an integer spec entry within bounds"""
+    value = obj.get(key, default)
+    if value is None:
+        raise SpecError("Missing '%s' of %s" % (key, what))
+    # bool is an int in Python, but no valid spec value
+    if type(value) is not int:
+        raise SpecError("'%s' of %s must be an integer" % (key, what))
+    if value < minimum or value > maximum:
+        raise SpecError("'%s' of %s must be in [%d, %d]" % (key, what, minimum, maximum))
+    return value
+
+
+class Run:
+    """Adjacent fields, which are copied and restored at once"""
+
+    def __init__(self, pos, mac_pos):
+        self.pos = pos
+        self.mac_pos = mac_pos
+        self.bits = 0
+        self.value = 0
+        self.names = []
+
+    def append(self, field):
+        self.bits += field["bits"]
+        self.value = (self.value << field["bits"]) | field["packed"]
+        self.names.append(field["name"])
+
+    def aligned(self):
+        return self.pos % 8 == 0 and self.mac_pos % 8 == 0 and self.bits % 8 == 0
+
+
+def load_spec(path):
+    with open(path) as f:
+        spec = json.load(f)
+
+    for key in ("name", "min_length", "length", "fields"):
+        if key not in spec:
+            raise SpecError("Missing '%s'" % key)
+    if not spec["name"].isidentifier():
+        raise SpecError("Name '%s' is no C identifier" % spec["name"])
+    min_length = integer(spec, "min_length", "spec", 1, MAX_LENGTH)
+
+    length = spec["length"]
+    if "fixed" in length:
+        integer(length, "fixed", "length", min_length, MAX_LENGTH)
+    else:
+        if integer(length, "bytes", "length", 1, 4) == 3:
+            raise SpecError("Length field must have 1, 2, or 4 bytes")
+        if integer(length, "offset", "length", 0, MAX_LENGTH) + length["bytes"] > min_length:
+            raise SpecError("Length field exceeds minimum length")
+        if length.get("endian", "big") not in ("big", "little"):
+            raise SpecError("Length field endianness must be 'big' or 'little'")
+        # Keeps the length computation within int64_t
+        integer(length, "scale", "length", 1, MAX_LENGTH, 1)
+        integer(length, "adjust", "length", -MAX_LENGTH, MAX_LENGTH, 0)
+
+    fields = []
+    for field in spec["fields"]:
+        field.setdefault("name", "field")
+        what = "field '%s'" % field["name"]
+        field["pos"] = integer(field, "offset", what, 0, MAX_LENGTH) * 8 + integer(field, "skip", what, 0, MAX_LENGTH * 8, 0)
+        bits = integer(field, "bits", what, 1, MAX_LENGTH * 8)
+        if field["pos"] + bits > min_length * 8:
+            raise SpecError("Field '%s' exceeds minimum length" % field["name"])
+
+        value = integer(field, "restore", what, 0, (1 << bits) - 1, 0)
+        endian = field.get("endian", "big")
+        if endian == "little":
+            if field["pos"] % 8 != 0 or bits % 8 != 0:
+                raise SpecError("Little endian field '%s' must consist of whole bytes" % field["name"])
+            value = int.from_bytes(value.to_bytes(bits // 8, "little"), "big")
+        elif endian != "big":
+            raise SpecError("Field '%s' endianness must be 'big' or 'little'" % field["name"])
+        field["packed"] = value
+        fields.append(field)
+
+    fields.sort(key=lambda f: f["pos"])
+    for prev, cur in zip(fields, fields[1:]):
+        if prev["pos"] + prev["bits"] > cur["pos"]:
+            raise SpecError("Fields '%s' and '%s' overlap" % (prev["name"], cur["name"]))
+    if not fields:
+        raise SpecError("No fields to embed MAC bits")
+    spec["fields"] = fields
+    return spec
+
+
+def fuse(fields):
+    runs = []
+    mac_pos = 0
+    for field in fields:
+        if not runs or runs[-1].pos + runs[-1].bits != field["pos"]:
+            runs.append(Run(field["pos"], mac_pos))
+        runs[-1].append(field)
+        mac_pos += field["bits"]
+    return runs, mac_pos
+
+
+def length_expr(length):
+    if "fixed" in length:
+        return None
+    offset = length["offset"]
+    count = length["bytes"]
+    order = range(count) if length.get("endian", "big") == "big" else reversed(range(count))
+    terms = []
+    for shift, i in zip(reversed(range(count)), order):
+        if shift == 0:
+            terms.append("packet[%d]" % (offset + i))
+        else:
+            terms.append("((uint32_t) packet[%d] << %d)" % (offset + i, shift * 8))
+    return " | ".join(terms)
+
+
+def copy_code(run, to_packet):
+    """Copies a run between packet and MAC buffer"""
+    names = ", ".join(run.names)
+    if run.aligned():
+        if to_packet:
+            return ["    /* %s */" % names,
+                    "    memcpy(packet + %d, macbuf + %d, %d);" % (run.pos // 8, run.mac_pos // 8, run.bits // 8)]
+        return ["    /* %s */" % names,
+                "    memcpy(macbuf + %d, packet + %d, %d);" % (run.mac_pos // 8, run.pos // 8, run.bits // 8)]
+
+    dest, src = ("pkt", "mac") if to_packet else ("mac", "pkt")
+    lines = ["    {",
+             "        /* %s */" % names,
+             "        bitstring_t pkt = bitstring_init(packet + %d);" % (run.pos // 8),
+             "        bitstring_t mac = bitstring_init((inout_buffer_t) macbuf + %d);" % (run.mac_pos // 8)]
+    if run.pos % 8:
+        lines.append("        bitstring_skip(&pkt, %d);" % (run.pos % 8))
+    if run.mac_pos % 8:
+        lines.append("        bitstring_skip(&mac, %d);" % (run.mac_pos % 8))
+    bits = run.bits
+    while bits > 0:
+        chunk = min(bits, 64)
+        lines.append("        bitstring_copy_u64(&%s, &%s, %d);" % (dest, src, chunk))
+        bits -= chunk
+    lines.append("    }")
+    return lines
+
+
+def restore_code(run):
+    names = ", ".join(run.names)
+    if run.pos % 8 == 0 and run.bits % 8 == 0:
+        data = run.value.to_bytes(run.bits // 8, "big")
+        lines = ["    /* %s */" % names]
+        if all(b == data[0] for b in data) and len(data) > 2:
+            lines.append("    memset(packet + %d, 0x%02x, %d);" % (run.pos // 8, data[0], len(data)))
+        else:
+            for i, b in enumerate(data):
+                lines.append("    packet[%d] = 0x%02x;" % (run.pos // 8 + i, b))
+        return lines
+
+    lines = ["    {",
+             "        /* %s */" % names,
+             "        bitstring_t pkt = bitstring_init(packet + %d);" % (run.pos // 8)]
+    if run.pos % 8:
+        lines.append("        bitstring_skip(&pkt, %d);" % (run.pos % 8))
+    bits = run.bits
+    while bits > 0:
+        chunk = min(bits, 64)
+        value = (run.value >> (bits - chunk)) & ((1 << chunk) - 1)
+        lines.append("        bitstring_push_u64(&pkt, 0x%xull, %d);" % (value, chunk))
+        bits -= chunk
+    lines.append("    }")
+    return lines
+
+
+def generate(spec, spec_name, header_name):
+    name = spec["name"]
+    runs, embed_bits = fuse(spec["fields"])
+    min_length = spec["min_length"]
+    length = spec["length"]
+    has_nonce = "true" if spec.get("packet_has_nonce", False) else "false"
+    prefix = name.upper()
+    description = spec.get("description", "Parser for the %s protocol" % name)
+
+    out = [LICENSE, "/**",
+           " * \\file",
+           " * %s." % description.rstrip("."),
+           " *",
+           " * Generated by tools/generate_parser.py from %s, do not edit." % spec_name,
+           " */",
+           "",
+           "#include \"%s\"" % header_name,
+           "",
+           "#include \"repel_modules.h\"",
+           "#include \"repel_log.h\"",
+           "",
+           "#include <string.h>",
+           "",
+           "#include \"platform.h\"",
+           "#include \"bitstring.h\"",
+           "",
+           "#define %s_MIN_LENGTH %d" % (prefix, min_length),
+           "#define %s_EMBED_BITS %d" % (prefix, embed_bits),
+           "",
+           "/* create functions currently do not accept no state */",
+           "static uint8_t %s_state;" % name,
+           "",
+           "void* %s_create(void const* config, bitcount_t* max_embed_bits) {" % name,
+           "    UNUSED(config);",
+           "    *max_embed_bits = %s_EMBED_BITS;" % prefix,
+           "    return &%s_state;" % name,
+           "}",
+           "",
+           "void %s_destroy(void* self) {" % name,
+           "    UNUSED(self);",
+           "}",
+           "",
+           "parse_result_t %s_parse(void* self, in_buffer_t packet, bufsize_t buflen, repel_mode_t mode) {" % name,
+           "    UNUSED(self);",
+           "    UNUSED(mode);",
+           "",
+           "    parse_fail_on_minlen(%s_MIN_LENGTH, buflen);" % prefix,
+           ""]
+
+    expr = length_expr(length)
+    if expr is None:
+        out.append("    int32_t const pktlen = %d;" % length["fixed"])
+    else:
+        # Four byte lengths times scale overflow int32_t
+        value = "(int64_t) (%s)" % expr
+        if length.get("scale", 1) != 1:
+            value = "%s * %d" % (value, length["scale"])
+        if length.get("adjust", 0) != 0:
+            value = "%s + %d" % (value, length["adjust"])
+        out += ["    int64_t const length = %s;" % value,
+                "",
+                "    if(length < %s_MIN_LENGTH || length > UINT16_MAX) {" % prefix,
+                "        error(\"%s parser: Invalid length\");" % name,
+                "        return (parse_result_t) { 0, 0, false };",
+                "    }",
+                "    int32_t const pktlen = (int32_t) length;"]
+    out += ["    parse_fail_on_minlen(pktlen, buflen);",
+            "",
+            "    return (parse_result_t) { pktlen, %s_EMBED_BITS, %s };" % (prefix, has_nonce),
+            "}",
+            "",
+            "void %s_embed(void* self, inout_buffer_t packet, bufsize_t pktlen, in_buffer_t macbuf) {" % name,
+            "    UNUSED(self);",
+            "    UNUSED(pktlen);",
+            ""]
+    for run in runs:
+        out += copy_code(run, True)
+    out += ["}",
+            "",
+            "void %s_extract(void* self, inout_buffer_t packet, bufsize_t pktlen, out_buffer_t macbuf) {" % name,
+            "    UNUSED(self);",
+            "    UNUSED(pktlen);",
+            ""]
+    for run in runs:
+        out += copy_code(run, False)
+    out += ["}",
+            "",
+            "void %s_restore(void* self, inout_buffer_t packet, bufsize_t pktlen, repel_mode_t mode) {" % name,
+            "    UNUSED(self);",
+            "    UNUSED(pktlen);",
+            "    UNUSED(mode);",
+            ""]
+    for run in runs:
+        out += restore_code(run)
+    out += ["}",
+            "",
+            "parser_module_t %s_parser = {" % name,
+            "    %s_create," % name,
+            "    %s_destroy," % name,
+            "    %s_parse," % name,
+            "    %s_embed," % name,
+            "    %s_extract," % name,
+            "    %s_restore," % name,
+            "    NULL,",
+            "    NULL,",
+            "    NULL,",
+            "    NULL",
+            "};",
+            ""]
+    source = "\n".join(out)
+
+    guard = "%s_PARSER_H_" % prefix
+    header = "\n".join([LICENSE, "/**",
+                        " * \\file",
+                        " * %s." % description.rstrip("."),
+                        " *",
+                        " * Generated by tools/generate_parser.py from %s, do not edit." % spec_name,
+                        " */",
+                        "",
+                        "#ifndef %s" % guard,
+                        "#define %s" % guard,
+                        "",
+                        "#include \"repel.h\"",
+                        "",
+                        "extern parser_module_t %s_parser;" % name,
+                        "",
+                        "#endif",
+                        ""])
+    return source, header
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a RePeL parser module from a protocol spec")
+    parser.add_argument("spec", help="JSON protocol spec", type=str)
+    parser.add_argument("-o", "--output", help="C source to write, the header is written next to it", type=str, required=True)
+    args = parser.parse_args()
+
+    try:
+        spec = load_spec(args.spec)
+    except (SpecError, KeyError, ValueError, TypeError) as e:
+        sys.exit("%s: %s" % (args.spec, e))
+
+    header_path = os.path.splitext(args.output)[0] + ".h"
+    source, header = generate(spec, os.path.basename(args.spec), os.path.basename(header_path))
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "w") as f:
+        f.write(source)
+    with open(header_path, "w") as f:
+        f.write(header)
+
+
+if __name__ == "__main__":
+    main()